@@ -85,97 +85,88 @@ uint64_t ARMMIRevising::getCalledFunctionAtPLTOffset(uint64_t PLTEndOff,
 
   assert((ExecType == ELF::ET_DYN) || (ExecType == ELF::ET_EXEC));
   // Find the section that contains the offset. That must be the PLT section
-  for (section_iterator SecIter : Elf32LEObjFile->sections()) {
-    uint64_t SecStart = SecIter->getAddress();
-    uint64_t SecEnd = SecStart + SecIter->getSize();
-    if ((SecStart <= PLTEndOff) && (SecEnd >= PLTEndOff)) {
-      StringRef SecName;
-      if (auto NameOrErr = SecIter->getName())
-        SecName = *NameOrErr;
-      else {
-        consumeError(NameOrErr.takeError());
-        assert(false && "Failed to get section name with PLT offset");
-      }
-      if (SecName.compare(".plt") != 0) {
-        assert(false && "Unexpected section name of PLT offset");
-      }
+  const SectionMap::SectionEntry *Sec =
+      MR->getSectionMap().findSectionContaining(PLTEndOff,
+                                                /* IncludeEnd */ true);
+  if (Sec != nullptr) {
+    uint64_t SecStart = Sec->Address;
+    if (Sec->Name.compare(".plt") != 0) {
+      assert(false && "Unexpected section name of PLT offset");
+    }
 
-      auto StrOrErr = SecIter->getContents();
-      assert(StrOrErr && "Failed to get the content of section!");
-      auto SecData = *StrOrErr;
-      ArrayRef<uint8_t> Bytes(reinterpret_cast<const uint8_t *>(SecData.data()),
-                              SecData.size());
+    ArrayRef<uint8_t> Bytes = Sec->Contents;
 
-      MCInst InstAddIP;
-      uint64_t InstAddIPSz;
-      bool Success = MR->getMCDisassembler()->getInstruction(
-          InstAddIP, InstAddIPSz, Bytes.slice(PLTEndOff + 4 - SecStart),
-          PLTEndOff + 4, nulls());
-      assert(Success && "Failed to disassemble instruction in PLT");
+    MCInst InstAddIP;
+    uint64_t InstAddIPSz;
+    bool Success = MR->getMCDisassembler()->getInstruction(
+        InstAddIP, InstAddIPSz, Bytes.slice(PLTEndOff + 4 - SecStart),
+        PLTEndOff + 4, nulls());
+    assert(Success && "Failed to disassemble instruction in PLT");
 
-      unsigned int OpcAddIP = InstAddIP.getOpcode();
-      MCInstrDesc MCIDAddIP = MR->getMCInstrInfo()->get(OpcAddIP);
+    unsigned int OpcAddIP = InstAddIP.getOpcode();
+    MCInstrDesc MCIDAddIP = MR->getMCInstrInfo()->get(OpcAddIP);
 
-      if (OpcAddIP != ARM::ADDri && (MCIDAddIP.getNumOperands() != 6)) {
-        assert(false && "Failed to find function entry from .plt.");
-      }
+    if (OpcAddIP != ARM::ADDri && (MCIDAddIP.getNumOperands() != 6)) {
+      assert(false && "Failed to find function entry from .plt.");
+    }
 
-      MCOperand OpdAddIP = InstAddIP.getOperand(2);
-      assert(OpdAddIP.isImm() && "Unexpected immediate for offset.");
-      unsigned Bits = OpdAddIP.getImm() & 0xFF;
-      unsigned Rot = (OpdAddIP.getImm() & 0xF00) >> 7;
-      int64_t PAlign = static_cast<int64_t>(ARM_AM::rotr32(Bits, Rot));
-
-      MCInst Inst;
-      uint64_t InstSz;
-      Success = MR->getMCDisassembler()->getInstruction(
-          Inst, InstSz, Bytes.slice(PLTEndOff + 8 - SecStart), PLTEndOff + 8,
-          nulls());
-      assert(Success && "Failed to disassemble instruction in PLT");
-      unsigned int Opcode = Inst.getOpcode();
-      MCInstrDesc MCID = MR->getMCInstrInfo()->get(Opcode);
-
-      if (Opcode != ARM::LDRi12 && (MCID.getNumOperands() != 6)) {
-        assert(false && "Failed to find function entry from .plt.");
-      }
+    MCOperand OpdAddIP = InstAddIP.getOperand(2);
+    assert(OpdAddIP.isImm() && "Unexpected immediate for offset.");
+    unsigned Bits = OpdAddIP.getImm() & 0xFF;
+    unsigned Rot = (OpdAddIP.getImm() & 0xF00) >> 7;
+    int64_t PAlign = static_cast<int64_t>(ARM_AM::rotr32(Bits, Rot));
+
+    MCInst Inst;
+    uint64_t InstSz;
+    Success = MR->getMCDisassembler()->getInstruction(
+        Inst, InstSz, Bytes.slice(PLTEndOff + 8 - SecStart), PLTEndOff + 8,
+        nulls());
+    assert(Success && "Failed to disassemble instruction in PLT");
+    unsigned int Opcode = Inst.getOpcode();
+    MCInstrDesc MCID = MR->getMCInstrInfo()->get(Opcode);
+
+    if (Opcode != ARM::LDRi12 && (MCID.getNumOperands() != 6)) {
+      assert(false && "Failed to find function entry from .plt.");
+    }
 
-      MCOperand Operand = Inst.getOperand(3);
-      assert(Operand.isImm() && "Unexpected immediate for offset.");
-
-      uint64_t Index = Operand.getImm();
-
-      uint64_t GotPltRelocOffset = PLTEndOff + Index + PAlign + 8;
-      const RelocationRef *GotPltReloc =
-          MR->getDynRelocAtOffset(GotPltRelocOffset);
-      assert(GotPltReloc != nullptr &&
-             "Failed to get dynamic relocation for jmp target of PLT entry");
-
-      assert((GotPltReloc->getType() == ELF::R_ARM_JUMP_SLOT) &&
-             "Unexpected relocation type for PLT jmp instruction");
-      symbol_iterator CalledFuncSym = GotPltReloc->getSymbol();
-      assert(CalledFuncSym != Elf32LEObjFile->symbol_end() &&
-             "Failed to find relocation symbol for PLT entry");
-      Expected<StringRef> CalledFuncSymName = CalledFuncSym->getName();
-      assert(CalledFuncSymName &&
-             "Failed to find symbol associated with dynamic "
-             "relocation of PLT jmp target.");
-      Expected<uint64_t> CalledFuncSymAddr = CalledFuncSym->getAddress();
-      assert(CalledFuncSymAddr &&
-             "Failed to get called function address of PLT entry");
-
-      if (CalledFuncSymAddr.get() == 0) {
-        // Set CallTargetIndex for plt offset to map undefined function symbol
-        // for emit CallInst use.
-        Function *CalledFunc =
-            IncludedFileInfo::CreateFunction(*CalledFuncSymName, *MR);
-        // Bail out if function prototype is not available
-        if (!CalledFunc)
-          exit(-1);
-        MR->setSyscallMapping(PLTEndOff, CalledFunc);
-        MR->fillInstAddrFuncMap(CallAddr, CalledFunc);
-      }
-      return CalledFuncSymAddr.get();
+    MCOperand Operand = Inst.getOperand(3);
+    assert(Operand.isImm() && "Unexpected immediate for offset.");
+
+    uint64_t Index = Operand.getImm();
+
+    uint64_t GotPltRelocOffset = PLTEndOff + Index + PAlign + 8;
+    const RelocationRef *GotPltReloc =
+        MR->getDynRelocAtOffset(GotPltRelocOffset);
+    assert(GotPltReloc != nullptr &&
+           "Failed to get dynamic relocation for jmp target of PLT entry");
+
+    assert((GotPltReloc->getType() == ELF::R_ARM_JUMP_SLOT) &&
+           "Unexpected relocation type for PLT jmp instruction");
+    symbol_iterator CalledFuncSym = GotPltReloc->getSymbol();
+    assert(CalledFuncSym != Elf32LEObjFile->symbol_end() &&
+           "Failed to find relocation symbol for PLT entry");
+    Expected<StringRef> CalledFuncSymName = CalledFuncSym->getName();
+    assert(CalledFuncSymName &&
+           "Failed to find symbol associated with dynamic "
+           "relocation of PLT jmp target.");
+    Expected<uint64_t> CalledFuncSymAddr = CalledFuncSym->getAddress();
+    assert(CalledFuncSymAddr &&
+           "Failed to get called function address of PLT entry");
+
+    if (CalledFuncSymAddr.get() == 0) {
+      // Set CallTargetIndex for plt offset to map undefined function symbol
+      // for emit CallInst use.
+      Function *CalledFunc =
+          IncludedFileInfo::CreateFunction(*CalledFuncSymName, *MR);
+      // Bail out if function prototype is not available
+      if (!CalledFunc)
+        reportError(MR->getObjectFile()->getFileName(),
+                    "unknown prototype of external function " +
+                        *CalledFuncSymName);
+      MR->setSyscallMapping(PLTEndOff, CalledFunc);
+      MR->fillInstAddrFuncMap(CallAddr, CalledFunc);
     }
+    return CalledFuncSymAddr.get();
   }
   return 0;
 }
@@ -260,18 +251,10 @@ const Value *ARMMIRevising::getGlobalValueByOffset(int64_t MCInstOffset,
     auto Iter = MCIR->getMCInstAt(Offset - TextSecAddr);
     uint64_t OffVal = static_cast<uint64_t>((*Iter).second.getData());
 
-    for (auto &Sym : ObjFile->symbols()) {
-      if (Sym.getELFType() == ELF::STT_OBJECT) {
-        auto SymAddr = Sym.getAddress();
-        assert(SymAddr && "Failed to lookup symbol for global address!");
-
-        if (OffVal >= SymAddr.get() &&
-            OffVal < (SymAddr.get() + Sym.getSize())) {
-          Symbol = &Sym;
-          break;
-        }
-      }
-    }
+    const SymbolIndex::SymbolEntry *ObjSym =
+        MR->getSymbolIndex().findSymbolContaining(OffVal, {ELF::STT_OBJECT});
+    if (ObjSym != nullptr)
+      Symbol = &ObjSym->Symbol;
   }
 
   Module *M = getModule();
@@ -394,45 +377,39 @@ const Value *ARMMIRevising::getGlobalValueByOffset(int64_t MCInstOffset,
           uint32_t Data = MD.getData();
           uint64_t DataAddr = (uint64_t)Data;
           // Check if this is an address in .rodata
-          for (section_iterator SecIter : ObjFile->sections()) {
-            uint64_t SecStart = SecIter->getAddress();
-            uint64_t SecEnd = SecStart + SecIter->getSize();
-
-            if ((SecStart <= DataAddr) && (SecEnd >= DataAddr)) {
-              if (SecIter->isData()) {
-                auto StrOrErr = SecIter->getContents();
-                assert(StrOrErr && "Failed to get the content of section!");
-                StringRef SecData = *StrOrErr;
-                uint64_t DataOffset = DataAddr - SecStart;
-                const unsigned char *RODataBegin =
-                    SecData.bytes_begin() + DataOffset;
-
-                unsigned char C;
-                uint64_t ArgNum = 0;
-                const unsigned char *Str = RODataBegin;
-                do {
-                  C = (unsigned char)*Str++;
-                  if (C == '%') {
-                    ArgNum++;
-                  }
-                } while (C != '\0');
-                if (ArgNum != 0) {
-                  MR->collectRodataInstAddr(InstAddr);
-                  MR->fillInstArgMap(InstAddr, ArgNum + 1);
-                }
-                StringRef ROStringRef(
-                    reinterpret_cast<const char *>(RODataBegin));
-                Constant *StrConstant =
-                    ConstantDataArray::getString(LCTX, ROStringRef);
-                auto *GlobalStrConstVal = new GlobalVariable(
-                    *M, StrConstant->getType(), /* isConstant */ true,
-                    GlobalValue::PrivateLinkage, StrConstant, "RO-String");
-                // Record the mapping between offset and global value
-                MR->addRODataValueAt(GlobalStrConstVal, Offset);
-                GlobVal = GlobalStrConstVal;
-                break;
+          const SectionMap::SectionEntry *Sec =
+              MR->getSectionMap().findSectionContaining(
+                  DataAddr, /* IncludeEnd */ true,
+                  [](const SectionMap::SectionEntry &S) { return S.IsData; });
+          if (Sec != nullptr) {
+            uint64_t SecStart = Sec->Address;
+            StringRef SecData = toStringRef(Sec->Contents);
+            uint64_t DataOffset = DataAddr - SecStart;
+            const unsigned char *RODataBegin =
+                SecData.bytes_begin() + DataOffset;
+
+            unsigned char C;
+            uint64_t ArgNum = 0;
+            const unsigned char *Str = RODataBegin;
+            do {
+              C = (unsigned char)*Str++;
+              if (C == '%') {
+                ArgNum++;
               }
+            } while (C != '\0');
+            if (ArgNum != 0) {
+              MR->collectRodataInstAddr(InstAddr);
+              MR->fillInstArgMap(InstAddr, ArgNum + 1);
             }
+            StringRef ROStringRef(reinterpret_cast<const char *>(RODataBegin));
+            Constant *StrConstant =
+                ConstantDataArray::getString(LCTX, ROStringRef);
+            auto *GlobalStrConstVal = new GlobalVariable(
+                *M, StrConstant->getType(), /* isConstant */ true,
+                GlobalValue::PrivateLinkage, StrConstant, "RO-String");
+            // Record the mapping between offset and global value
+            MR->addRODataValueAt(GlobalStrConstVal, Offset);
+            GlobVal = GlobalStrConstVal;
           }
 
           if (GlobVal == nullptr) {
@@ -31,7 +31,7 @@ bool ARMModuleRaiser::collectDynamicRelocations() {
   std::vector<SectionRef> DynRelSec = Obj->dynamic_relocation_sections();
   for (const SectionRef &Section : DynRelSec) {
     for (const RelocationRef &Reloc : Section.relocations()) {
-      DynRelocs.push_back(Reloc);
+      Relocs.addDynamicRelocation(Reloc);
     }
   }
   return true;
@@ -74,5 +74,7 @@ void ARMModuleRaiser::addRODataValueAt(Value *V, uint64_t Offset) const {
 }
 
 void registerARMModuleRaiser() {
-  registerModuleRaiser(new ARMModuleRaiser());
+  registerModuleRaiser(Triple::arm, []() -> ModuleRaiser * {
+    return new ARMModuleRaiser();
+  });
 }
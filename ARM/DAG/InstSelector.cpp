@@ -55,7 +55,7 @@ void InstSelector::recordDefinition(SDNode *OldNode, SDNode *NewNode) {
          "The new SDNode ptr is null when record define!");
 
   if (OldNode == nullptr) {
-    outs() << "Warning: RecordDefine error, the SDNode ptr is null!\n";
+    errs() << "Warning: RecordDefine error, the SDNode ptr is null!\n";
     return;
   }
 
@@ -1124,49 +1124,49 @@ void InstSelector::selectCode(SDNode *N) {
   /* ABS */
   case ARM::ABS:
   case ARM::t2ABS: {
-    outs() << "WARNING: ARM::ABS Not yet implemented!\n";
+    errs() << "WARNING: ARM::ABS Not yet implemented!\n";
   } break;
   case ARM::tLDRpci:
   case ARM::LDRcp: {
-    outs() << "WARNING: ARM::LDR Not yet implemented!\n";
+    errs() << "WARNING: ARM::LDR Not yet implemented!\n";
   } break;
   case ARM::t2SBFX:
   case ARM::SBFX:
   case ARM::t2UBFX:
   case ARM::UBFX: {
-    outs() << "WARNING: ARM::UBFX Not yet implemented!\n";
+    errs() << "WARNING: ARM::UBFX Not yet implemented!\n";
   } break;
   case ARM::t2UMAAL:
   case ARM::UMAAL: {
-    outs() << "WARNING: ARM::UMAAL Not yet implemented!\n";
+    errs() << "WARNING: ARM::UMAAL Not yet implemented!\n";
   } break;
   case ARM::t2UMLAL:
   case ARM::UMLAL:
   case ARM::UMLALv5: {
-    outs() << "WARNING: ARM::UMLAL Not yet implemented!\n";
+    errs() << "WARNING: ARM::UMLAL Not yet implemented!\n";
   } break;
   case ARM::t2SMLAL:
   case ARM::SMLAL:
   case ARM::SMLALv5: {
-    outs() << "WARNING: ARM::SMLAL Not yet implemented!\n";
+    errs() << "WARNING: ARM::SMLAL Not yet implemented!\n";
   } break;
   case ARM::t2SMMLS:
   case ARM::SMMLS: {
-    outs() << "WARNING: ARM::SMMLS Not yet implemented!\n";
+    errs() << "WARNING: ARM::SMMLS Not yet implemented!\n";
   } break;
   case ARM::VZIPd8:
   case ARM::VZIPd16:
   case ARM::VZIPq8:
   case ARM::VZIPq16:
   case ARM::VZIPq32: {
-    outs() << "WARNING: ARM::VZIP Not yet implemented!\n";
+    errs() << "WARNING: ARM::VZIP Not yet implemented!\n";
   } break;
   case ARM::VUZPd8:
   case ARM::VUZPd16:
   case ARM::VUZPq8:
   case ARM::VUZPq16:
   case ARM::VUZPq32: {
-    outs() << "WARNING: ARM::VUZP Not yet implemented!\n";
+    errs() << "WARNING: ARM::VUZP Not yet implemented!\n";
   } break;
   case ARM::VTRNd8:
   case ARM::VTRNd16:
@@ -1174,7 +1174,7 @@ void InstSelector::selectCode(SDNode *N) {
   case ARM::VTRNq8:
   case ARM::VTRNq16:
   case ARM::VTRNq32: {
-    outs() << "WARNING: ARM::VTRN Not yet implemented!\n";
+    errs() << "WARNING: ARM::VTRN Not yet implemented!\n";
   } break;
     // TODO: Need to add other pattern matching here.
   }
@@ -7,10 +7,14 @@
 //===----------------------------------------------------------------------===//
 
 #include "EmitRaisedOutputPass.h"
+#include "Raiser/RaiserStatistics.h"
+
+using namespace llvm::mctoll;
 
 char EmitRaisedOutputPass::ID = 0;
 
 bool EmitRaisedOutputPass::runOnModule(Module &M) {
+  RaiserStatistics::PhaseRegion Region(RaiserPhase::EmitOutput);
   ModuleAnalysisManager DummyMAM;
   // Save current data layout of the module
   auto DL = M.getDataLayout();
@@ -0,0 +1,65 @@
+//===-- OptimizationPipelinePass.cpp ----------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "OptimizationPipelinePass.h"
+#include "Raiser/RaiserStatistics.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+
+#define DEBUG_TYPE "mctoll"
+
+using namespace llvm::mctoll;
+
+STATISTIC(NumIRInstrsBeforeOpt,
+          "Number of raised IR instructions before the optimization pipeline");
+STATISTIC(NumIRInstrsAfterOpt,
+          "Number of raised IR instructions after the optimization pipeline");
+
+char OptimizationPipelinePass::ID = 0;
+
+static unsigned getInstructionCount(const Module &M) {
+  unsigned Count = 0;
+  for (const Function &F : M)
+    Count += F.getInstructionCount();
+  return Count;
+}
+
+bool OptimizationPipelinePass::runOnModule(Module &M) {
+  RaiserStatistics::PhaseRegion Region(RaiserPhase::Optimization);
+  NumIRInstrsBeforeOpt += getInstructionCount(M);
+
+  // The analysis managers are registered with each other once for the whole
+  // pipeline, so that an analysis is computed once and reused by all passes
+  // of the pipeline until a pass invalidates it.
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+  PassBuilder PB(TM);
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+  // The pipeline was validated when parsing the command line. Passes
+  // registered by the target machine only add to the passes known then.
+  ModulePassManager MPM;
+  cantFail(PB.parsePassPipeline(MPM, PassPipeline));
+  MPM.run(M, MAM);
+
+  NumIRInstrsAfterOpt += getInstructionCount(M);
+  return true;
+}
+
+Error OptimizationPipelinePass::validatePipeline(StringRef PassPipeline) {
+  PassBuilder PB;
+  ModulePassManager MPM;
+  return PB.parsePassPipeline(MPM, PassPipeline);
+}
@@ -0,0 +1,43 @@
+//===-- OptimizationPipelinePass.h ------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the declaration of OptimizationPipelinePass for use by
+// llvm-mctoll. This class runs a pipeline of new pass manager passes, as
+// specified using --opt-level or --passes, on the raised module before it is
+// emitted.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_LLVM_MCTOLL_OPTIMIZATIONPIPELINEPASS_H
+#define LLVM_TOOLS_LLVM_MCTOLL_OPTIMIZATIONPIPELINEPASS_H
+
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Target/TargetMachine.h"
+#include <string>
+
+using namespace llvm;
+
+class OptimizationPipelinePass : public ModulePass {
+  TargetMachine *TM;
+  std::string PassPipeline;
+
+public:
+  static char ID;
+  OptimizationPipelinePass() : ModulePass(ID), TM(nullptr) {}
+  OptimizationPipelinePass(TargetMachine *TM, StringRef PassPipeline)
+      : ModulePass(ID), TM(TM), PassPipeline(PassPipeline.str()) {}
+
+  bool runOnModule(Module &M) override;
+
+  /// Return an error if PassPipeline is not a valid textual description of a
+  /// pipeline of new pass manager passes.
+  static Error validatePipeline(StringRef PassPipeline);
+};
+#endif // LLVM_TOOLS_LLVM_MCTOLL_OPTIMIZATIONPIPELINEPASS_H
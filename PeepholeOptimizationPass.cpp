@@ -8,6 +8,7 @@
 
 #include "PeepholeOptimizationPass.h"
 #include "Raiser/MachineInstructionRaiser.h"
+#include "Raiser/RaiserStatistics.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instructions.h"
 
@@ -16,6 +17,9 @@ using namespace llvm::mctoll;
 char PeepholeOptimizationPass::ID = 0;
 
 bool PeepholeOptimizationPass::runOnFunction(Function &F) {
+  RaiserStatistics::PhaseRegion Region(RaiserPhase::PeepholeOptimization);
+  RaiserStatistics::FunctionPhaseRegion FunctionRegion(
+      RaiserPhase::PeepholeOptimization, F.getName());
   for (BasicBlock &BB : F) {
 
     auto It = BB.begin();
@@ -29,11 +29,13 @@ bool RISCV32ModuleRaiser::collectDynamicRelocations() {
   std::vector<SectionRef> DynRelSec = Obj->dynamic_relocation_sections();
   for (const SectionRef &Section : DynRelSec)
     for (const RelocationRef &Reloc : Section.relocations())
-      DynRelocs.push_back(Reloc);
+      Relocs.addDynamicRelocation(Reloc);
 
   return true;
 }
 
 void registerRISCV32ModuleRaiser() {
-  registerModuleRaiser(new RISCV32ModuleRaiser());
+  registerModuleRaiser(Triple::riscv32, []() -> ModuleRaiser * {
+    return new RISCV32ModuleRaiser();
+  });
 }
@@ -29,11 +29,13 @@ bool RISCV64ModuleRaiser::collectDynamicRelocations() {
   std::vector<SectionRef> DynRelSec = Obj->dynamic_relocation_sections();
   for (const SectionRef &Section : DynRelSec)
     for (const RelocationRef &Reloc : Section.relocations())
-      DynRelocs.push_back(Reloc);
+      Relocs.addDynamicRelocation(Reloc);
 
   return true;
 }
 
 void registerRISCV64ModuleRaiser() {
-  registerModuleRaiser(new RISCV64ModuleRaiser());
+  registerModuleRaiser(Triple::riscv64, []() -> ModuleRaiser * {
+    return new RISCV64ModuleRaiser();
+  });
 }
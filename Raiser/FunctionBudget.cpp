@@ -0,0 +1,61 @@
+//===-- FunctionBudget.cpp --------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the implementation of FunctionBudget class for use by
+// llvm-mctoll.
+//
+//===----------------------------------------------------------------------===//
+
+#include "FunctionBudget.h"
+#include "llvm-mctoll.h"
+
+using namespace llvm;
+using namespace llvm::mctoll;
+
+bool FunctionBudget::start(const MachineFunction &MF) {
+  StartTime = std::chrono::steady_clock::now();
+  ExceededReason.clear();
+  if (MaxFunctionInstrs == 0)
+    return true;
+
+  uint64_t NumInstrs = 0;
+  for (const MachineBasicBlock &MBB : MF)
+    NumInstrs += MBB.size();
+  if (NumInstrs > MaxFunctionInstrs) {
+    ExceededReason = std::to_string(NumInstrs) +
+                     " machine instructions exceed the budget of " +
+                     std::to_string(MaxFunctionInstrs);
+    return false;
+  }
+  return true;
+}
+
+bool FunctionBudget::isWithinBudget(uint64_t NumIRInstrs) {
+  if (isExceeded())
+    return false;
+
+  if (MaxFunctionIRInstrs != 0 && NumIRInstrs > MaxFunctionIRInstrs) {
+    ExceededReason = std::to_string(NumIRInstrs) +
+                     " IR instructions exceed the budget of " +
+                     std::to_string(MaxFunctionIRInstrs);
+    return false;
+  }
+
+  if (MaxFunctionTime != 0) {
+    auto ElapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::steady_clock::now() - StartTime)
+                         .count();
+    if (static_cast<uint64_t>(ElapsedMs) > MaxFunctionTime) {
+      ExceededReason = std::to_string(ElapsedMs) +
+                       " ms exceed the time budget of " +
+                       std::to_string(MaxFunctionTime) + " ms";
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,52 @@
+//===-- FunctionBudget.h ----------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the declaration of FunctionBudget class that bounds the
+// resources used to raise a function.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_LLVM_MCTOLL_FUNCTIONBUDGET_H
+#define LLVM_TOOLS_LLVM_MCTOLL_FUNCTIONBUDGET_H
+
+#include "llvm/CodeGen/MachineFunction.h"
+#include <chrono>
+#include <string>
+
+namespace llvm {
+namespace mctoll {
+
+/// Budget of raising a function, as specified using --max-function-time,
+/// --max-function-instrs and --max-function-ir-instrs. A budget of 0 is
+/// unlimited. A function that exceeds its budget is emitted as a declaration
+/// with the discovered prototype.
+class FunctionBudget {
+public:
+  /// Start raising MF. Return false if MF has more machine instructions than
+  /// budgeted.
+  bool start(const MachineFunction &MF);
+
+  /// Return false if the time budget is exceeded or the raised function has
+  /// more than the budgeted number of IR instructions, NumIRInstrs.
+  bool isWithinBudget(uint64_t NumIRInstrs);
+
+  /// Return true if the budget was exceeded.
+  bool isExceeded() const { return !ExceededReason.empty(); }
+
+  /// Return the description of the budget that was exceeded.
+  const std::string &getExceededReason() const { return ExceededReason; }
+
+private:
+  std::chrono::steady_clock::time_point StartTime;
+  std::string ExceededReason;
+};
+
+} // end namespace mctoll
+} // end namespace llvm
+
+#endif // LLVM_TOOLS_LLVM_MCTOLL_FUNCTIONBUDGET_H
@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "IncludedFileInfo.h"
+#include "PrototypeCache.h"
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/RecursiveASTVisitor.h"
 #include "clang/Frontend/CompilerInstance.h"
@@ -20,11 +21,13 @@
 #include "clang/Tooling/CompilationDatabase.h"
 #include "clang/Tooling/Tooling.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include <clang-c/Index.h>
 
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 
@@ -41,6 +44,17 @@ std::map<std::string, IncludedFileInfo::FunctionRetAndArgs>
 
 std::set<std::string> IncludedFileInfo::ExternalVariables;
 
+// Prototypes read from the cache file, if it was up to date. Entries are
+// added to ExternalFunctions as they are looked up.
+static std::unique_ptr<PrototypeCache> CachedPrototypes;
+
+// Files read while parsing the header files
+static std::set<std::string> ParsedFiles;
+
+// Serializes lookups of prototypes by inputs raised concurrently, since they
+// add entries to ExternalFunctions.
+static std::mutex ExternalFunctionsMutex;
+
 // FuncDeclVisitor
 
 class FuncDeclVisitor : public clang::RecursiveASTVisitor<FuncDeclVisitor> {
@@ -154,6 +168,16 @@ public:
   FuncDeclFinder(clang::ASTContext &Context) : Visitor(Context) {}
 
   void HandleTranslationUnit(clang::ASTContext &Context) final {
+    // Record the files read, so that the cache file is invalidated if any of
+    // them changes.
+    clang::SourceManager &SM = Context.getSourceManager();
+    for (auto FileInfo = SM.fileinfo_begin(), End = SM.fileinfo_end();
+         FileInfo != End; ++FileInfo) {
+      SmallString<128> Path(FileInfo->first->getName());
+      llvm::sys::fs::make_absolute(Path);
+      ParsedFiles.insert(std::string(Path.str()));
+    }
+
     auto Decls = Context.getTranslationUnitDecl()->decls();
     for (auto &Decl : Decls) {
       if (Decl->isFunctionOrFunctionTemplate() && Decl->isFirstDecl()) {
@@ -192,15 +216,16 @@ Function *IncludedFileInfo::CreateFunction(StringRef &CFuncName,
   if (Func != nullptr)
     return Func;
 
-  auto Iter = IncludedFileInfo::ExternalFunctions.find(CFuncName.str());
-  if (Iter == IncludedFileInfo::ExternalFunctions.end()) {
+  const IncludedFileInfo::FunctionRetAndArgs *Prototype =
+      getFunctionPrototype(CFuncName.str());
+  if (Prototype == nullptr) {
     errs() << "Unknown prototype for function : " << CFuncName.data() << "\n";
     errs() << "Use -I </full/path/to/file>, where /full/path/to/file declares "
               "its prototype\n";
     return nullptr;
   }
 
-  const IncludedFileInfo::FunctionRetAndArgs &RetAndArgs = Iter->second;
+  const IncludedFileInfo::FunctionRetAndArgs &RetAndArgs = *Prototype;
   Type *RetType =
       MR.getFunctionFilter()->getPrimitiveDataType(RetAndArgs.ReturnType);
   std::vector<Type *> ArgVec;
@@ -228,9 +253,42 @@ Function *IncludedFileInfo::CreateFunction(StringRef &CFuncName,
   return nullptr;
 }
 
+const IncludedFileInfo::FunctionRetAndArgs *
+IncludedFileInfo::getFunctionPrototype(const std::string &Name) {
+  std::lock_guard<std::mutex> Lock(ExternalFunctionsMutex);
+  auto Iter = IncludedFileInfo::ExternalFunctions.find(Name);
+  if (Iter != IncludedFileInfo::ExternalFunctions.end())
+    return &Iter->second;
+  IncludedFileInfo::FunctionRetAndArgs Entry;
+  if ((CachedPrototypes != nullptr) &&
+      CachedPrototypes->lookupFunction(Name, Entry))
+    return &IncludedFileInfo::ExternalFunctions.emplace(Name, Entry)
+                .first->second;
+  return nullptr;
+}
+
 bool IncludedFileInfo::getExternalFunctionPrototype(
     std::vector<std::string> &FileNames, std::string &Target,
-    std::string &SysRoot) {
+    std::string &SysRoot, const std::string &CacheDir) {
+  // Use the cached prototypes, if up to date.
+  std::string CacheFilePath;
+  if (!CacheDir.empty()) {
+    Expected<uint64_t> Key =
+        PrototypeCache::computeKey(FileNames, Target, SysRoot);
+    if (Key) {
+      CacheFilePath = PrototypeCache::getCacheFilePath(CacheDir, *Key);
+      CachedPrototypes = PrototypeCache::open(CacheFilePath);
+      if (CachedPrototypes != nullptr) {
+        LLVM_DEBUG(dbgs() << "Using prototypes cached in " << CacheFilePath
+                          << "\n");
+        return true;
+      }
+    } else {
+      // Header files that cannot be read are reported while parsing.
+      consumeError(Key.takeError());
+    }
+  }
+
   std::vector<const char *> ArgPtrVec;
   ArgPtrVec.push_back("parse-header-files");
   ArgPtrVec.push_back("--");
@@ -261,6 +319,13 @@ bool IncludedFileInfo::getExternalFunctionPrototype(
       clang::tooling::newFrontendActionFactory<FuncDeclFindingAction>().get());
   switch (Success) {
   case 0:
+    // Cache the prototypes parsed without errors.
+    if (!CacheFilePath.empty()) {
+      if (Error E = PrototypeCache::write(CacheFilePath, ExternalFunctions,
+                                          ExternalVariables, ParsedFiles))
+        errs() << "warning: unable to write prototype cache file "
+               << CacheFilePath << ": " << toString(std::move(E)) << "\n";
+    }
     break;
   default:
     // TODO : Expand
@@ -278,8 +343,9 @@ bool IncludedFileInfo::isExternalVariable(std::string Name) {
     Name = Name.substr(0, NameEnd);
   }
   // Declare external global variables as external and don't initalize them
-  return IncludedFileInfo::ExternalVariables.find(Name) !=
-         IncludedFileInfo::ExternalVariables.end();
+  return (IncludedFileInfo::ExternalVariables.find(Name) !=
+          IncludedFileInfo::ExternalVariables.end()) ||
+         ((CachedPrototypes != nullptr) && CachedPrototypes->hasVariable(Name));
 }
 
 #undef DEBUG_TYPE
@@ -39,9 +39,18 @@ public:
 
   static std::set<std::string> ExternalVariables;
 
+  // Parse the prototypes of functions and the variables declared in header
+  // files FileNames. If CacheDir is not empty, the prototypes are read from a
+  // cache file in CacheDir, if one is up to date, instead of parsing the header
+  // files. Otherwise, the parsed prototypes are written to the cache file.
   static bool getExternalFunctionPrototype(std::vector<string> &FileNames,
                                            std::string &Target,
-                                           std::string &SysRoot);
+                                           std::string &SysRoot,
+                                           const std::string &CacheDir);
+
+  // Return the prototype of function Name, or nullptr if it is not known.
+  static const FunctionRetAndArgs *
+  getFunctionPrototype(const std::string &Name);
 
   static bool isExternalVariable(std::string Name);
 };
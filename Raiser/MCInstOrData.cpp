@@ -55,9 +55,9 @@ MCInstOrData &MCInstOrData::operator=(const MCInstOrData &E) {
     break;
   case Tag::INSTRUCTION:
     new (&Inst) MCInst(E.Inst);
-    Type = E.Type;
     break;
   }
+  Type = E.Type;
   return *this;
 }
 
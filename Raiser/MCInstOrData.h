@@ -33,7 +33,7 @@ public:
   MCInstOrData(const uint32_t V);
 
   uint32_t getData() const { return Data; }
-  MCInst getMCInst() const { return Inst; }
+  const MCInst &getMCInst() const { return Inst; }
   bool isData() const { return (Type == Tag::DATA); }
   bool isMCInst() const { return (Type == Tag::INSTRUCTION); }
 
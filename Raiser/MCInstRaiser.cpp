@@ -7,54 +7,83 @@
 //===----------------------------------------------------------------------===//
 
 #include "MCInstRaiser.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/CodeGen/MachineInstrBuilder.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
+#include <mutex>
 
 #define DEBUG_TYPE "mctoll"
 
 using namespace llvm;
 using namespace llvm::mctoll;
 
+STATISTIC(NumBlocksCreated, "Number of MachineBasicBlocks created");
+
+// CFG of different functions may be built concurrently (see --jobs). All
+// MachineFunctions share a single LLVMContext whose uniquing tables are not
+// thread-safe. Accesses to these are serialized using this lock. Only code that
+// cannot report an error or fail an assertion runs while it is held: with
+// --isolate-failures, such a failure leaves the recovery context without
+// unwinding and the lock would remain held. Warnings are printed to the
+// unbuffered errs() stream using a single write each.
+static std::mutex SharedStateMutex;
+
 void MCInstRaiser::buildCFG(MachineFunction &MF, const MCInstrAnalysis *MIA,
-                            const MCInstrInfo *MII) {
+                            const MCInstrInfo *MII, bool AddOffsetMetadata) {
   // Set the first instruction index as the entry of current MBB
-  // Walk the mcInstMap
+  // Walk the instruction stream
   //     a) if the current instruction is a target instruction
   //             record the (entry, current MBB) pair
   //             create a new MBB
   //             set current instruction index as entry of current MBB
   //     b) add raised MachineInstr to current MBB.
-  auto TargetIndicesEnd = TargetIndices.end();
   uint64_t CurMBBEntryInstIndex;
+  if (!AddOffsetMetadata)
+    MIToMCInstIndex.reserve(InstOffsets.size());
+  // MBBNumToMCInstTargets[mbbnum] is the list of indices of MCInsts that are
+  // targets of the last instruction of MachineBasicBlock number mbbnum.
+  std::vector<SmallVector<uint64_t, 2>> MBBNumToMCInstTargets;
+
+  // Record the targets of the MachineBasicBlock that is currently the last
+  // one in MF and the index of its entry instruction.
+  auto RecordLastMBB = [&](ArrayRef<uint64_t> MBBTargets) {
+    unsigned MBBNum = MF.back().getNumber();
+    if (MBBNumToMCInstTargets.size() <= MBBNum) {
+      MBBNumToMCInstTargets.resize(MBBNum + 1);
+      MBBNumToInst.resize(MBBNum + 1, -1);
+    }
+    MBBNumToMCInstTargets[MBBNum].assign(MBBTargets.begin(), MBBTargets.end());
+    if (InstToMBBNum.try_emplace(CurMBBEntryInstIndex, MBBNum).second)
+      MBBNumToInst[MBBNum] = CurMBBEntryInstIndex;
+  };
 
-  for (auto MCInstorDataIter = InstMap.begin();
-       MCInstorDataIter != InstMap.end(); MCInstorDataIter++) {
-    uint64_t MCInstIndex = MCInstorDataIter->first;
-    MCInstOrData MCInstorData = MCInstorDataIter->second;
+  for (size_t InstIdx = 0, NumInsts = InstOffsets.size(); InstIdx < NumInsts;
+       InstIdx++) {
+    uint64_t MCInstIndex = InstOffsets[InstIdx];
+    const MCInstOrData &MCInstorData = InstData[InstIdx];
 
     // If the current mcInst is a target of some instruction,
     // i) record the target of previous instruction and fall-through as
     //    needed.
     // ii) start a new MachineBasicBlock
-    if (TargetIndices.find(MCInstIndex) != TargetIndicesEnd) {
+    if (isTarget(MCInstIndex)) {
       // Create a map of curMBBEntryInstIndex to the current
       // MachineBasicBlock for use later to create control flow edges
       // - except when creating the first MBB.
       if (MF.size()) {
         // Find the target MCInst indices of the previous MCInst
-        uint64_t PrevMCInstIndex = std::prev(MCInstorDataIter)->first;
-        MCInstOrData PrevTextSecBytes = std::prev(MCInstorDataIter)->second;
-        std::vector<uint64_t> PrevMCInstTargets;
+        uint64_t PrevMCInstIndex = InstOffsets[InstIdx - 1];
+        const MCInstOrData &PrevTextSecBytes = InstData[InstIdx - 1];
+        SmallVector<uint64_t, 2> PrevMCInstTargets;
 
         // If handling a mcInst
         if (MCInstorData.isMCInst()) {
-          MCInst MCInstr = MCInstorData.getMCInst();
           // If this instruction is preceeded by mcInst
           if (PrevTextSecBytes.isMCInst()) {
-            MCInst PrevMCInst = PrevTextSecBytes.getMCInst();
+            const MCInst &PrevMCInst = PrevTextSecBytes.getMCInst();
             // If previous MCInst is a branch
             if (MIA->isBranch(PrevMCInst)) {
               uint64_t Target;
@@ -87,18 +116,12 @@ void MCInstRaiser::buildCFG(MachineFunction &MF, const MCInstrAnalysis *MIA,
               PrevMCInstTargets.push_back(MCInstIndex);
 
             // Add to MBB -> targets map
-            MBBNumToMCInstTargetsMap.insert(
-                std::make_pair(MF.back().getNumber(), PrevMCInstTargets));
-            InstToMBBNum.insert(
-                std::make_pair(CurMBBEntryInstIndex, MF.back().getNumber()));
+            RecordLastMBB(PrevMCInstTargets);
           } else {
             // This is preceded by data. Note that this mcInst is a target.
             // So need to start a new basic block
             // Add to MBB -> targets map
-            MBBNumToMCInstTargetsMap.insert(
-                std::make_pair(MF.back().getNumber(), PrevMCInstTargets));
-            InstToMBBNum.insert(
-                std::make_pair(CurMBBEntryInstIndex, MF.back().getNumber()));
+            RecordLastMBB(PrevMCInstTargets);
           }
         }
       }
@@ -106,13 +129,14 @@ void MCInstRaiser::buildCFG(MachineFunction &MF, const MCInstrAnalysis *MIA,
       // Add the new MBB to MachineFunction
       if (MCInstorData.isMCInst()) {
         MF.push_back(MF.CreateMachineBasicBlock());
+        ++NumBlocksCreated;
         CurMBBEntryInstIndex = MCInstIndex;
       }
     }
     if (MCInstorData.isMCInst()) {
       // Add raised MachineInstr to current MBB.
-      MF.back().push_back(
-          RaiseMCInst(*MII, MF, MCInstorData.getMCInst(), MCInstIndex));
+      MF.back().push_back(RaiseMCInst(*MII, MF, MCInstorData.getMCInst(),
+                                      MCInstIndex, AddOffsetMetadata));
     }
   }
 
@@ -120,11 +144,10 @@ void MCInstRaiser::buildCFG(MachineFunction &MF, const MCInstrAnalysis *MIA,
   if (MF.size()) {
     // If the terminating instruction of last MBB is a branch instruction,
     // ensure appropriate control flow edges are added.
-    std::vector<uint64_t> TermMCInstTargets;
-    auto MCIDMapIter = InstMap.rbegin();
-    if (MCIDMapIter != InstMap.rend()) {
-      uint64_t TermMCInstIndex = MCIDMapIter->first;
-      auto TermMCInst = MCIDMapIter->second.getMCInst();
+    SmallVector<uint64_t, 2> TermMCInstTargets;
+    if (!InstOffsets.empty() && InstData.back().isMCInst()) {
+      uint64_t TermMCInstIndex = InstOffsets.back();
+      const MCInst &TermMCInst = InstData.back().getMCInst();
       // The following code handles a situation where the text section ends with
       // an unconditional branch. In such situations, no fall-through target is
       // recorded in targetIndices since offset after the branch is not within
@@ -154,10 +177,7 @@ void MCInstRaiser::buildCFG(MachineFunction &MF, const MCInstrAnalysis *MIA,
         }
       }
     }
-    MBBNumToMCInstTargetsMap.insert(
-        std::make_pair(MF.back().getNumber(), TermMCInstTargets));
-    InstToMBBNum.insert(
-        std::make_pair(CurMBBEntryInstIndex, MF.back().getNumber()));
+    RecordLastMBB(TermMCInstTargets);
   }
 
   // Walk all MachineBasicBlocks in MF to add control flow edges
@@ -165,21 +185,22 @@ void MCInstRaiser::buildCFG(MachineFunction &MF, const MCInstrAnalysis *MIA,
   for (unsigned MBBIndex = 0; MBBIndex < MBBCount; MBBIndex++) {
     // Get the MBB
     MachineBasicBlock *CurrentMBB = MF.getBlockNumbered(MBBIndex);
-    std::map<uint64_t, std::vector<uint64_t>>::iterator Iter =
-        MBBNumToMCInstTargetsMap.find(MBBIndex);
-    assert(Iter != MBBNumToMCInstTargetsMap.end());
-    std::vector<uint64_t> TargetMCInstIndices = Iter->second;
-    for (auto MBBMCInstTgt : TargetMCInstIndices) {
-      std::map<uint64_t, uint64_t>::iterator TgtIter =
-          InstToMBBNum.find(MBBMCInstTgt);
+    assert(MBBIndex < MBBNumToMCInstTargets.size());
+    for (auto MBBMCInstTgt : MBBNumToMCInstTargets[MBBIndex]) {
+      auto TgtIter = InstToMBBNum.find(MBBMCInstTgt);
       // If the target is not found, it could be outside the function
       // being constructed.
       // TODO: Need to keep track of all such targets and link them in
       // a later global pass over all MachineFunctions of the module.
       if (TgtIter == InstToMBBNum.end()) {
-        outs() << "**** Warning : Index ";
-        outs().write_hex(MBBMCInstTgt);
-        outs() << " not found\n";
+        // Print the warning using a single write, as functions and inputs
+        // may be raised concurrently.
+        std::string Message;
+        raw_string_ostream OS(Message);
+        OS << "**** Warning : Index ";
+        OS.write_hex(MBBMCInstTgt);
+        OS << " not found\n";
+        errs() << OS.str();
       } else if (!MF.getBlockNumbered(MBBIndex)->isReturnBlock()) {
         MachineBasicBlock *Succ = MF.getBlockNumbered(TgtIter->second);
         CurrentMBB->addSuccessorWithoutProb(Succ);
@@ -201,13 +222,12 @@ static inline int64_t raiseSignedImm(int64_t Val, const DataLayout &DL) {
 }
 
 MachineInstr *MCInstRaiser::RaiseMCInst(const MCInstrInfo &InstrInfo,
-                                        MachineFunction &MF,
-                                        MCInst Inst, uint64_t InstIndex) {
+                                        MachineFunction &MF, const MCInst &Inst,
+                                        uint64_t InstIndex,
+                                        bool AddOffsetMetadata) {
   // Construct MachineInstr that is the raised abstraction of MCInstr
   const MCInstrDesc &InstrDesc = InstrInfo.get(Inst.getOpcode());
-  DebugLoc *DL = new DebugLoc();
-  MachineInstrBuilder Builder =
-      BuildMI(MF, *DL, InstrDesc);
+  MachineInstrBuilder Builder = BuildMI(MF, DebugLoc(), InstrDesc);
 
   // Get the number of declared MachineOperands for this
   // MachineInstruction and add them to the MachineInstr being
@@ -218,7 +238,7 @@ MachineInstr *MCInstRaiser::RaiseMCInst(const MCInstrInfo &InstrInfo,
   const unsigned int NumOperands = InstrDesc.getNumOperands();
   for (unsigned int Indx = 0; Indx < NumOperands; Indx++) {
     // Raise operand
-    MCOperand Operand = Inst.getOperand(Indx);
+    const MCOperand &Operand = Inst.getOperand(Indx);
     if (Operand.isImm()) {
       Builder.addImm(
           raiseSignedImm(Operand.getImm(), MF.getDataLayout()));
@@ -229,30 +249,26 @@ MachineInstr *MCInstRaiser::RaiseMCInst(const MCInstrInfo &InstrInfo,
       else
         Builder.addUse(Operand.getReg());
     } else {
-      outs() << "**** Unhandled Operand : ";
+      errs() << "**** Unhandled Operand\n";
       LLVM_DEBUG(Operand.dump());
     }
   }
 
+  if (!AddOffsetMetadata) {
+    MIToMCInstIndex[Builder.getInstr()] = InstIndex;
+    return Builder.getInstr();
+  }
+
   LLVMContext &C = MF.getFunction().getContext();
-  // Creation of MDNode representing Metadata with mcInstIndex may be done
-  // using the following couple of lines of code. But I just wanted to spell
-  // it out for better understanding.
-
-  // MDNode* temp_N = MDNode::get(C,
-  // ConstantAsMetadata::get(ConstantInt::get(C,
-  //                                                  llvm::APInt(64,
-  //                                                              mcInstIndex,
-  //                                                              false))));
-  // MDNode* N = MDNode::get(C, temp_N);
-
-  // Create arbitrary precision
-  // integer
-  llvm::APInt ArbPrecInt(64, InstIndex, false);
-  // Create ConstantAsMetadata
-  ConstantAsMetadata *CMD =
-      ConstantAsMetadata::get(ConstantInt::get(C, ArbPrecInt));
-  MDNode *N = MDNode::get(C, CMD);
+  // Record the offset of the MCInst as a metadata operand of the form
+  // !{i64 InstIndex}.
+  MDNode *N;
+  {
+    std::lock_guard<std::mutex> Lock(SharedStateMutex);
+    ConstantAsMetadata *CMD = ConstantAsMetadata::get(ConstantInt::get(
+        Type::getInt64Ty(C), InstIndex, /* isSigned */ false));
+    N = MDNode::get(C, CMD);
+  }
   Builder.addMetadata(N);
   return Builder.getInstr();
 }
@@ -260,11 +276,11 @@ MachineInstr *MCInstRaiser::RaiseMCInst(const MCInstrInfo &InstrInfo,
 void MCInstRaiser::dump(const MCInstPrinter *Printer,
                         StringRef Separator,
                         const MCRegisterInfo *RegInfo) const {
-  for (auto In : InstMap) {
-    uint64_t InstIndex = In.first;
-    MCInstOrData InstorData = In.second;
+  for (size_t InstIdx = 0, NumInsts = InstOffsets.size(); InstIdx < NumInsts;
+       InstIdx++) {
+    uint64_t InstIndex = InstOffsets[InstIdx];
     LLVM_DEBUG(dbgs() << "0x" << format("%016" PRIx64, InstIndex) << ": ");
-    LLVM_DEBUG(InstorData.dump(Printer, Separator, RegInfo));
+    LLVM_DEBUG(InstData[InstIdx].dump(Printer, Separator, RegInfo));
   }
 }
 
@@ -283,7 +299,20 @@ void MCInstRaiser::addMCInstOrData(uint64_t Index, MCInstOrData Inst) {
   if (Inst.isData() && !DataInCode)
     DataInCode = true;
 
-  InstMap.insert(std::make_pair(Index, Inst));
+  // Instructions are added in code stream order, except when symbols overlap.
+  if (InstOffsets.empty() || InstOffsets.back() < Index) {
+    InstOffsets.push_back(Index);
+    InstData.push_back(Inst);
+    return;
+  }
+
+  // Do not replace an instruction already recorded at Index.
+  auto Iter = std::lower_bound(InstOffsets.begin(), InstOffsets.end(), Index);
+  if (*Iter == Index)
+    return;
+  auto Pos = std::distance(InstOffsets.begin(), Iter);
+  InstOffsets.insert(Iter, Index);
+  InstData.insert(InstData.begin() + Pos, Inst);
 }
 
 int64_t MCInstRaiser::getMBBNumberOfMCInstOffset(uint64_t Offset,
@@ -297,9 +326,11 @@ int64_t MCInstRaiser::getMBBNumberOfMCInstOffset(uint64_t Offset,
   // MBBNo not found. Check to see if the Offset corresponds to a non-leading
   // instruction of any of the blocks. Such a situation may occur when this
   // function is called before noops are deleted.
-  for (auto N : InstToMBBNum) {
-    uint64_t CurMBBStartOffset = N.first;
-    uint64_t CurMBBNo = N.second;
+  for (size_t CurMBBNo = 0, E = MBBNumToInst.size(); CurMBBNo < E;
+       CurMBBNo++) {
+    if (MBBNumToInst[CurMBBNo] < 0)
+      continue;
+    uint64_t CurMBBStartOffset = MBBNumToInst[CurMBBNo];
     auto *CurMBB = MF.getBlockNumbered(CurMBBNo);
     unsigned CurMBBSizeinBytes = 0;
     for (const MachineInstr &I : CurMBB->instrs()) {
@@ -314,22 +345,18 @@ int64_t MCInstRaiser::getMBBNumberOfMCInstOffset(uint64_t Offset,
 }
 
 int64_t MCInstRaiser::getMCInstOffsetOfMBBNumber(uint64_t MBBNum) const {
-  auto Iter =
-      std::find_if(InstToMBBNum.begin(), InstToMBBNum.end(),
-                   [MBBNum](auto &&Item) { return Item.second == MBBNum; });
-
-  if (Iter != InstToMBBNum.end())
-    return Iter->first;
+  if (MBBNum < MBBNumToInst.size())
+    return MBBNumToInst[MBBNum];
   return -1;
 }
 
 uint64_t MCInstRaiser::getMCInstSize(uint64_t Offset) const {
-  const_mcinst_iter Iter = InstMap.find(Offset);
-  const_mcinst_iter End = InstMap.end();
-  assert(Iter != End && "Attempt to find MCInst at non-existent offset");
+  auto Iter = std::lower_bound(InstOffsets.begin(), InstOffsets.end(), Offset);
+  assert(Iter != InstOffsets.end() && *Iter == Offset &&
+         "Attempt to find MCInst at non-existent offset");
 
-  if (Iter.operator++() != End) {
-    uint64_t NextOffset = (*Iter).first;
+  if (++Iter != InstOffsets.end()) {
+    uint64_t NextOffset = *Iter;
     return NextOffset - Offset;
   }
 
@@ -339,11 +366,28 @@ uint64_t MCInstRaiser::getMCInstSize(uint64_t Offset) const {
   return FuncEnd - Offset;
 }
 
-uint64_t MCInstRaiser::getMCInstIndex(const MachineInstr &MI) const {
+// Return the operand of MI that holds the offset metadata, if MI was raised
+// with offset metadata.
+static const MachineOperand &getOffsetMetadataOperand(const MachineInstr &MI) {
   unsigned NumExpOps = MI.getNumExplicitOperands();
-  const MachineOperand &MO = NumExpOps < MI.getNumOperands()
-                                 ? MI.getOperand(NumExpOps)
-                                 : MI.getOperand(MI.getNumOperands() - 1);
+  return NumExpOps < MI.getNumOperands()
+             ? MI.getOperand(NumExpOps)
+             : MI.getOperand(MI.getNumOperands() - 1);
+}
+
+bool MCInstRaiser::hasMCInstIndex(const MachineInstr &MI) const {
+  if (MIToMCInstIndex.count(&MI))
+    return true;
+  return MI.getNumOperands() > 0 && getOffsetMetadataOperand(MI).isMetadata();
+}
+
+uint64_t MCInstRaiser::getMCInstIndex(const MachineInstr &MI) const {
+  auto Iter = MIToMCInstIndex.find(&MI);
+  if (Iter != MIToMCInstIndex.end())
+    return Iter->second;
+
+  // Get the offset from the metadata operand of MI.
+  const MachineOperand &MO = getOffsetMetadataOperand(MI);
   assert(MO.isMetadata() &&
          "Unexpected non-metadata operand in branch instruction");
   const MDNode *MDN = MO.getMetadata();
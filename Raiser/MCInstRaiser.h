@@ -10,11 +10,13 @@
 #define LLVM_TOOLS_LLVM_MCTOLL_MCINSTRAISER_H
 
 #include "MCInstOrData.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/MC/MCInstrAnalysis.h"
-#include <map>
-#include <set>
+#include <algorithm>
+#include <iterator>
 #include <utility>
 #include <vector>
 
@@ -24,7 +26,59 @@ namespace mctoll {
 // Class that encapsulates raising for MCInst vector to MachineInstrs
 class MCInstRaiser {
 public:
-  using const_mcinst_iter = std::map<uint64_t, MCInstOrData>::const_iterator;
+  /// Iterator over the (offset, MCInstOrData) pairs of the instruction
+  /// stream, in the order of offsets. The pairs are materialized on
+  /// dereference since offsets and instructions are stored separately.
+  class const_mcinst_iter {
+  public:
+    using value_type = std::pair<uint64_t, const MCInstOrData &>;
+    using reference = value_type;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::bidirectional_iterator_tag;
+
+    struct pointer {
+      value_type Pair;
+      const value_type *operator->() const { return &Pair; }
+    };
+
+    const_mcinst_iter() : MCIR(nullptr), Idx(0) {}
+    const_mcinst_iter(const MCInstRaiser *R, size_t I) : MCIR(R), Idx(I) {}
+
+    reference operator*() const {
+      return value_type(MCIR->InstOffsets[Idx], MCIR->InstData[Idx]);
+    }
+    pointer operator->() const { return pointer{**this}; }
+
+    const_mcinst_iter &operator++() {
+      ++Idx;
+      return *this;
+    }
+    const_mcinst_iter operator++(int) {
+      const_mcinst_iter Tmp = *this;
+      ++Idx;
+      return Tmp;
+    }
+    const_mcinst_iter &operator--() {
+      --Idx;
+      return *this;
+    }
+    const_mcinst_iter operator--(int) {
+      const_mcinst_iter Tmp = *this;
+      --Idx;
+      return Tmp;
+    }
+
+    bool operator==(const const_mcinst_iter &RHS) const {
+      return MCIR == RHS.MCIR && Idx == RHS.Idx;
+    }
+    bool operator!=(const const_mcinst_iter &RHS) const {
+      return !(*this == RHS);
+    }
+
+  private:
+    const MCInstRaiser *MCIR;
+    size_t Idx;
+  };
 
   MCInstRaiser(uint64_t Start, uint64_t End)
       : FuncStart(Start), FuncEnd(End), DataInCode(false){};
@@ -33,15 +87,33 @@ public:
     // Add targetIndex only if it falls within the function start and end
     if (!((TargetIndex >= FuncStart) && (TargetIndex <= FuncEnd)))
       return;
-    TargetIndices.insert(TargetIndex);
+    uint64_t Bit = TargetIndex - FuncStart;
+    if (Targets.size() <= Bit)
+      Targets.resize(Bit + 1);
+    Targets.set(Bit);
   }
 
   void addMCInstOrData(uint64_t Index, MCInstOrData MCInst);
+  // Reserve space for N more MCInsts or data
+  void reserve(size_t N) {
+    InstOffsets.reserve(InstOffsets.size() + N);
+    InstData.reserve(InstData.size() + N);
+  }
 
+  // Build the CFG of MF by raising the MCInsts to MachineInstrs. The offset of
+  // the MCInst of each MachineInstr is recorded in a side table. If
+  // AddOffsetMetadata is true, it is also attached to the MachineInstr as a
+  // metadata operand.
   void buildCFG(MachineFunction &MF, const MCInstrAnalysis *MIA,
-                const MCInstrInfo *MII);
-
-  std::set<uint64_t> getTargetIndices() const { return TargetIndices; }
+                const MCInstrInfo *MII, bool AddOffsetMetadata = true);
+
+  // Is Index recorded as a target?
+  bool isTarget(uint64_t Index) const {
+    if (Index < FuncStart)
+      return false;
+    uint64_t Bit = Index - FuncStart;
+    return (Bit < Targets.size()) && Targets.test(Bit);
+  }
   uint64_t getFuncStart() const { return FuncStart; }
   uint64_t getFuncEnd() const { return FuncEnd; }
   // Change the value of function end to a new value greater than current value
@@ -74,16 +146,30 @@ public:
   // Returns the iterator pointing to MCInstOrData at Offset in
   // input instruction stream.
   const_mcinst_iter getMCInstAt(uint64_t Offset) const {
-    return InstMap.find(Offset);
+    auto Iter =
+        std::lower_bound(InstOffsets.begin(), InstOffsets.end(), Offset);
+    if (Iter == InstOffsets.end() || *Iter != Offset)
+      return const_mcinstr_end();
+    return const_mcinst_iter(this, std::distance(InstOffsets.begin(), Iter));
   }
 
-  const_mcinst_iter const_mcinstr_begin() const { return InstMap.begin(); }
-  const_mcinst_iter const_mcinstr_end() const { return InstMap.end(); }
+  const_mcinst_iter const_mcinstr_begin() const {
+    return const_mcinst_iter(this, 0);
+  }
+  const_mcinst_iter const_mcinstr_end() const {
+    return const_mcinst_iter(this, InstOffsets.size());
+  }
 
   // Get the size of instruction
   uint64_t getMCInstSize(uint64_t Offset) const;
 
   uint64_t getMCInstIndex(const MachineInstr &MI) const;
+  // Return true if MI corresponds to an MCInst, i.e., if getMCInstIndex can be
+  // called for MI.
+  bool hasMCInstIndex(const MachineInstr &MI) const;
+  // Forget the MCInst offset of MI, which is about to be deleted, so that a
+  // MachineInstr later allocated at its address does not inherit it.
+  void forgetMCInstIndex(const MachineInstr &MI) { MIToMCInstIndex.erase(&MI); }
 
 private:
   // NOTE: The following data structures are implemented to record instruction
@@ -92,21 +178,32 @@ private:
   //       per instruction - given the ratio of control flow instructions is
   //       not high, in general. However, it is important to populate the target
   //       information during binary parse time AND is not duplicated.
-  // A sequential list of source MCInsts or 32-bit data with corresponding index
-  // Iteration over std::map contents is in non-descending order of keys. So,
-  // the order in the map is guaranteed to be the order of instructions in the
-  // insertion order i.e., code stream order.
-  std::map<uint64_t, MCInstOrData> InstMap;
-  // All targets recorded in a set to avoid duplicate entries
-  std::set<uint64_t> TargetIndices;
+  // Sorted offsets of the source MCInsts or 32-bit data in the instruction
+  // stream. Instructions are usually added in code stream order. So, new
+  // entries are appended in the common case.
+  std::vector<uint64_t> InstOffsets;
+  // InstData[I] is the MCInst or 32-bit data at offset InstOffsets[I]. The
+  // two vectors are kept separate so that offset lookups do not touch the
+  // comparatively large MCInst objects.
+  std::vector<MCInstOrData> InstData;
+  // Bitmap of targets. Bit I is set if offset FuncStart + I is a target.
+  BitVector Targets;
   // A map of MCInst index, mci, to MachineBasicBlock number, mbbnum. The first
   // instruction of MachineBasicBlock number mbbnum is the MachineInstr
   // representation of the MCinst at the index, mci
-  std::map<uint64_t, uint64_t> InstToMBBNum;
-
-  std::map<uint64_t, std::vector<uint64_t>> MBBNumToMCInstTargetsMap;
-  MachineInstr *RaiseMCInst(const MCInstrInfo &, MachineFunction &, MCInst,
-                            uint64_t);
+  DenseMap<uint64_t, unsigned> InstToMBBNum;
+  // MBBNumToInst[mbbnum] is the index, mci, of the MCInst whose MachineInstr
+  // representation is the first instruction of MachineBasicBlock number
+  // mbbnum; or -1 if there is no such MCInst.
+  std::vector<int64_t> MBBNumToInst;
+
+  // Offsets of the MCInsts of MachineInstrs raised without offset metadata.
+  // Raisers that delete a MachineInstr call forgetMCInstIndex before doing so,
+  // as the memory of deleted MachineInstrs is recycled.
+  DenseMap<const MachineInstr *, uint64_t> MIToMCInstIndex;
+
+  MachineInstr *RaiseMCInst(const MCInstrInfo &, MachineFunction &,
+                            const MCInst &, uint64_t, bool);
   // Start and End offsets of the array of MCInsts in mcInstVector
   uint64_t FuncStart;
   uint64_t FuncEnd;
@@ -7,20 +7,52 @@
 //===----------------------------------------------------------------------===//
 
 #include "MachineFunctionRaiser.h"
+#include "RaiserStatistics.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
 
+#define DEBUG_TYPE "mctoll"
+
 using namespace llvm::mctoll;
 
+STATISTIC(NumFunctionsOverBudget,
+          "Number of functions emitted as declarations for exceeding budget");
+
 bool MachineFunctionRaiser::runRaiserPasses() {
   bool Success = false;
   // Raise MCInst to MachineInstr and Build CFG
-  if (MachineInstRaiser != nullptr)
-    Success = MachineInstRaiser->raise();
+  if (MachineInstRaiser != nullptr) {
+    FunctionBudget &Budget = MachineInstRaiser->getBudget();
+    if (Budget.start(MF))
+      Success = MachineInstRaiser->raise();
+    // Check the size of the function raised by targets that do not check the
+    // budget while raising.
+    if (Success)
+      Budget.isWithinBudget(getRaisedFunction()->getInstructionCount());
+    if (Budget.isExceeded()) {
+      StringRef Reason = Budget.getExceededReason();
+      errs() << "warning: function " << MF.getName()
+             << " exceeded its raising budget (" << Reason
+             << "); emitting a declaration\n";
+      ++NumFunctionsOverBudget;
+      RaiserStatistics::recordBudgetExceeded(MF.getName(), Reason);
+      discardRaisedFunctionBody();
+      return false;
+    }
+  }
 
   cleanupRaisedFunction();
   return Success;
 }
 
+// Discard the partially raised body of the raised function, leaving a
+// declaration with the discovered prototype.
+void MachineFunctionRaiser::discardRaisedFunctionBody() {
+  if (Function *RF = getRaisedFunction())
+    RF->deleteBody();
+}
+
 // Cleanup empty basic blocks from raised function
 void MachineFunctionRaiser::cleanupRaisedFunction() {
   Function *RF = getRaisedFunction();
@@ -44,3 +76,5 @@ Function *MachineFunctionRaiser::getRaisedFunction() {
 void MachineFunctionRaiser::setRaisedFunction(Function *RF) {
   return MachineInstRaiser->setRaisedFunction(RF);
 }
+
+#undef DEBUG_TYPE
@@ -43,6 +43,10 @@ public:
 
   bool runRaiserPasses();
 
+  // Discard the body of raised function, if any, leaving a declaration with
+  // its prototype. Used when raising the function did not complete.
+  void discardRaisedFunctionBody();
+
   MachineFunction &getMachineFunction() const { return MF; }
 
   // Getters
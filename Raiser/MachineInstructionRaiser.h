@@ -15,8 +15,10 @@
 #ifndef LLVM_TOOLS_LLVM_MCTOLL_MACHINEINSTRUCTIONRAISER_H
 #define LLVM_TOOLS_LLVM_MCTOLL_MACHINEINSTRUCTIONRAISER_H
 
+#include "Raiser/FunctionBudget.h"
 #include "Raiser/MCInstRaiser.h"
 #include "Raiser/ModuleRaiser.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Operator.h"
@@ -52,6 +54,15 @@ public:
 
   virtual bool raise() { return true; };
   virtual FunctionType *getRaisedFunctionPrototype() = 0;
+  /// Add the MachineFunctionRaisers of the functions of the module that are
+  /// direct call targets of MF to Callees. Prototypes of Callees are
+  /// constructed before that of MF, if possible.
+  virtual void
+  collectCallees(SmallPtrSetImpl<MachineFunctionRaiser *> &Callees) {}
+  /// Discard the raised function prototype, if any, such that the next call
+  /// to getRaisedFunctionPrototype() constructs it again. Return false if
+  /// not supported.
+  virtual bool discardRaisedFunctionPrototype() { return false; }
   virtual int getArgumentNumber(unsigned PReg) = 0;
   virtual Value *getRegOrArgValue(unsigned PReg, int MBBNo) = 0;
   virtual bool buildFuncArgTypeVector(const std::set<MCPhysReg> &,
@@ -60,6 +71,7 @@ public:
   Function *getRaisedFunction() { return RaisedFunction; }
   void setRaisedFunction(Function *RF) { RaisedFunction = RF; }
   MCInstRaiser *getMCInstRaiser() { return InstRaiser; }
+  FunctionBudget &getBudget() { return Budget; }
   MachineFunction &getMF() { return MF; };
   const ModuleRaiser *getModuleRaiser() { return MR; }
 
@@ -106,6 +118,9 @@ protected:
   Function *RaisedFunction;
   MCInstRaiser *InstRaiser;
   const ModuleRaiser *MR;
+  // Budget of raising MF. Targets check it while raising to stop raising a
+  // function that exceeds it.
+  FunctionBudget Budget;
 
   // A vector of information to be used for raising of control transfer
   // (i.e., Call and Terminator) instructions.
@@ -10,8 +10,17 @@
 #include "ModuleRaiser.h"
 #include "MachineFunctionRaiser.h"
 #include "MachineInstructionRaiser.h"
+#include "RaiserStatistics.h"
+#include "llvm-mctoll.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/Support/CrashRecoveryContext.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/WithColor.h"
 
 
@@ -21,34 +30,42 @@ using namespace llvm;
 using namespace llvm::object;
 using namespace llvm::mctoll;
 
+STATISTIC(NumPrototypesReconstructed,
+          "Number of prototypes reconstructed in recursive call graph SCCs");
+STATISTIC(NumFunctionsFailed,
+          "Number of functions emitted as declarations after failing to raise");
+
 StringRef mctoll::ToolName;
 
+// Errors are reported using sys::Process::Exit, which returns to the recovery
+// context of a function being raised with --isolate-failures, if any, instead
+// of exiting.
 void mctoll::error(std::error_code EC) {
   if (!EC)
     return;
 
   errs() << ToolName << ": error reading file: " << EC.message() << ".\n";
   errs().flush();
-  exit(1);
+  sys::Process::Exit(1);
 }
 
 void mctoll::error(Error E) {
   if (!E)
     return;
   WithColor::error(errs(), ToolName) << toString(std::move(E));
-  exit(1);
+  sys::Process::Exit(1);
 }
 
 [[noreturn]] void mctoll::error(Twine Message) {
   errs() << ToolName << ": " << Message << ".\n";
   errs().flush();
-  exit(1);
+  sys::Process::Exit(1);
 }
 
 [[noreturn]] void mctoll::reportError(StringRef File, Twine Message) {
   WithColor::error(errs(), ToolName)
       << "'" << File << "': " << Message << ".\n";
-  exit(1);
+  sys::Process::Exit(1);
 }
 
 [[noreturn]] void mctoll::reportError(Error E, StringRef File) {
@@ -58,7 +75,7 @@ void mctoll::error(Error E) {
   logAllUnhandledErrors(std::move(E), OS);
   OS.flush();
   WithColor::error(errs(), ToolName) << "'" << File << "': " << Buf;
-  exit(1);
+  sys::Process::Exit(1);
 }
 
 [[noreturn]] void mctoll::reportError(Error E, StringRef ArchiveName,
@@ -77,7 +94,7 @@ void mctoll::error(Error E) {
   logAllUnhandledErrors(std::move(E), OS);
   OS.flush();
   errs() << ": " << Buf;
-  exit(1);
+  sys::Process::Exit(1);
 }
 
 [[noreturn]] void mctoll::reportError(Error E, StringRef ArchiveName,
@@ -94,89 +111,134 @@ void mctoll::error(Error E) {
     reportError(std::move(E), ArchiveName, NameOrErr.get(), ArchitectureName);
 }
 
-// raiser registry context
-static SmallVector<ModuleRaiser *, 4> ModuleRaiserRegistry;
+// raiser registry context. A ModuleRaiser holds the state of raising one
+// module. So, the registry records the function that creates ModuleRaisers of
+// each supported architecture.
+static SmallVector<std::pair<Triple::ArchType, ModuleRaiserCtorTy>, 4>
+    ModuleRaiserRegistry;
 
 bool mctoll::isSupportedArch(Triple::ArchType Arch) {
-  for (auto *M : ModuleRaiserRegistry)
-    if (M->getArchType() == Arch)
+  for (const auto &Entry : ModuleRaiserRegistry)
+    if (Entry.first == Arch)
       return true;
 
   return false;
 }
 
-ModuleRaiser *mctoll::getModuleRaiser(const TargetMachine *TM) {
-  ModuleRaiser *MR = nullptr;
+std::unique_ptr<ModuleRaiser>
+mctoll::createModuleRaiser(const TargetMachine *TM) {
   auto Arch = TM->getTargetTriple().getArch();
-  for (auto *M : ModuleRaiserRegistry)
-    if (M->getArchType() == Arch) {
-      MR = M;
-      break;
-    }
-  assert(nullptr != MR && "This arch has not yet supported for raising!\n");
-  return MR;
+  for (const auto &Entry : ModuleRaiserRegistry)
+    if (Entry.first == Arch)
+      return std::unique_ptr<ModuleRaiser>(Entry.second());
+  assert(false && "This arch has not yet supported for raising!\n");
+  return nullptr;
 }
 
-void mctoll::registerModuleRaiser(ModuleRaiser *M) {
-  ModuleRaiserRegistry.push_back(M);
+void mctoll::registerModuleRaiser(Triple::ArchType Arch,
+                                  ModuleRaiserCtorTy Ctor) {
+  assert(!isSupportedArch(Arch) && "Module raiser registered twice");
+  ModuleRaiserRegistry.emplace_back(Arch, Ctor);
 }
 
 Function *ModuleRaiser::getRaisedFunctionAt(uint64_t Index) const {
-  int64_t TextSecAddr = getTextSectionAddress();
-  for (auto *MFR : MFRaiserVector)
-    if ((MFR->getMCInstRaiser()->getFuncStart() + TextSecAddr) == Index)
-      return MFR->getRaisedFunction();
+  MachineFunctionRaiser *MFR = getMFRaiserAt(Index);
+  if (MFR != nullptr)
+    return MFR->getRaisedFunction();
 
   return nullptr;
 }
 
-const RelocationRef *ModuleRaiser::getDynRelocAtOffset(uint64_t Loc) const {
-  if (DynRelocs.empty())
+MachineFunctionRaiser *ModuleRaiser::getMFRaiserAt(uint64_t Index) const {
+  uint64_t FuncStart = Index - getTextSectionAddress();
+  // Values reserved by DenseMap are not valid function start offsets.
+  if (FuncStart == DenseMapInfo<uint64_t>::getEmptyKey() ||
+      FuncStart == DenseMapInfo<uint64_t>::getTombstoneKey())
     return nullptr;
 
-  auto RelocIter = std::find_if(
-      DynRelocs.begin(), DynRelocs.end(),
-      [Loc](const RelocationRef &A) -> bool { return (A.getOffset() == Loc); });
-  if (RelocIter != DynRelocs.end())
-    return &(*RelocIter);
+  auto Iter = FunctionStartMap.find(FuncStart);
+  if (Iter != FunctionStartMap.end())
+    return Iter->second;
 
   return nullptr;
 }
 
+const RelocationRef *ModuleRaiser::getDynRelocAtOffset(uint64_t Loc) const {
+  return Relocs.findDynamicRelocation(Loc);
+}
+
 // Return relocation whose offset is in the range [Index, Index+Size)
 const RelocationRef *ModuleRaiser::getTextRelocAtOffset(uint64_t Index,
                                                         uint64_t Size) const {
-  if (TextRelocs.empty())
-    return nullptr;
-
-  auto RelocIter = std::find_if(TextRelocs.begin(), TextRelocs.end(),
-                                [Index, Size](const RelocationRef &A) -> bool {
-                                  return ((A.getOffset() >= Index) &&
-                                          (A.getOffset() < (Index + Size)));
-                                });
-  if (RelocIter != TextRelocs.end())
-    return &(*RelocIter);
-
-  return nullptr;
+  return Relocs.findTextRelocation(Index, Index + Size);
 }
 
 Function *ModuleRaiser::getCalledFunctionUsingTextReloc(uint64_t Loc,
                                                         uint64_t Size) const {
+  // The prototype of a function called by a function in the same call graph
+  // SCC may not yet have been constructed.
+  MachineFunctionRaiser *MFR = getMFRaiserUsingTextReloc(Loc, Size);
+  if (MFR != nullptr)
+    return MFR->getRaisedFunction();
+  return nullptr;
+}
+
+MachineFunctionRaiser *
+ModuleRaiser::getMFRaiserUsingTextReloc(uint64_t Loc, uint64_t Size) const {
   // Find the text relocation with offset in the range [Loc, Loc+Size)
-  const RelocationRef *TextReloc = getTextRelocAtOffset(Loc, Loc + Size);
+  const RelocationRef *TextReloc = getTextRelocAtOffset(Loc, Size);
   if (TextReloc != nullptr) {
     Expected<StringRef> Sym = TextReloc->getSymbol()->getName();
     assert(Sym && "Failed to find call target symbol");
-    for (auto *MFR : MFRaiserVector) {
-      Function *F = MFR->getRaisedFunction();
-      assert(F && "Unexpected null function pointer encountered");
-      if (Sym->equals(F->getName()))
-        return F;
-    }
+    auto Iter = FunctionNameMap.find(*Sym);
+    if (Iter != FunctionNameMap.end())
+      return Iter->second;
   }
   return nullptr;
 }
 
+namespace {
+/// Node of the call graph of the functions of the module.
+struct CallGraphNode {
+  MachineFunctionRaiser *MFR = nullptr;
+  std::vector<CallGraphNode *> Callees;
+};
+
+/// Call graph of the functions of the module, with a root node that calls all
+/// functions.
+struct ModuleCallGraph {
+  std::vector<CallGraphNode> Nodes;
+  CallGraphNode Root;
+};
+} // end anonymous namespace
+
+namespace llvm {
+template <> struct GraphTraits<ModuleCallGraph *> {
+  using NodeRef = CallGraphNode *;
+  using ChildIteratorType = std::vector<CallGraphNode *>::iterator;
+
+  static NodeRef getEntryNode(ModuleCallGraph *CG) { return &CG->Root; }
+  static ChildIteratorType child_begin(NodeRef N) { return N->Callees.begin(); }
+  static ChildIteratorType child_end(NodeRef N) { return N->Callees.end(); }
+};
+} // end namespace llvm
+
+// Construct the prototype of the function of MFR, if not already constructed,
+// and record the MachineFunctionRaiser of the raised function. Return the
+// type of the raised function; or nullptr if it could not be constructed.
+FunctionType *
+ModuleRaiser::buildRaisedFunctionPrototype(MachineFunctionRaiser *MFR) {
+  LLVM_DEBUG(dbgs() << "Build Prototype for : "
+                    << MFR->getMachineFunction().getName().data() << "\n");
+  RaiserStatistics::FunctionPhaseRegion Region(
+      RaiserPhase::PrototypeDiscovery, MFR->getMachineFunction().getName());
+  FunctionType *FT = MFR->getMachineInstrRaiser()->getRaisedFunctionPrototype();
+  Function *RF = MFR->getRaisedFunction();
+  if (RF != nullptr)
+    RaisedFunctionMap[RF] = MFR;
+  return FT;
+}
+
 bool ModuleRaiser::runMachineFunctionPasses() {
   bool Success = true;
 
@@ -188,44 +250,173 @@ bool ModuleRaiser::runMachineFunctionPasses() {
   }
 
   // For each of the functions, run passes to set up for instruction raising.
-  for (auto *MFR : MFRaiserVector) {
-    // 1. Build CFG
+  // 1. Build CFG
+  // Building CFG of a function only populates its own MachineFunction. So,
+  // CFGs of all functions may be built concurrently, if requested. MIA and MII
+  // are only read. The order of the MachineFunctions and their contents is
+  // independent of the number of jobs used. Debug output is not interleaved
+  // when -debug is specified by building the CFGs sequentially.
+  bool AddOffsetMetadata = needsMCInstOffsetMetadata();
+  int64_t TextSectionAddress = Obj->isELF() ? getTextSectionAddress() : 0;
+  auto BuildCFG = [this, AddOffsetMetadata,
+                   TextSectionAddress](MachineFunctionRaiser *MFR) {
+    MachineFunction &MF = MFR->getMachineFunction();
     MCInstRaiser *MCIR = MFR->getMCInstRaiser();
+    RaiserStatistics::FunctionPhaseRegion Region(RaiserPhase::BuildCFG,
+                                                 MF.getName());
     // Populates the MachineFunction with CFG.
-    MCIR->buildCFG(MFR->getMachineFunction(), MIA, MII);
+    MCIR->buildCFG(MF, MIA, MII, AddOffsetMetadata);
+    if (RaiserStatistics::isEnabled()) {
+      uint64_t NumInstrs = 0;
+      for (const MachineBasicBlock &MBB : MF)
+        NumInstrs += MBB.size();
+      RaiserStatistics::recordFunctionSize(
+          MF.getName(), MCIR->getFuncStart() + TextSectionAddress, NumInstrs,
+          MF.size());
+    }
+  };
+
+  {
+    RaiserStatistics::PhaseRegion Region(RaiserPhase::BuildCFG);
+    if (NumJobs == 1 || MFRaiserVector.size() < 2 || llvm::DebugFlag) {
+      for (auto *MFR : MFRaiserVector)
+        BuildCFG(MFR);
+    } else {
+      ThreadPool Pool(hardware_concurrency(NumJobs));
+      for (auto *MFR : MFRaiserVector)
+        Pool.async([&BuildCFG, MFR]() { BuildCFG(MFR); });
+      Pool.wait();
+    }
+  }
+
+  // Record the MachineFunctionRaiser of each function name and function start
+  // offset, for lookup of call targets by symbol name and by address.
+  FunctionNameMap.clear();
+  FunctionStartMap.clear();
+  for (auto *MFR : MFRaiserVector) {
+    FunctionNameMap.try_emplace(MFR->getMachineFunction().getName(), MFR);
+    FunctionStartMap.try_emplace(MFR->getMCInstRaiser()->getFuncStart(), MFR);
   }
 
   // Construct function prototypes for each of the MachineFunctions.
   // Knowing the function prototypes prior to raising the instructions
   // facilitates raising of call instructions whose targets are within
-  // the current module.
-  // Iterate the MachineFunctions twice to determine the prototypes of functions
-  // that might call those whose prototypes were not yet constructed.
-  bool AllPrototypesConstructed;
-  const int IterCount = 2;
-  for (int Idx = 0; Idx < IterCount; Idx++) {
-    AllPrototypesConstructed = true;
-    for (auto *MFR : MFRaiserVector) {
-      LLVM_DEBUG(dbgs() << "Build Prototype for : "
-                        << MFR->getMachineFunction().getName().data() << "\n");
-      Function *RF = MFR->getRaisedFunction();
-      if (RF == nullptr) {
-        FunctionType *FT =
-            MFR->getMachineInstrRaiser()->getRaisedFunctionPrototype();
-        AllPrototypesConstructed |= (FT != nullptr);
-      }
+  // the current module. Prototype discovery of a function uses the
+  // prototypes of its callees. So, prototypes are constructed bottom-up over
+  // the SCCs of the call graph, such that the prototypes of callees are known
+  // except for those of callees in the same SCC.
+  // NOTE: Prototype discovery creates types and functions in the shared
+  // Module and LLVMContext. Hence, SCCs are processed sequentially.
+  {
+    RaiserStatistics::PhaseRegion Region(RaiserPhase::PrototypeDiscovery);
+    ModuleCallGraph CG;
+    CG.Nodes.resize(MFRaiserVector.size());
+    DenseMap<MachineFunctionRaiser *, CallGraphNode *> NodeMap;
+    for (size_t Idx = 0; Idx < MFRaiserVector.size(); Idx++) {
+      CG.Nodes[Idx].MFR = MFRaiserVector[Idx];
+      NodeMap[MFRaiserVector[Idx]] = &CG.Nodes[Idx];
+      CG.Root.Callees.push_back(&CG.Nodes[Idx]);
     }
-    LLVM_DEBUG(dbgs() << "Raised Function Prototypes: \n");
-    LLVM_DEBUG({
-      for (auto MFR : MFRaiserVector) {
-        MFR->getRaisedFunction()->dump();
+    for (CallGraphNode &Node : CG.Nodes) {
+      SmallPtrSet<MachineFunctionRaiser *, 8> Callees;
+      Node.MFR->getMachineInstrRaiser()->collectCallees(Callees);
+      for (MachineFunctionRaiser *Callee : Callees)
+        Node.Callees.push_back(NodeMap.lookup(Callee));
+      // Nodes are allocated in the order of MFRaiserVector. Sort the callees
+      // in that order to keep the traversal independent of the order of
+      // pointers in Callees.
+      llvm::sort(Node.Callees);
+    }
+
+    for (auto SCCIter = scc_begin(&CG); !SCCIter.isAtEnd(); ++SCCIter) {
+      const std::vector<CallGraphNode *> &SCC = *SCCIter;
+      // Skip the root node
+      if (SCC.front()->MFR == nullptr)
+        continue;
+
+      for (CallGraphNode *Node : SCC)
+        buildRaisedFunctionPrototype(Node->MFR);
+
+      if (!SCCIter.hasCycle())
+        continue;
+
+      // Prototypes of the functions in a recursive SCC are constructed
+      // without knowing those of the callees constructed later. Reconstruct
+      // them till none of them change.
+      const unsigned MaxSCCPasses = SCC.size() + 1;
+      bool Changed = true;
+      for (unsigned Pass = 1; Changed && Pass < MaxSCCPasses; Pass++) {
+        Changed = false;
+        for (CallGraphNode *Node : SCC) {
+          MachineInstructionRaiser *MIR = Node->MFR->getMachineInstrRaiser();
+          Function *RF = MIR->getRaisedFunction();
+          FunctionType *OldFT = RF ? RF->getFunctionType() : nullptr;
+          if (RF != nullptr)
+            RaisedFunctionMap.erase(RF);
+          if (!MIR->discardRaisedFunctionPrototype()) {
+            // Prototypes can not be reconstructed; keep the existing one.
+            if (RF != nullptr)
+              RaisedFunctionMap[RF] = Node->MFR;
+            continue;
+          }
+          ++NumPrototypesReconstructed;
+          Changed |= (buildRaisedFunctionPrototype(Node->MFR) != OldFT);
+        }
       }
-    });
+    }
+
+    // Retry construction of prototypes that could not be constructed, now
+    // that the prototypes of all other functions are known. Functions whose
+    // prototype still can not be constructed, e.g., as their return type is
+    // not known, are left to the instruction raiser.
+    for (auto *MFR : MFRaiserVector)
+      if (MFR->getRaisedFunction() == nullptr)
+        buildRaisedFunctionPrototype(MFR);
+  }
+
+  LLVM_DEBUG(dbgs() << "Raised Function Prototypes: \n");
+  LLVM_DEBUG({
+    for (auto MFR : MFRaiserVector) {
+      if (Function *RF = MFR->getRaisedFunction())
+        RF->dump();
+    }
+  });
+  // Run instruction raiser passes. Raising a function creates types, constants,
+  // global variables and function declarations in the shared Module and
+  // LLVMContext. Hence, functions are raised sequentially.
+  RaiserStatistics::PhaseRegion Region(RaiserPhase::Raise);
+  for (auto *MFR : MFRaiserVector) {
+    StringRef FuncName = MFR->getMachineFunction().getName();
+    {
+      RaiserStatistics::FunctionPhaseRegion FunctionRegion(RaiserPhase::Raise,
+                                                           FuncName);
+      if (IsolateFailures) {
+        // Raise the function in a recovery context so that a crash, failed
+        // assertion or reported error only loses the function being raised.
+        CrashRecoveryContext CRC;
+        bool Raised = false;
+        bool Completed =
+            CRC.RunSafely([&]() { Raised = MFR->runRaiserPasses(); });
+        // A function that uses an instruction the raiser does not handle is
+        // left partially raised. A function that exceeded its budget is
+        // already a declaration.
+        Function *RF = MFR->getRaisedFunction();
+        if (Completed && (Raised || RF == nullptr || RF->isDeclaration())) {
+          Success |= Raised;
+        } else {
+          WithColor::warning(errs(), ToolName)
+              << "failed to raise function " << FuncName
+              << "; emitting a declaration\n";
+          ++NumFunctionsFailed;
+          RaiserStatistics::recordRaiseFailure(FuncName);
+          MFR->discardRaisedFunctionBody();
+        }
+      } else
+        Success |= MFR->runRaiserPasses();
+    }
+    if (Function *RF = MFR->getRaisedFunction())
+      RaiserStatistics::recordRaisedSize(FuncName, RF->getInstructionCount());
   }
-  assert(AllPrototypesConstructed && "Failed to construct all prototypes");
-  // Run instruction raiser passes.
-  for (auto *MFR : MFRaiserVector)
-    Success |= MFR->runRaiserPasses();
 
   return Success;
 }
@@ -259,14 +450,7 @@ bool ModuleRaiser::collectTextSectionRelocs(const SectionRef &TextSec) {
       // If the corresponding relocated section is TextSec, CandRelocSection
       // is the section with relocation information for TextSec.
       if (RelocatedSecIter->getIndex() == (uint64_t)TextSectionIndex) {
-        for (const RelocationRef &Reloc : CandRelocSection.relocations())
-          TextRelocs.push_back(Reloc);
-
-        // Sort the relocations
-        std::sort(TextRelocs.begin(), TextRelocs.end(),
-                  [](const RelocationRef &A, const RelocationRef &B) -> bool {
-                    return A.getOffset() < B.getOffset();
-                  });
+        Relocs.addTextRelocations(CandRelocSection);
         break;
       }
     }
@@ -280,9 +464,10 @@ int64_t ModuleRaiser::getTextSectionAddress() const {
     return -1;
 
   assert(TextSectionIndex >= 0 && "Unexpected negative index of text section");
-  for (SectionRef Sec : Obj->sections())
-    if (Sec.getIndex() == (unsigned)TextSectionIndex)
-      return Sec.getAddress();
+  const SectionMap::SectionEntry *TextSec =
+      Sections.getSectionAtIndex(TextSectionIndex);
+  if (TextSec != nullptr)
+    return TextSec->Address;
 
   llvm_unreachable("Failed to locate text section.");
 }
@@ -298,13 +483,8 @@ bool ModuleRaiser::changeRaisedFunctionReturnType(Function *TargetFunc,
   bool Changed = false;
 
   // Get the MachineFunction of TargetFunc
-  MachineFunctionRaiser *TargetFuncMFRaiser = nullptr;
-  for (auto *MIR : MFRaiserVector) {
-    if (MIR->getRaisedFunction() == TargetFunc) {
-      TargetFuncMFRaiser = MIR;
-      break;
-    }
-  }
+  MachineFunctionRaiser *TargetFuncMFRaiser =
+      RaisedFunctionMap.lookup(TargetFunc);
 
   assert(TargetFuncMFRaiser != nullptr &&
          "Expect to find MachineFunction raiser for return type change");
@@ -407,6 +587,8 @@ bool ModuleRaiser::changeRaisedFunctionReturnType(Function *TargetFunc,
         TargetFunc->getIterator());
     // Update raised function
     TargetFuncMFRaiser->setRaisedFunction(NewF);
+    RaisedFunctionMap.erase(TargetFunc);
+    RaisedFunctionMap[NewF] = TargetFuncMFRaiser;
     Changed = true;
   }
   return Changed;
@@ -15,6 +15,10 @@
 #define LLVM_TOOLS_LLVM_MCTOLL_MODULERAISER_H
 
 #include "FunctionFilter.h"
+#include "RelocationIndex.h"
+#include "SectionMap.h"
+#include "SymbolIndex.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/CodeGen/MachineBasicBlock.h"
 #include "llvm/CodeGen/MachineModuleInfo.h"
 #include "llvm/MC/MCDisassembler/MCDisassembler.h"
@@ -74,6 +78,8 @@ public:
     Obj = NewObj;
     DisAsm = NewDisAsm;
     FFT = new FunctionFilter(*M);
+    SymIndex.build(Obj);
+    Sections.build(Obj);
     InfoSet = true;
   }
 
@@ -100,9 +106,26 @@ public:
     return V.second;
   }
 
+  /// Remove the map of raised function R and return the place-holder
+  /// function it was mapped to.
+  Function *removePlaceholderRaisedFunctionMap(Function *R) {
+    auto V = PlaceholderRaisedFunctionMap.find(R);
+    assert(V != PlaceholderRaisedFunctionMap.end() &&
+           "Failed to find place-holder function");
+    Function *PH = V->second;
+    PlaceholderRaisedFunctionMap.erase(V);
+    return PH;
+  }
+
   bool collectTextSectionRelocs(const SectionRef &);
   virtual bool collectDynamicRelocations() = 0;
 
+  /// Return true if raised MachineInstrs need to carry the offset of their
+  /// MCInst as a metadata operand. This is needed by targets whose passes
+  /// create MachineInstrs in place of raised ones or read the offset directly
+  /// from the MachineInstr.
+  virtual bool needsMCInstOffsetMetadata() const { return true; }
+
   MachineFunction *getMachineFunction(Function *);
 
   // Member getters
@@ -115,6 +138,8 @@ public:
   const MCInstPrinter *getMCInstPrinter() const { return MIP; }
   const ObjectFile *getObjectFile() const { return Obj; }
   const MCDisassembler *getMCDisassembler() const { return DisAsm; }
+  const SymbolIndex &getSymbolIndex() const { return SymIndex; }
+  const SectionMap &getSectionMap() const { return Sections; }
   Triple::ArchType getArchType() { return Arch; }
 
   bool runMachineFunctionPasses();
@@ -124,10 +149,22 @@ public:
   /// to raised function, if one was constructed; else returns nullptr.
   Function *getRaisedFunctionAt(uint64_t) const;
 
+  /// Return the MachineFunctionRaiser of input binary function with start
+  /// offset equal to that specified as argument; or nullptr if none.
+  MachineFunctionRaiser *getMFRaiserAt(uint64_t) const;
+
   /// Return the Function * corresponding to input binary function from
-  /// text relocation record with off set in the range [Loc, Loc+Size].
+  /// text relocation record with offset in the range [Loc, Loc+Size). This
+  /// returns the pointer to raised function, if one was constructed; else
+  /// returns nullptr.
   Function *getCalledFunctionUsingTextReloc(uint64_t Loc, uint64_t Size) const;
 
+  /// Return the MachineFunctionRaiser of input binary function from text
+  /// relocation record with offset in the range [Loc, Loc+Size); or nullptr
+  /// if none.
+  MachineFunctionRaiser *getMFRaiserUsingTextReloc(uint64_t Loc,
+                                                   uint64_t Size) const;
+
   /// Get dynamic relocation with offset 'O'
   const RelocationRef *getDynRelocAtOffset(uint64_t O) const;
 
@@ -140,6 +177,8 @@ public:
   bool changeRaisedFunctionReturnType(Function *, Type *);
 
   virtual ~ModuleRaiser() {
+    for (auto *MFR : MFRaiserVector)
+      delete MFR;
     if (FFT != nullptr)
       delete FFT;
   }
@@ -149,6 +188,8 @@ public:
   Triple::ArchType getArch() const { return Arch; }
 
 protected:
+  FunctionType *buildRaisedFunctionPrototype(MachineFunctionRaiser *MFR);
+
   /// A sequential list of MachineFunctionRaiser objects created
   /// as the instructions of the input binary are parsed. Each of
   /// these correspond to a "machine function". A machine function
@@ -159,10 +200,22 @@ protected:
   /// A map of raised function pointer to place-holder function pointer
   /// that links to the MachineFunction.
   DenseMap<Function *, Function *> PlaceholderRaisedFunctionMap;
-  /// Sorted vector of text relocations
-  std::vector<RelocationRef> TextRelocs;
-  /// Vector of dynamic relocation records
-  std::vector<RelocationRef> DynRelocs;
+  /// Index of text and dynamic relocation records
+  RelocationIndex Relocs;
+  /// Map of the names of MachineFunctions to the corresponding
+  /// MachineFunctionRaiser objects. A raised function has the same name as
+  /// its MachineFunction.
+  StringMap<MachineFunctionRaiser *> FunctionNameMap;
+  /// Map of the start offsets of functions in the text section to the
+  /// corresponding MachineFunctionRaiser objects.
+  DenseMap<uint64_t, MachineFunctionRaiser *> FunctionStartMap;
+  /// Map of raised functions to the corresponding MachineFunctionRaiser
+  /// objects. This is updated whenever a raised function is replaced.
+  DenseMap<Function *, MachineFunctionRaiser *> RaisedFunctionMap;
+  /// Index of symbols of the object file, for address and name lookups
+  SymbolIndex SymIndex;
+  /// Table of sections of the object file, for address and index lookups
+  SectionMap Sections;
 
   // Commonly used data structures
   Module *M;
@@ -182,9 +235,14 @@ protected:
   bool InfoSet;
 };
 
+/// Function that creates a ModuleRaiser of a target
+using ModuleRaiserCtorTy = ModuleRaiser *(*)();
+
 bool isSupportedArch(Triple::ArchType Arch);
-ModuleRaiser *getModuleRaiser(const TargetMachine *TM);
-void registerModuleRaiser(ModuleRaiser *M);
+/// Create a new ModuleRaiser for the target of TM, to raise one module.
+std::unique_ptr<ModuleRaiser> createModuleRaiser(const TargetMachine *TM);
+/// Register Ctor as the function that creates ModuleRaisers for Arch.
+void registerModuleRaiser(Triple::ArchType Arch, ModuleRaiserCtorTy Ctor);
 
 // error functions used from main and from raisers libs
 extern StringRef ToolName;
@@ -0,0 +1,277 @@
+//===-- PrototypeCache.cpp --------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the implementation of PrototypeCache class for use by
+// llvm-mctoll.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PrototypeCache.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include <algorithm>
+
+using namespace llvm;
+using namespace llvm::mctoll;
+
+static const char CacheMagic[] = {'M', 'C', 'T', 'L', 'P', 'R', 'O', 'T'};
+// Version of the cache file format and of the parsing of prototypes. Must be
+// incremented whenever either changes.
+static const uint32_t CacheVersion = 1;
+
+static const uint64_t HeaderSize = sizeof(CacheMagic) + 6 * sizeof(uint32_t);
+static const uint64_t FileEntrySize = 16;
+static const uint64_t FunctionEntrySize = 16;
+static const uint32_t VariadicFlag = 1U << 31;
+
+// Return the content hash of file Path.
+static Expected<uint64_t> getFileHash(StringRef Path) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufOrErr =
+      MemoryBuffer::getFile(Path, /*IsText=*/false,
+                            /*RequiresNullTerminator=*/false);
+  if (!BufOrErr)
+    return errorCodeToError(BufOrErr.getError());
+  return xxHash64((*BufOrErr)->getBuffer());
+}
+
+Expected<uint64_t> PrototypeCache::computeKey(ArrayRef<std::string> FileNames,
+                                              StringRef Target,
+                                              StringRef SysRoot) {
+  std::string KeyStr;
+  raw_string_ostream KeyOS(KeyStr);
+  KeyOS << CacheVersion << '\0' << Target << '\0' << SysRoot << '\0';
+  for (const std::string &FileName : FileNames) {
+    Expected<uint64_t> Hash = getFileHash(FileName);
+    if (!Hash)
+      return Hash.takeError();
+    KeyOS << FileName << '\0' << *Hash << '\0';
+  }
+  return xxHash64(KeyOS.str());
+}
+
+std::string PrototypeCache::getCacheFilePath(StringRef Dir, uint64_t Key) {
+  SmallString<128> Path(Dir);
+  sys::path::append(Path, "prototypes-" + utohexstr(Key, /*LowerCase=*/true) +
+                              ".bin");
+  return std::string(Path.str());
+}
+
+uint32_t PrototypeCache::read32(uint64_t Offset) const {
+  return support::endian::read32le(Buffer->getBufferStart() + Offset);
+}
+
+uint64_t PrototypeCache::read64(uint64_t Offset) const {
+  return support::endian::read64le(Buffer->getBufferStart() + Offset);
+}
+
+StringRef PrototypeCache::getString(uint32_t Offset) const {
+  if (uint64_t(Offset) + sizeof(uint32_t) > StringTableSize)
+    return StringRef();
+  uint32_t Length = read32(StringTableOffset + Offset);
+  uint64_t Start = uint64_t(Offset) + sizeof(uint32_t);
+  if (Start + Length > StringTableSize)
+    return StringRef();
+  return StringRef(Buffer->getBufferStart() + StringTableOffset + Start,
+                   Length);
+}
+
+bool PrototypeCache::parseHeader() {
+  StringRef Data = Buffer->getBuffer();
+  if ((Data.size() < HeaderSize) ||
+      !Data.startswith(StringRef(CacheMagic, sizeof(CacheMagic))))
+    return false;
+  uint64_t Offset = sizeof(CacheMagic);
+  if (read32(Offset) != CacheVersion)
+    return false;
+  NumFiles = read32(Offset + 4);
+  NumFunctions = read32(Offset + 8);
+  NumArgs = read32(Offset + 12);
+  NumVariables = read32(Offset + 16);
+  StringTableSize = read32(Offset + 20);
+
+  FilesOffset = HeaderSize;
+  FunctionsOffset = FilesOffset + NumFiles * FileEntrySize;
+  ArgsOffset = FunctionsOffset + NumFunctions * FunctionEntrySize;
+  VariablesOffset = ArgsOffset + uint64_t(NumArgs) * sizeof(uint32_t);
+  StringTableOffset =
+      VariablesOffset + uint64_t(NumVariables) * sizeof(uint32_t);
+  return StringTableOffset + StringTableSize == Data.size();
+}
+
+bool PrototypeCache::isUpToDate() const {
+  for (uint32_t I = 0; I < NumFiles; I++) {
+    uint64_t Entry = FilesOffset + I * FileEntrySize;
+    StringRef Path = getString(read32(Entry + 8));
+    if (Path.empty())
+      return false;
+    Expected<uint64_t> Hash = getFileHash(Path);
+    if (!Hash) {
+      consumeError(Hash.takeError());
+      return false;
+    }
+    if (*Hash != read64(Entry))
+      return false;
+  }
+  return true;
+}
+
+std::unique_ptr<PrototypeCache> PrototypeCache::open(StringRef Path) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufOrErr =
+      MemoryBuffer::getFile(Path, /*IsText=*/false,
+                            /*RequiresNullTerminator=*/false);
+  if (!BufOrErr)
+    return nullptr;
+  std::unique_ptr<PrototypeCache> Cache(
+      new PrototypeCache(std::move(*BufOrErr)));
+  if (!Cache->parseHeader() || !Cache->isUpToDate())
+    return nullptr;
+  return Cache;
+}
+
+bool PrototypeCache::lookupFunction(
+    StringRef Name, IncludedFileInfo::FunctionRetAndArgs &Entry) const {
+  // Binary search the functions sorted by name.
+  uint32_t Low = 0, High = NumFunctions;
+  while (Low < High) {
+    uint32_t Mid = Low + (High - Low) / 2;
+    uint64_t Record = FunctionsOffset + Mid * FunctionEntrySize;
+    int Cmp = getString(read32(Record)).compare(Name);
+    if (Cmp < 0) {
+      Low = Mid + 1;
+    } else if (Cmp > 0) {
+      High = Mid;
+    } else {
+      uint32_t FirstArg = read32(Record + 8);
+      uint32_t ArgCount = read32(Record + 12);
+      uint32_t NumFuncArgs = ArgCount & ~VariadicFlag;
+      if (uint64_t(FirstArg) + NumFuncArgs > NumArgs)
+        return false;
+      Entry.ReturnType = getString(read32(Record + 4)).str();
+      Entry.Arguments.clear();
+      for (uint32_t I = 0; I < NumFuncArgs; I++)
+        Entry.Arguments.push_back(
+            getString(read32(ArgsOffset + (FirstArg + I) * sizeof(uint32_t)))
+                .str());
+      Entry.IsVariadic = (ArgCount & VariadicFlag) != 0;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PrototypeCache::hasVariable(StringRef Name) const {
+  uint32_t Low = 0, High = NumVariables;
+  while (Low < High) {
+    uint32_t Mid = Low + (High - Low) / 2;
+    int Cmp = getString(read32(VariablesOffset + Mid * sizeof(uint32_t)))
+                  .compare(Name);
+    if (Cmp == 0)
+      return true;
+    if (Cmp < 0)
+      Low = Mid + 1;
+    else
+      High = Mid;
+  }
+  return false;
+}
+
+Error PrototypeCache::write(
+    StringRef Path,
+    const std::map<std::string, IncludedFileInfo::FunctionRetAndArgs>
+        &Functions,
+    const std::set<std::string> &Variables,
+    const std::set<std::string> &Files) {
+  // Build the string table. Strings are stored once.
+  std::string StringTable;
+  StringMap<uint32_t> StringOffsets;
+  auto AddString = [&](StringRef S) -> uint32_t {
+    auto Inserted = StringOffsets.try_emplace(S, StringTable.size());
+    if (Inserted.second) {
+      char Length[sizeof(uint32_t)];
+      support::endian::write32le(Length, S.size());
+      StringTable.append(Length, sizeof(Length));
+      StringTable.append(S.begin(), S.end());
+    }
+    return Inserted.first->second;
+  };
+
+  std::vector<std::pair<uint64_t, uint32_t>> FileEntries;
+  for (const std::string &File : Files) {
+    Expected<uint64_t> Hash = getFileHash(File);
+    if (!Hash)
+      return Hash.takeError();
+    FileEntries.emplace_back(*Hash, AddString(File));
+  }
+
+  // std::map and std::set are ordered by name, as required for lookup.
+  std::vector<uint32_t> FunctionEntries;
+  std::vector<uint32_t> ArgEntries;
+  for (const auto &Func : Functions) {
+    const IncludedFileInfo::FunctionRetAndArgs &RetAndArgs = Func.second;
+    FunctionEntries.push_back(AddString(Func.first));
+    FunctionEntries.push_back(AddString(RetAndArgs.ReturnType));
+    FunctionEntries.push_back(ArgEntries.size());
+    FunctionEntries.push_back(RetAndArgs.Arguments.size() |
+                              (RetAndArgs.IsVariadic ? VariadicFlag : 0));
+    for (const std::string &Arg : RetAndArgs.Arguments)
+      ArgEntries.push_back(AddString(Arg));
+  }
+  std::vector<uint32_t> VariableEntries;
+  for (const std::string &Var : Variables)
+    VariableEntries.push_back(AddString(Var));
+
+  // Write to a temporary file in the cache directory and rename it.
+  StringRef Dir = sys::path::parent_path(Path);
+  if (std::error_code EC = sys::fs::create_directories(Dir))
+    return errorCodeToError(EC);
+  int FD;
+  SmallString<128> TempPath;
+  if (std::error_code EC = sys::fs::createUniqueFile(
+          Twine(Path) + "-%%%%%%%%.tmp", FD, TempPath))
+    return errorCodeToError(EC);
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    support::endian::Writer W(OS, support::little);
+    OS.write(CacheMagic, sizeof(CacheMagic));
+    W.write<uint32_t>(CacheVersion);
+    W.write<uint32_t>(FileEntries.size());
+    W.write<uint32_t>(Functions.size());
+    W.write<uint32_t>(ArgEntries.size());
+    W.write<uint32_t>(VariableEntries.size());
+    W.write<uint32_t>(StringTable.size());
+    for (const auto &File : FileEntries) {
+      W.write<uint64_t>(File.first);
+      W.write<uint32_t>(File.second);
+      W.write<uint32_t>(0);
+    }
+    for (uint32_t Entry : FunctionEntries)
+      W.write<uint32_t>(Entry);
+    for (uint32_t Entry : ArgEntries)
+      W.write<uint32_t>(Entry);
+    for (uint32_t Entry : VariableEntries)
+      W.write<uint32_t>(Entry);
+    OS << StringTable;
+    OS.close();
+    if (OS.has_error()) {
+      std::error_code EC = OS.error();
+      OS.clear_error();
+      sys::fs::remove(TempPath);
+      return errorCodeToError(EC);
+    }
+  }
+  if (std::error_code EC = sys::fs::rename(TempPath, Path)) {
+    sys::fs::remove(TempPath);
+    return errorCodeToError(EC);
+  }
+  return Error::success();
+}
@@ -0,0 +1,119 @@
+//===-- PrototypeCache.h ----------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the definition of PrototypeCache class that provides
+// an on-disk cache of the function prototypes and variables parsed from the
+// header files specified using -I.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_LLVM_MCTOLL_PROTOTYPECACHE_H
+#define LLVM_TOOLS_LLVM_MCTOLL_PROTOTYPECACHE_H
+
+#include "IncludedFileInfo.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+namespace llvm {
+namespace mctoll {
+
+/// Cache file of the function prototypes and variables parsed from a set of
+/// header files. A cache file is named after a key computed from the contents
+/// of the header files, the target and the system root. It also records the
+/// content hash of each file read while parsing, so that a change to any
+/// header included by the header files invalidates it.
+///
+/// The cache file is mapped into memory when opened. Functions and variables
+/// are sorted by name and looked up using a binary search, so entries are
+/// decoded only when used. All integers are little endian.
+///   Header    - magic "MCTLPROT" followed by the format version and the
+///               number of files, functions, argument types and variables,
+///               and the size of the string table, each as uint32_t.
+///   Files     - {uint64_t content hash, uint32_t path, uint32_t reserved}
+///   Functions - {uint32_t name, uint32_t return type, uint32_t index of the
+///               first argument type, uint32_t number of argument types with
+///               the most significant bit set if the function is variadic}
+///   Arguments - uint32_t argument type
+///   Variables - uint32_t name
+///   Strings   - {uint32_t length, characters}
+/// where names, paths and types are offsets of strings in the string table.
+class PrototypeCache {
+public:
+  PrototypeCache(const PrototypeCache &) = delete;
+  PrototypeCache &operator=(const PrototypeCache &) = delete;
+
+  /// Return the key of the prototypes parsed from header files FileNames for
+  /// target Target with system root SysRoot. Return an error if any of the
+  /// header files cannot be read.
+  static Expected<uint64_t> computeKey(ArrayRef<std::string> FileNames,
+                                       StringRef Target, StringRef SysRoot);
+
+  /// Return the path of the cache file with key Key in directory Dir.
+  static std::string getCacheFilePath(StringRef Dir, uint64_t Key);
+
+  /// Open the cache file Path. Return nullptr if the file does not exist, is
+  /// not a valid cache file, or any of the files it was built from changed.
+  static std::unique_ptr<PrototypeCache> open(StringRef Path);
+
+  /// Write Functions and Variables, parsed from Files, to the cache file Path.
+  /// The file is replaced atomically, so that concurrent runs never read a
+  /// partially written file.
+  static Error
+  write(StringRef Path,
+        const std::map<std::string, IncludedFileInfo::FunctionRetAndArgs>
+            &Functions,
+        const std::set<std::string> &Variables,
+        const std::set<std::string> &Files);
+
+  /// Look up the prototype of function Name. Return true and set Entry if
+  /// found.
+  bool lookupFunction(StringRef Name,
+                      IncludedFileInfo::FunctionRetAndArgs &Entry) const;
+
+  /// Return true if variable Name is declared.
+  bool hasVariable(StringRef Name) const;
+
+private:
+  explicit PrototypeCache(std::unique_ptr<MemoryBuffer> Buffer)
+      : Buffer(std::move(Buffer)) {}
+
+  /// Parse the header and check the size of the cache file. Return false if
+  /// it is not a valid cache file.
+  bool parseHeader();
+  /// Return true if all files the cache file was built from are unchanged.
+  bool isUpToDate() const;
+
+  uint32_t read32(uint64_t Offset) const;
+  uint64_t read64(uint64_t Offset) const;
+  /// Return the string at offset Offset of the string table, or an empty
+  /// string if Offset is not valid.
+  StringRef getString(uint32_t Offset) const;
+
+  std::unique_ptr<MemoryBuffer> Buffer;
+  uint32_t NumFiles = 0;
+  uint32_t NumFunctions = 0;
+  uint32_t NumArgs = 0;
+  uint32_t NumVariables = 0;
+  uint32_t StringTableSize = 0;
+  /// Offsets of the sections of the cache file
+  uint64_t FilesOffset = 0;
+  uint64_t FunctionsOffset = 0;
+  uint64_t ArgsOffset = 0;
+  uint64_t VariablesOffset = 0;
+  uint64_t StringTableOffset = 0;
+};
+
+} // end namespace mctoll
+} // end namespace llvm
+
+#endif // LLVM_TOOLS_LLVM_MCTOLL_PROTOTYPECACHE_H
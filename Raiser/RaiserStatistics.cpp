@@ -0,0 +1,289 @@
+//===-- RaiserStatistics.cpp ------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the implementation of RaiserStatistics class for use by
+// llvm-mctoll.
+//
+//===----------------------------------------------------------------------===//
+
+#include "RaiserStatistics.h"
+#include "ModuleRaiser.h"
+#include "llvm-mctoll.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+using namespace llvm::mctoll;
+
+static const unsigned NumPhases =
+    static_cast<unsigned>(RaiserPhase::NumPhases);
+
+// Names used in the JSON report and descriptions used in the timer report of
+// each phase, in the order of RaiserPhase.
+static const char *const PhaseNames[NumPhases] = {
+    "disassembly", "cfg",      "prototypes", "raise",
+    "peephole",    "optimize", "emit"};
+static const char *const PhaseDescriptions[NumPhases] = {
+    "Disassembly",           "Control flow graph construction",
+    "Prototype discovery",   "Instruction raising",
+    "Peephole optimization", "Optimization pipeline",
+    "Output emission"};
+
+namespace {
+struct FunctionRecord {
+  std::string Name;
+  uint64_t Address = 0;
+  uint64_t NumInstrs = 0;
+  uint64_t NumBlocks = 0;
+  uint64_t NumIRInstrs = 0;
+  int64_t PhaseTimeUs[NumPhases] = {};
+  // Description of the raising budget exceeded, if any
+  std::string BudgetExceeded;
+  bool RaiseFailed = false;
+};
+
+struct InputRecord {
+  std::string Name;
+  int64_t PhaseTimeUs[NumPhases] = {};
+  // Functions in the order they were first recorded, and their indices.
+  std::vector<FunctionRecord> Functions;
+  StringMap<size_t> FunctionIndex;
+
+  FunctionRecord &getFunction(StringRef FuncName) {
+    auto Inserted = FunctionIndex.try_emplace(FuncName, Functions.size());
+    if (Inserted.second) {
+      Functions.emplace_back();
+      Functions.back().Name = FuncName.str();
+    }
+    return Functions[Inserted.first->second];
+  }
+};
+
+struct StatisticsState {
+  TimerGroup PhaseTimerGroup{"mctoll", "llvm-mctoll phases"};
+  Timer PhaseTimers[NumPhases];
+  std::vector<InputRecord> Inputs;
+  // Serializes updates of Inputs by concurrent threads
+  std::mutex InputsMutex;
+
+  StatisticsState() {
+    for (unsigned Idx = 0; Idx < NumPhases; Idx++)
+      PhaseTimers[Idx].init(PhaseNames[Idx], PhaseDescriptions[Idx],
+                            PhaseTimerGroup);
+  }
+
+  // Return the record of the current input. Must be called with InputsMutex
+  // held.
+  InputRecord &getCurrentInput();
+};
+} // end anonymous namespace
+
+static ManagedStatic<StatisticsState> State;
+
+// Index of the input being raised by this thread, if it began one. Threads
+// that raise parts of an input, rather than inputs, record to the input begun
+// last.
+static thread_local size_t CurrentInputIdx = SIZE_MAX;
+
+// Phase timers are only used by the main thread, as inputs raised
+// concurrently would start the same timer more than once.
+static const std::thread::id MainThreadId = std::this_thread::get_id();
+
+InputRecord &StatisticsState::getCurrentInput() {
+  if (CurrentInputIdx < Inputs.size())
+    return Inputs[CurrentInputIdx];
+  if (Inputs.empty())
+    Inputs.emplace_back();
+  return Inputs.back();
+}
+
+static int64_t getElapsedUs(std::chrono::steady_clock::time_point StartTime) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - StartTime)
+      .count();
+}
+
+bool RaiserStatistics::isEnabled() {
+  return TimePhases || !StatsJSONFile.empty();
+}
+
+void RaiserStatistics::beginInput(StringRef InputName) {
+  if (!isEnabled())
+    return;
+  std::lock_guard<std::mutex> Lock(State->InputsMutex);
+  CurrentInputIdx = State->Inputs.size();
+  State->Inputs.emplace_back();
+  State->Inputs.back().Name = InputName.str();
+}
+
+void RaiserStatistics::recordFunctionSize(StringRef FuncName, uint64_t Addr,
+                                          uint64_t NumInstrs,
+                                          uint64_t NumBlocks) {
+  if (!isEnabled())
+    return;
+  std::lock_guard<std::mutex> Lock(State->InputsMutex);
+  FunctionRecord &Func = State->getCurrentInput().getFunction(FuncName);
+  Func.Address = Addr;
+  Func.NumInstrs = NumInstrs;
+  Func.NumBlocks = NumBlocks;
+}
+
+void RaiserStatistics::recordRaisedSize(StringRef FuncName,
+                                        uint64_t NumIRInstrs) {
+  if (!isEnabled())
+    return;
+  std::lock_guard<std::mutex> Lock(State->InputsMutex);
+  State->getCurrentInput().getFunction(FuncName).NumIRInstrs = NumIRInstrs;
+}
+
+void RaiserStatistics::recordBudgetExceeded(StringRef FuncName,
+                                            StringRef Reason) {
+  if (!isEnabled())
+    return;
+  std::lock_guard<std::mutex> Lock(State->InputsMutex);
+  State->getCurrentInput().getFunction(FuncName).BudgetExceeded = Reason.str();
+}
+
+void RaiserStatistics::recordRaiseFailure(StringRef FuncName) {
+  if (!isEnabled())
+    return;
+  std::lock_guard<std::mutex> Lock(State->InputsMutex);
+  State->getCurrentInput().getFunction(FuncName).RaiseFailed = true;
+}
+
+static void writePhaseTimes(json::OStream &J, const int64_t *PhaseTimeUs) {
+  J.attributeObject("time_us", [&] {
+    for (unsigned Idx = 0; Idx < NumPhases; Idx++)
+      if (PhaseTimeUs[Idx] != 0)
+        J.attribute(PhaseNames[Idx], PhaseTimeUs[Idx]);
+  });
+}
+
+static void writeStatisticsJSON(raw_ostream &OS) {
+  json::OStream J(OS, /*IndentSize=*/2);
+  J.object([&] {
+    J.attributeObject("phases", [&] {
+      for (unsigned Idx = 0; Idx < NumPhases; Idx++) {
+        TimeRecord Time = State->PhaseTimers[Idx].getTotalTime();
+        J.attributeObject(PhaseNames[Idx], [&] {
+          J.attribute("wall", Time.getWallTime());
+          J.attribute("user", Time.getUserTime());
+          J.attribute("system", Time.getSystemTime());
+        });
+      }
+    });
+
+    // Statistics are registered in the order of first use. Sort them by
+    // name to keep the report stable.
+    auto Stats = GetStatistics();
+    llvm::sort(Stats, [](const std::pair<StringRef, uint64_t> &A,
+                         const std::pair<StringRef, uint64_t> &B) {
+      return A.first < B.first;
+    });
+    J.attributeObject("statistics", [&] {
+      for (const auto &Stat : Stats)
+        J.attribute(Stat.first, static_cast<int64_t>(Stat.second));
+    });
+
+    J.attributeArray("inputs", [&] {
+      for (const InputRecord &Input : State->Inputs) {
+        J.object([&] {
+          J.attribute("file", Input.Name);
+          writePhaseTimes(J, Input.PhaseTimeUs);
+          J.attributeArray("functions", [&] {
+            for (const FunctionRecord &Func : Input.Functions) {
+              J.object([&] {
+                J.attribute("name", Func.Name);
+                J.attribute("address", Func.Address);
+                J.attribute("instructions", Func.NumInstrs);
+                J.attribute("blocks", Func.NumBlocks);
+                J.attribute("ir_instructions", Func.NumIRInstrs);
+                writePhaseTimes(J, Func.PhaseTimeUs);
+                if (!Func.BudgetExceeded.empty())
+                  J.attribute("budget_exceeded", Func.BudgetExceeded);
+                if (Func.RaiseFailed)
+                  J.attribute("raise_failed", true);
+              });
+            }
+          });
+        });
+      }
+    });
+  });
+  OS << '\n';
+}
+
+void RaiserStatistics::report() {
+  if (!isEnabled())
+    return;
+
+  if (!StatsJSONFile.empty()) {
+    std::error_code EC;
+    raw_fd_ostream OS(StatsJSONFile, EC, sys::fs::OF_Text);
+    if (EC)
+      reportError(StatsJSONFile, EC.message());
+    writeStatisticsJSON(OS);
+  }
+
+  // The timers are cleared once printed, so that they are not printed again
+  // on exit.
+  if (TimePhases)
+    State->PhaseTimerGroup.print(errs(), /*ResetAfterPrint=*/true);
+  else
+    State->PhaseTimerGroup.clear();
+}
+
+RaiserStatistics::PhaseRegion::PhaseRegion(RaiserPhase Phase)
+    : Phase(Phase), PhaseTimer(nullptr), Enabled(false) {
+  if (!isEnabled())
+    return;
+  Enabled = true;
+  if (std::this_thread::get_id() == MainThreadId) {
+    PhaseTimer = &State->PhaseTimers[static_cast<unsigned>(Phase)];
+    PhaseTimer->startTimer();
+  }
+  StartTime = std::chrono::steady_clock::now();
+}
+
+RaiserStatistics::PhaseRegion::~PhaseRegion() {
+  if (!Enabled)
+    return;
+  if (PhaseTimer != nullptr)
+    PhaseTimer->stopTimer();
+  int64_t ElapsedUs = getElapsedUs(StartTime);
+  std::lock_guard<std::mutex> Lock(State->InputsMutex);
+  State->getCurrentInput().PhaseTimeUs[static_cast<unsigned>(Phase)] +=
+      ElapsedUs;
+}
+
+RaiserStatistics::FunctionPhaseRegion::FunctionPhaseRegion(RaiserPhase Phase,
+                                                           StringRef FuncName)
+    : Phase(Phase), Enabled(isEnabled()) {
+  if (!Enabled)
+    return;
+  this->FuncName = FuncName.str();
+  StartTime = std::chrono::steady_clock::now();
+}
+
+RaiserStatistics::FunctionPhaseRegion::~FunctionPhaseRegion() {
+  if (!Enabled)
+    return;
+  int64_t ElapsedUs = getElapsedUs(StartTime);
+  std::lock_guard<std::mutex> Lock(State->InputsMutex);
+  State->getCurrentInput()
+      .getFunction(FuncName)
+      .PhaseTimeUs[static_cast<unsigned>(Phase)] += ElapsedUs;
+}
@@ -0,0 +1,116 @@
+//===-- RaiserStatistics.h --------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the declaration of RaiserStatistics class that collects
+// the time spent in each phase of raising and per-function statistics, as
+// requested using --time-phases and --stats-json.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_LLVM_MCTOLL_RAISERSTATISTICS_H
+#define LLVM_TOOLS_LLVM_MCTOLL_RAISERSTATISTICS_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Timer.h"
+#include <chrono>
+#include <string>
+
+namespace llvm {
+namespace mctoll {
+
+/// Phases of raising an input binary
+enum class RaiserPhase : unsigned {
+  Disassembly,
+  BuildCFG,
+  PrototypeDiscovery,
+  Raise,
+  PeepholeOptimization,
+  Optimization,
+  EmitOutput,
+  NumPhases
+};
+
+/// Collector of phase times and per-function statistics. Nothing is collected
+/// unless --time-phases or --stats-json is specified.
+///
+/// The time of each phase is accumulated over all inputs in a TimerGroup that
+/// is printed to stderr on exit if --time-phases is specified. If a file is
+/// specified using --stats-json, a JSON object is written to it on exit with
+///   "phases"     - the wall, user and system time of each phase in seconds.
+///   "statistics" - the STATISTIC counters. These are only available in
+///                  builds with statistics enabled (i.e., with assertions or
+///                  LLVM_FORCE_ENABLE_STATS).
+///   "inputs"     - for each input, the wall time of each phase and, for each
+///                  function, its address, the number of machine instructions
+///                  and basic blocks, the number of raised IR instructions and
+///                  the wall time of each phase in microseconds, and the
+///                  raising budget it exceeded, if any, or whether raising
+///                  it failed with --isolate-failures.
+class RaiserStatistics {
+public:
+  /// Return true if statistics are collected.
+  static bool isEnabled();
+
+  /// Start collecting the statistics of input InputName, raised by this
+  /// thread.
+  static void beginInput(StringRef InputName);
+
+  /// Record the size of function FuncName at address Addr of the current
+  /// input, after its control flow graph is built.
+  static void recordFunctionSize(StringRef FuncName, uint64_t Addr,
+                                 uint64_t NumInstrs, uint64_t NumBlocks);
+
+  /// Record the number of raised IR instructions of function FuncName of the
+  /// current input.
+  static void recordRaisedSize(StringRef FuncName, uint64_t NumIRInstrs);
+
+  /// Record that function FuncName of the current input exceeded its raising
+  /// budget as described by Reason.
+  static void recordBudgetExceeded(StringRef FuncName, StringRef Reason);
+
+  /// Record that raising function FuncName of the current input failed.
+  static void recordRaiseFailure(StringRef FuncName);
+
+  /// Print the phase timers if --time-phases is specified, and write the
+  /// statistics to the file specified using --stats-json, if any.
+  static void report();
+
+  /// Scope whose wall time is attributed to phase Phase of the current input
+  /// of this thread. The phase timers only account for scopes of the main
+  /// thread.
+  class PhaseRegion {
+  public:
+    explicit PhaseRegion(RaiserPhase Phase);
+    ~PhaseRegion();
+
+  private:
+    RaiserPhase Phase;
+    Timer *PhaseTimer;
+    bool Enabled;
+    std::chrono::steady_clock::time_point StartTime;
+  };
+
+  /// Scope whose wall time is attributed to phase Phase of function FuncName
+  /// of the current input. May be used by concurrent threads.
+  class FunctionPhaseRegion {
+  public:
+    FunctionPhaseRegion(RaiserPhase Phase, StringRef FuncName);
+    ~FunctionPhaseRegion();
+
+  private:
+    RaiserPhase Phase;
+    std::string FuncName;
+    bool Enabled;
+    std::chrono::steady_clock::time_point StartTime;
+  };
+};
+
+} // end namespace mctoll
+} // end namespace llvm
+
+#endif // LLVM_TOOLS_LLVM_MCTOLL_RAISERSTATISTICS_H
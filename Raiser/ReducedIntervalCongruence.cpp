@@ -7,6 +7,9 @@
 //===----------------------------------------------------------------------===//
 
 #include "ReducedIntervalCongruence.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
+#include <numeric>
 
 #define DEBUG_TYPE "mctoll"
 
@@ -236,94 +239,207 @@ bool ReducedIntervalCongruence::intersectRIC(ReducedIntervalCongruence &ric) {
     return true;
 }
 
-bool ReducedIntervalCongruence::unionRIC(ReducedIntervalCongruence &ric) {
-
-    // For now treat UNSURE as INF
-
-    // TODO more robust checks for union
-    std::unique_ptr<ReducedIntervalCongruence> unionr;
+// Compute alignment * index + offset. Return false on overflow.
+static bool getValueAtIndex(uint64_t alignment, int64_t index, int64_t offset,
+                            int64_t &value) {
+    if (alignment > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+        return false;
+    int64_t scaled;
+    if (llvm::MulOverflow(static_cast<int64_t>(alignment), index, scaled))
+        return false;
+    return !llvm::AddOverflow(scaled, offset, value);
+}
 
-    unionr->setAlignment(std::min(Alignment, ric.getAlignment()));
+// Set ric to the set of all values.
+static void setToTop(ReducedIntervalCongruence &ric) {
+    ric = ReducedIntervalCongruence(1, 0, 0, 0, BoundState::NEG_INF,
+                                    BoundState::INF);
+}
 
-    int64_t lowerLimit;
-    if (isLowerBoundSet()) {
-        lowerLimit = Offset + IndexLowerBound * Alignment;
-    } else {
-        lowerLimit = std::numeric_limits<int64_t>::min();
-    }
-    int64_t cmpLowerLimit;
+// Bring ric to a canonical form, so that equal sets of values compare equal.
+// An unbounded RIC is represented using the bound it has, if any, as offset,
+// or else using the smallest non-negative member as offset.
+static void canonicalize(ReducedIntervalCongruence &ric) {
+    uint64_t alignment = ric.getAlignment();
+    if (alignment == 0 ||
+        alignment > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+        return;
+    int64_t value;
     if (ric.getLowerBoundState() == BoundState::SET) {
-        cmpLowerLimit = ric.getOffset() + ric.getIndexLowerBound() * ric.getAlignment();
-    } else {
-        cmpLowerLimit = std::numeric_limits<int64_t>::min();
-    }
-
-    int64_t upperLimit;
-    if (isUpperBoundSet()) {
-        upperLimit = Offset + IndexUpperBound * Alignment;
-    } else {
-        upperLimit = std::numeric_limits<int64_t>::max();
+        if (ric.getUpperBoundState() != BoundState::SET &&
+            ric.getMinValue(value)) {
+            ric.setOffset(value);
+            ric.setIndexLowerBound(0);
+            ric.setIndexUpperBound(0);
+        }
+        return;
     }
-    int64_t cmpUpperLimit;
     if (ric.getUpperBoundState() == BoundState::SET) {
-        cmpUpperLimit = ric.getOffset() + ric.getIndexUpperBound() * ric.getAlignment();
-    } else {
-        cmpUpperLimit = std::numeric_limits<int64_t>::max();
+        if (ric.getMaxValue(value)) {
+            ric.setOffset(value);
+            ric.setIndexLowerBound(0);
+            ric.setIndexUpperBound(0);
+        }
+        return;
     }
+    int64_t stride = static_cast<int64_t>(alignment);
+    ric.setOffset(((ric.getOffset() % stride) + stride) % stride);
+    ric.setIndexLowerBound(0);
+    ric.setIndexUpperBound(0);
+}
 
-    // Lower limit set
-    if (lowerLimit <= cmpLowerLimit) {
-        unionr->setLowerBoundState(LowerBoundState);
-        unionr->setOffset(Offset);
-        unionr->setIndexLowerBound(IndexLowerBound);
-    } else {
-        unionr->setLowerBoundState(ric.getLowerBoundState());
-        unionr->setOffset(ric.getOffset());
-        unionr->setIndexLowerBound(ric.getIndexLowerBound());
-    }
+bool ReducedIntervalCongruence::getMinValue(int64_t &value) const {
+    return LowerBoundState == BoundState::SET &&
+           getValueAtIndex(Alignment, IndexLowerBound, Offset, value);
+}
 
-    int64_t actualLowerLimit = std::min(lowerLimit, cmpLowerLimit);
+bool ReducedIntervalCongruence::getMaxValue(int64_t &value) const {
+    return UpperBoundState == BoundState::SET &&
+           getValueAtIndex(Alignment, IndexUpperBound, Offset, value);
+}
 
-    // Upper limit set
-    if (unionr->getLowerBoundState() == BoundState::SET) {
-        if (upperLimit <= cmpUpperLimit) {
-            int64_t alignmentDiff = (upperLimit - actualLowerLimit) / 
-                unionr->getAlignment();
-            unionr->setUpperBoundState(UpperBoundState);
-            unionr->setIndexUpperBound(alignmentDiff + 
-                unionr->getIndexLowerBound());
-        } else {
-            int64_t alignmentDiff = (cmpUpperLimit - actualLowerLimit) / 
-                unionr->getAlignment();
-            unionr->setUpperBoundState(ric.getUpperBoundState());
-            unionr->setIndexUpperBound(alignmentDiff + 
-                unionr->getIndexLowerBound());
-        }
-    } else {
-        if (upperLimit >= cmpUpperLimit) {
-            int64_t alignmentDiff = (upperLimit - unionr->getOffset()) / 
-                unionr->getAlignment();
-            unionr->setUpperBoundState(UpperBoundState);
-            unionr->setIndexUpperBound(alignmentDiff);
-        } else {
-            int64_t alignmentDiff = (cmpUpperLimit - unionr->getOffset()) / 
-                unionr->getAlignment();
-            unionr->setUpperBoundState(ric.getUpperBoundState());
-            unionr->setIndexUpperBound(alignmentDiff);
-        }
+bool ReducedIntervalCongruence::isSingleton() const {
+    return LowerBoundState == BoundState::SET &&
+           UpperBoundState == BoundState::SET &&
+           (IndexLowerBound == IndexUpperBound || Alignment == 0);
+}
+
+// Return a value contained in ric. Return false if no such value is
+// representable.
+static bool getMemberValue(const ReducedIntervalCongruence &ric,
+                           int64_t &value) {
+    if (ric.getLowerBoundState() == BoundState::SET)
+        return ric.getMinValue(value);
+    if (ric.getUpperBoundState() == BoundState::SET)
+        return ric.getMaxValue(value);
+    // All values congruent to offset modulo alignment are included.
+    value = ric.getOffset();
+    return true;
+}
+
+// Update this RIC to the smallest RIC that contains all values of this RIC and
+// of ric. UNSURE bounds are treated as unbounded.
+bool ReducedIntervalCongruence::unionRIC(ReducedIntervalCongruence &ric) {
+    int64_t member, cmpMember;
+    if (!getMemberValue(*this, member) || !getMemberValue(ric, cmpMember)) {
+        setToTop(*this);
+        return true;
     }
 
-    Alignment = unionr->getAlignment();
-    IndexLowerBound = unionr->getIndexLowerBound();
-    IndexUpperBound = unionr->getIndexUpperBound();
-    Offset = unionr->getOffset();
-    LowerBoundState = unionr->getLowerBoundState();
-    UpperBoundState = unionr->getUpperBoundState();
+    // The resulting alignment is the gcd of both alignments and the distance
+    // between values of the two RICs. Singletons do not constrain alignment.
+    uint64_t stride = isSingleton() ? 0 : Alignment;
+    uint64_t cmpStride = ric.isSingleton() ? 0 : ric.getAlignment();
+    int64_t distance;
+    if (llvm::SubOverflow(member, cmpMember, distance) ||
+        distance == std::numeric_limits<int64_t>::min()) {
+        setToTop(*this);
+        return true;
+    }
+    uint64_t alignment = std::gcd(
+        std::gcd(stride, cmpStride),
+        static_cast<uint64_t>(distance < 0 ? -distance : distance));
+    // Both are the same singleton.
+    if (alignment == 0)
+        return true;
+
+    int64_t minValue, cmpMinValue, maxValue, cmpMaxValue;
+    bool hasMin = getMinValue(minValue) && ric.getMinValue(cmpMinValue);
+    bool hasMax = getMaxValue(maxValue) && ric.getMaxValue(cmpMaxValue);
+    int64_t newOffset = hasMin ? std::min(minValue, cmpMinValue) : member;
+    int64_t span = 0;
+    if (hasMax) {
+        if (llvm::SubOverflow(std::max(maxValue, cmpMaxValue), newOffset, span) ||
+            alignment > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+            setToTop(*this);
+            return true;
+        }
+    }
 
+    Alignment = alignment;
+    Offset = newOffset;
+    IndexLowerBound = 0;
+    LowerBoundState = hasMin ? BoundState::SET : BoundState::NEG_INF;
+    // All values are congruent modulo alignment. So, the division is exact.
+    IndexUpperBound = span / static_cast<int64_t>(alignment);
+    UpperBoundState = hasMax ? BoundState::SET : BoundState::INF;
+    canonicalize(*this);
     return true;
 }
 
+// Update this RIC to the union of this RIC and ric, with any bound that
+// moves dropped. Repeated widening is guaranteed to stabilize.
 bool ReducedIntervalCongruence::widenRIC(ReducedIntervalCongruence &ric) {
+    int64_t oldMin, oldMax, newMin, newMax;
+    bool hadMin = getMinValue(oldMin);
+    bool hadMax = getMaxValue(oldMax);
+    unionRIC(ric);
+    if (hadMin && getMinValue(newMin) && newMin < oldMin)
+        LowerBoundState = BoundState::NEG_INF;
+    if (hadMax && getMaxValue(newMax) && newMax > oldMax)
+        UpperBoundState = BoundState::INF;
+    canonicalize(*this);
+    return true;
+}
+
+// Restrict this RIC to the values in [minValue, maxValue]. The minimum and
+// maximum int64_t values leave the corresponding side unconstrained. Return
+// false, and leave this RIC unchanged, if the result is empty or not
+// representable.
+bool ReducedIntervalCongruence::meetInterval(int64_t minValue,
+                                             int64_t maxValue) {
+    if (Alignment == 0)
+        return Offset >= minValue && Offset <= maxValue;
+
+    int64_t curMin, curMax;
+    bool hasLow = true, hasHigh = true;
+    if (getMinValue(curMin))
+        minValue = std::max(minValue, curMin);
+    else if (LowerBoundState == BoundState::SET)
+        return false;
+    else
+        hasLow = minValue != std::numeric_limits<int64_t>::min();
+    if (getMaxValue(curMax))
+        maxValue = std::min(maxValue, curMax);
+    else if (UpperBoundState == BoundState::SET)
+        return false;
+    else
+        hasHigh = maxValue != std::numeric_limits<int64_t>::max();
+    if (minValue > maxValue)
+        return false;
+    if (Alignment > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+        return false;
+
+    // Compute the indices of the smallest and the largest values in range.
+    int64_t align = static_cast<int64_t>(Alignment);
+    int64_t lowIndex = IndexLowerBound, highIndex = IndexUpperBound;
+    if (hasLow) {
+        int64_t lowDiff;
+        if (llvm::SubOverflow(minValue, Offset, lowDiff))
+            return false;
+        lowIndex = lowDiff / align;
+        if (lowDiff > 0 && lowDiff % align != 0)
+            lowIndex++;
+    }
+    if (hasHigh) {
+        int64_t highDiff;
+        if (llvm::SubOverflow(maxValue, Offset, highDiff))
+            return false;
+        highIndex = highDiff / align;
+        if (highDiff < 0 && highDiff % align != 0)
+            highIndex--;
+    }
+    if (hasLow && hasHigh && lowIndex > highIndex)
+        return false;
+
+    if (hasLow) {
+        IndexLowerBound = lowIndex;
+        LowerBoundState = BoundState::SET;
+    }
+    if (hasHigh) {
+        IndexUpperBound = highIndex;
+        UpperBoundState = BoundState::SET;
+    }
     return true;
 }
 
@@ -53,12 +53,19 @@ public:
     bool intersectRIC(ReducedIntervalCongruence &ric);
     bool unionRIC(ReducedIntervalCongruence &ric);
     bool widenRIC(ReducedIntervalCongruence &ric);
+    bool meetInterval(int64_t minValue, int64_t maxValue);
     bool adjustRIC(int64_t value);
     bool removeLowerBounds();
     bool removeUpperBounds();
 
     bool multiplyRIC(int64_t times);
 
+    // Get the smallest or largest value, if the corresponding bound is set
+    // and the value is representable.
+    bool getMinValue(int64_t &value) const;
+    bool getMaxValue(int64_t &value) const;
+    bool isSingleton() const;
+
     // Getters
     uint64_t getAlignment() const { return Alignment; }
     int64_t getIndexLowerBound() const { return IndexLowerBound; }
@@ -79,7 +86,9 @@ public:
 
     bool operator==(const ReducedIntervalCongruence &ric) const {
         return ric.Alignment == Alignment && ric.IndexLowerBound == IndexLowerBound &&
-            ric.IndexUpperBound == IndexUpperBound && ric.Offset == Offset;
+            ric.IndexUpperBound == IndexUpperBound && ric.Offset == Offset &&
+            ric.LowerBoundState == LowerBoundState &&
+            ric.UpperBoundState == UpperBoundState;
     }
 };
 
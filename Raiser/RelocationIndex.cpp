@@ -0,0 +1,67 @@
+//===-- RelocationIndex.cpp -------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the implementation of RelocationIndex class for use by
+// llvm-mctoll.
+//
+//===----------------------------------------------------------------------===//
+
+#include "RelocationIndex.h"
+#include <algorithm>
+
+using namespace llvm;
+using namespace llvm::object;
+using namespace llvm::mctoll;
+
+void RelocationIndex::addDynamicRelocation(const RelocationRef &Reloc) {
+  // Record only the first relocation added for an offset.
+  DynRelocOffsetMap.try_emplace(Reloc.getOffset(), DynRelocs.size());
+  DynRelocs.push_back(Reloc);
+}
+
+void RelocationIndex::addTextRelocations(const SectionRef &RelocSec) {
+  std::vector<std::pair<uint64_t, RelocationRef>> Relocs;
+  for (const RelocationRef &Reloc : TextRelocs)
+    Relocs.emplace_back(Reloc.getOffset(), Reloc);
+  for (const RelocationRef &Reloc : RelocSec.relocations())
+    Relocs.emplace_back(Reloc.getOffset(), Reloc);
+
+  // Sort the relocations by offset. Querying the offset of a relocation
+  // requires reading the relocation record. So, offsets are cached.
+  std::stable_sort(Relocs.begin(), Relocs.end(),
+                   [](const std::pair<uint64_t, RelocationRef> &A,
+                      const std::pair<uint64_t, RelocationRef> &B) {
+                     return A.first < B.first;
+                   });
+
+  TextRelocs.clear();
+  TextRelocOffsets.clear();
+  TextRelocs.reserve(Relocs.size());
+  TextRelocOffsets.reserve(Relocs.size());
+  for (const auto &R : Relocs) {
+    TextRelocOffsets.push_back(R.first);
+    TextRelocs.push_back(R.second);
+  }
+}
+
+const RelocationRef *
+RelocationIndex::findDynamicRelocation(uint64_t Offset) const {
+  auto Iter = DynRelocOffsetMap.find(Offset);
+  if (Iter == DynRelocOffsetMap.end())
+    return nullptr;
+  return &DynRelocs[Iter->second];
+}
+
+const RelocationRef *RelocationIndex::findTextRelocation(uint64_t Begin,
+                                                         uint64_t End) const {
+  auto Iter =
+      std::lower_bound(TextRelocOffsets.begin(), TextRelocOffsets.end(), Begin);
+  if (Iter == TextRelocOffsets.end() || *Iter >= End)
+    return nullptr;
+  return &TextRelocs[std::distance(TextRelocOffsets.begin(), Iter)];
+}
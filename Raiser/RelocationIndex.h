@@ -0,0 +1,65 @@
+//===-- RelocationIndex.h ---------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the definition of RelocationIndex class that provides
+// offset based lookup of the relocations of the binary being raised.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_LLVM_MCTOLL_RELOCATIONINDEX_H
+#define LLVM_TOOLS_LLVM_MCTOLL_RELOCATIONINDEX_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Object/ObjectFile.h"
+#include <vector>
+
+namespace llvm {
+namespace mctoll {
+
+/// Index of the dynamic relocations and the text section relocations of an
+/// object file. Dynamic relocations are looked up by offset using a hash
+/// table. Text relocations are kept sorted by offset and looked up by offset
+/// range using a binary search.
+class RelocationIndex {
+public:
+  RelocationIndex() = default;
+  RelocationIndex(const RelocationIndex &) = delete;
+  RelocationIndex &operator=(const RelocationIndex &) = delete;
+
+  /// Add dynamic relocation Reloc to the index.
+  void addDynamicRelocation(const object::RelocationRef &Reloc);
+
+  /// Add all relocations of section RelocSec, that holds the relocations of
+  /// the text section, to the index.
+  void addTextRelocations(const object::SectionRef &RelocSec);
+
+  /// Return the dynamic relocation with offset Offset. If more than one such
+  /// relocation exists, return the one that was added first. Return nullptr
+  /// if no such relocation exists.
+  const object::RelocationRef *findDynamicRelocation(uint64_t Offset) const;
+
+  /// Return the text relocation with the smallest offset in the range
+  /// [Begin, End), or nullptr if no such relocation exists.
+  const object::RelocationRef *findTextRelocation(uint64_t Begin,
+                                                  uint64_t End) const;
+
+private:
+  /// Dynamic relocations in the order they were added.
+  std::vector<object::RelocationRef> DynRelocs;
+  /// Offset to index of the first dynamic relocation with that offset.
+  DenseMap<uint64_t, unsigned> DynRelocOffsetMap;
+  /// Text relocations sorted by offset.
+  std::vector<object::RelocationRef> TextRelocs;
+  /// TextRelocOffsets[I] is the offset of TextRelocs[I].
+  std::vector<uint64_t> TextRelocOffsets;
+};
+
+} // end namespace mctoll
+} // end namespace llvm
+
+#endif // LLVM_TOOLS_LLVM_MCTOLL_RELOCATIONINDEX_H
@@ -0,0 +1,113 @@
+//===-- SectionMap.cpp ------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the implementation of SectionMap class for use by
+// llvm-mctoll.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SectionMap.h"
+#include "llvm/BinaryFormat/ELF.h"
+#include "llvm/Object/ELFObjectFile.h"
+#include <algorithm>
+
+using namespace llvm;
+using namespace llvm::object;
+using namespace llvm::mctoll;
+
+static SectionMap::SectionKind classifySection(const SectionRef &Sec,
+                                               StringRef Name) {
+  if (Name.startswith(".plt"))
+    return SectionMap::SK_PLT;
+  if (Name.startswith(".got"))
+    return SectionMap::SK_GOT;
+  if (Sec.isText())
+    return SectionMap::SK_Text;
+  if (Sec.isBSS())
+    return SectionMap::SK_BSS;
+  if (Sec.isData()) {
+    if (isa<ELFObjectFileBase>(Sec.getObject()) &&
+        !(ELFSectionRef(Sec).getFlags() & ELF::SHF_WRITE))
+      return SectionMap::SK_ROData;
+    return SectionMap::SK_Data;
+  }
+  return SectionMap::SK_Other;
+}
+
+void SectionMap::build(const ObjectFile *Obj) {
+  Entries.clear();
+  MaxEnd.clear();
+  IndexToEntry.clear();
+
+  for (const SectionRef &Sec : Obj->sections()) {
+    StringRef Name;
+    if (auto NameOrErr = Sec.getName())
+      Name = *NameOrErr;
+    else
+      consumeError(NameOrErr.takeError());
+
+    ArrayRef<uint8_t> Contents;
+    if (auto ContentsOrErr = Sec.getContents())
+      Contents = arrayRefFromStringRef(*ContentsOrErr);
+    else
+      consumeError(ContentsOrErr.takeError());
+
+    Entries.push_back({Sec.getAddress(), Sec.getSize(), Sec.getAlignment(),
+                       Sec.getIndex(), classifySection(Sec, Name),
+                       Sec.isText(), Sec.isData(), Sec.isBSS(), Name, Contents,
+                       Sec});
+  }
+
+  std::sort(Entries.begin(), Entries.end(),
+            [](const SectionEntry &A, const SectionEntry &B) {
+              if (A.Address != B.Address)
+                return A.Address < B.Address;
+              return A.Index < B.Index;
+            });
+
+  MaxEnd.reserve(Entries.size());
+  uint64_t CurMaxEnd = 0;
+  for (unsigned Idx = 0, Sz = Entries.size(); Idx < Sz; Idx++) {
+    const SectionEntry &Entry = Entries[Idx];
+    CurMaxEnd = std::max(CurMaxEnd, Entry.getEnd());
+    MaxEnd.push_back(CurMaxEnd);
+    if (IndexToEntry.size() <= Entry.Index)
+      IndexToEntry.resize(Entry.Index + 1, ~0U);
+    IndexToEntry[Entry.Index] = Idx;
+  }
+}
+
+const SectionMap::SectionEntry *
+SectionMap::findSectionContaining(uint64_t Addr, bool IncludeEnd,
+                                  SectionPredicate Pred) const {
+  // Find the first section with address greater than Addr. Only sections
+  // preceding it may contain Addr.
+  auto Iter = std::upper_bound(
+      Entries.begin(), Entries.end(), Addr,
+      [](uint64_t A, const SectionEntry &E) { return A < E.Address; });
+  const SectionEntry *Found = nullptr;
+  for (size_t Idx = std::distance(Entries.begin(), Iter); Idx > 0; Idx--) {
+    // No section at or before Idx - 1 extends to Addr.
+    if (MaxEnd[Idx - 1] < Addr || (!IncludeEnd && MaxEnd[Idx - 1] == Addr))
+      break;
+    const SectionEntry &Entry = Entries[Idx - 1];
+    bool Contains = IncludeEnd ? (Entry.getEnd() >= Addr)
+                               : (Entry.getEnd() > Addr);
+    if (Contains && (!Pred || Pred(Entry)) &&
+        (Found == nullptr || Entry.Index < Found->Index))
+      Found = &Entry;
+  }
+  return Found;
+}
+
+const SectionMap::SectionEntry *
+SectionMap::getSectionAtIndex(uint64_t Index) const {
+  if (Index >= IndexToEntry.size() || IndexToEntry[Index] == ~0U)
+    return nullptr;
+  return &Entries[IndexToEntry[Index]];
+}
@@ -0,0 +1,94 @@
+//===-- SectionMap.h --------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the definition of SectionMap class that provides
+// address and index based lookup of the sections of the binary being raised.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_LLVM_MCTOLL_SECTIONMAP_H
+#define LLVM_TOOLS_LLVM_MCTOLL_SECTIONMAP_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/Object/ObjectFile.h"
+#include <vector>
+
+namespace llvm {
+namespace mctoll {
+
+/// Table of the sections of an object file, built once per object file.
+/// Section names and contents are read while building the table. Sections are
+/// kept sorted by address and augmented with the maximum end address of all
+/// preceding sections. This allows resolving an address to a section using a
+/// binary search, even if section address ranges overlap (as is the case for
+/// non-allocatable sections).
+class SectionMap {
+public:
+  enum SectionKind {
+    SK_Other,
+    SK_Text,
+    SK_ROData,
+    SK_Data,
+    SK_BSS,
+    SK_PLT,
+    SK_GOT
+  };
+
+  struct SectionEntry {
+    uint64_t Address;
+    uint64_t Size;
+    uint64_t Alignment;
+    // Index of the section in the section table
+    uint64_t Index;
+    SectionKind Kind;
+    // Properties as reported by the corresponding methods of SectionRef
+    bool IsText;
+    bool IsData;
+    bool IsBSS;
+    StringRef Name;
+    ArrayRef<uint8_t> Contents;
+    object::SectionRef Section;
+
+    uint64_t getEnd() const { return Address + Size; }
+  };
+
+  using SectionPredicate = function_ref<bool(const SectionEntry &)>;
+
+  SectionMap() = default;
+  SectionMap(const SectionMap &) = delete;
+  SectionMap &operator=(const SectionMap &) = delete;
+
+  /// Build the table of sections of Obj.
+  void build(const object::ObjectFile *Obj);
+
+  /// Return the section, satisfying Pred if specified, whose address range
+  /// contains Addr. The address range of a section is [Address, Address+Size)
+  /// or [Address, Address+Size] if IncludeEnd is true. If more than one such
+  /// section exists, return the one with the smallest section index. Return
+  /// nullptr if no such section exists.
+  const SectionEntry *
+  findSectionContaining(uint64_t Addr, bool IncludeEnd,
+                        SectionPredicate Pred = nullptr) const;
+
+  /// Return the section with section index Index, or nullptr if none exists.
+  const SectionEntry *getSectionAtIndex(uint64_t Index) const;
+
+private:
+  /// Sections sorted by address and section index.
+  std::vector<SectionEntry> Entries;
+  /// MaxEnd[I] is the largest end address of Entries[0..I].
+  std::vector<uint64_t> MaxEnd;
+  /// Section index to index of corresponding entry in Entries.
+  std::vector<unsigned> IndexToEntry;
+};
+
+} // end namespace mctoll
+} // end namespace llvm
+
+#endif // LLVM_TOOLS_LLVM_MCTOLL_SECTIONMAP_H
@@ -0,0 +1,131 @@
+//===-- SymbolIndex.cpp -----------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the implementation of SymbolIndex class for use by
+// llvm-mctoll.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SymbolIndex.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Object/ELFObjectFile.h"
+#include <algorithm>
+#include <queue>
+
+using namespace llvm;
+using namespace llvm::object;
+using namespace llvm::mctoll;
+
+void SymbolIndex::build(const ObjectFile *Obj) {
+  Entries.clear();
+  for (std::vector<CoverSegment> &TypeSegments : Segments)
+    TypeSegments.clear();
+
+  const auto *ELFObj = dyn_cast<ELFObjectFileBase>(Obj);
+  if (ELFObj == nullptr)
+    return;
+
+  unsigned Order = 0;
+  for (const ELFSymbolRef Symbol : ELFObj->symbols()) {
+    unsigned SymOrder = Order++;
+    auto SymNameOrErr = Symbol.getName();
+    if (!SymNameOrErr) {
+      // No need to report. Just consume it.
+      consumeError(SymNameOrErr.takeError());
+      continue;
+    }
+    auto SymAddrOrErr = Symbol.getAddress();
+    if (!SymAddrOrErr) {
+      consumeError(SymAddrOrErr.takeError());
+      continue;
+    }
+    Entries.push_back({*SymAddrOrErr, Symbol.getSize(), Symbol.getELFType(),
+                       SymOrder, *SymNameOrErr, Symbol});
+  }
+
+  std::sort(Entries.begin(), Entries.end(),
+            [](const SymbolEntry &A, const SymbolEntry &B) {
+              if (A.Address != B.Address)
+                return A.Address < B.Address;
+              return A.Order < B.Order;
+            });
+
+  for (unsigned Type = 0; Type < NumSymbolTypes; Type++)
+    buildSegments(Type);
+}
+
+void SymbolIndex::buildSegments(uint8_t Type) {
+  // Symbols of type Type covering at least one address, in address order.
+  std::vector<unsigned> TypeEntries;
+  std::vector<uint64_t> Bounds;
+  for (unsigned Idx = 0, Sz = Entries.size(); Idx < Sz; Idx++) {
+    const SymbolEntry &Entry = Entries[Idx];
+    if (Entry.Type != Type || Entry.Size == 0)
+      continue;
+    TypeEntries.push_back(Idx);
+    Bounds.push_back(Entry.Address);
+    Bounds.push_back(Entry.getEnd());
+  }
+  llvm::sort(Bounds);
+  Bounds.erase(std::unique(Bounds.begin(), Bounds.end()), Bounds.end());
+
+  // Sweep the bounds in address order, keeping the symbols covering the
+  // current address in a heap ordered by symbol table order. Symbols that
+  // end at or before the current address are removed from the heap lazily.
+  auto LaterInSymbolTable = [this](unsigned A, unsigned B) {
+    return Entries[A].Order > Entries[B].Order;
+  };
+  std::priority_queue<unsigned, std::vector<unsigned>,
+                      decltype(LaterInSymbolTable)>
+      Covering(LaterInSymbolTable);
+  std::vector<CoverSegment> &TypeSegments = Segments[Type];
+  auto NextEntry = TypeEntries.begin();
+  for (size_t BoundIdx = 0; BoundIdx + 1 < Bounds.size(); BoundIdx++) {
+    uint64_t Start = Bounds[BoundIdx];
+    uint64_t End = Bounds[BoundIdx + 1];
+    for (; NextEntry != TypeEntries.end() &&
+           Entries[*NextEntry].Address == Start;
+         NextEntry++)
+      Covering.push(*NextEntry);
+    while (!Covering.empty() && Entries[Covering.top()].getEnd() <= Start)
+      Covering.pop();
+    if (Covering.empty())
+      continue;
+    unsigned EntryIdx = Covering.top();
+    // Extend the previous segment if it is covered by the same symbol.
+    if (!TypeSegments.empty() && TypeSegments.back().End == Start &&
+        TypeSegments.back().EntryIdx == EntryIdx)
+      TypeSegments.back().End = End;
+    else
+      TypeSegments.push_back({Start, End, EntryIdx});
+  }
+}
+
+const SymbolIndex::SymbolEntry *
+SymbolIndex::findSymbolContaining(uint64_t Addr,
+                                  ArrayRef<uint8_t> Types) const {
+  const SymbolEntry *Found = nullptr;
+  for (uint8_t Type : Types) {
+    if (Type >= NumSymbolTypes)
+      continue;
+    // Find the last segment starting at or before Addr.
+    const std::vector<CoverSegment> &TypeSegments = Segments[Type];
+    auto Iter = std::upper_bound(
+        TypeSegments.begin(), TypeSegments.end(), Addr,
+        [](uint64_t A, const CoverSegment &S) { return A < S.Start; });
+    if (Iter == TypeSegments.begin())
+      continue;
+    const CoverSegment &Segment = *std::prev(Iter);
+    if (Segment.End <= Addr)
+      continue;
+    const SymbolEntry &Entry = Entries[Segment.EntryIdx];
+    if (Found == nullptr || Entry.Order < Found->Order)
+      Found = &Entry;
+  }
+  return Found;
+}
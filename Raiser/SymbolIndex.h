@@ -0,0 +1,87 @@
+//===-- SymbolIndex.h -------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the definition of SymbolIndex class that provides
+// address and name based lookup of the symbols of the binary being raised.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_LLVM_MCTOLL_SYMBOLINDEX_H
+#define LLVM_TOOLS_LLVM_MCTOLL_SYMBOLINDEX_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Object/ObjectFile.h"
+#include <vector>
+
+namespace llvm {
+namespace mctoll {
+
+/// Index of the ELF symbols of an object file, built once per object file.
+/// For each symbol type, the address ranges of the symbols of that type are
+/// split into disjoint segments, each recording the symbol that appears first
+/// in the symbol table among those covering it. This allows finding the symbol
+/// whose range covers an address using a binary search per type, even if
+/// symbol ranges overlap, e.g., when a large object covers many others.
+class SymbolIndex {
+public:
+  struct SymbolEntry {
+    uint64_t Address;
+    uint64_t Size;
+    uint8_t Type;
+    // Position of the symbol in the symbol table
+    unsigned Order;
+    StringRef Name;
+    object::SymbolRef Symbol;
+
+    uint64_t getEnd() const { return Address + Size; }
+  };
+
+  SymbolIndex() = default;
+  SymbolIndex(const SymbolIndex &) = delete;
+  SymbolIndex &operator=(const SymbolIndex &) = delete;
+
+  /// Build the index of symbols of Obj. Symbols of non-ELF object files are
+  /// not indexed.
+  void build(const object::ObjectFile *Obj);
+
+  /// Return the symbol, whose type is one of Types, with address range
+  /// [Address, Address + Size) containing Addr. If more than one such symbol
+  /// exists, return the one that appears first in the symbol table. Return
+  /// nullptr if no such symbol exists.
+  const SymbolEntry *findSymbolContaining(uint64_t Addr,
+                                          ArrayRef<uint8_t> Types) const;
+
+  size_t size() const { return Entries.size(); }
+
+private:
+  /// Address range [Start, End) covered by symbol Entries[EntryIdx], which
+  /// appears first in the symbol table among the symbols of its type covering
+  /// the range.
+  struct CoverSegment {
+    uint64_t Start;
+    uint64_t End;
+    unsigned EntryIdx;
+  };
+
+  /// Number of ELF symbol types, which are encoded in 4 bits.
+  static constexpr unsigned NumSymbolTypes = 16;
+
+  /// Build the segments of the ranges of the symbols of type Type.
+  void buildSegments(uint8_t Type);
+
+  /// Symbols sorted by address and symbol table order.
+  std::vector<SymbolEntry> Entries;
+  /// Disjoint segments, sorted by address, of the ranges of the symbols of
+  /// each type.
+  std::vector<CoverSegment> Segments[NumSymbolTypes];
+};
+
+} // end namespace mctoll
+} // end namespace llvm
+
+#endif // LLVM_TOOLS_LLVM_MCTOLL_SYMBOLINDEX_H
@@ -177,7 +177,10 @@ Type *X86MachineInstructionRaiser::getFunctionReturnType() {
 // Construct prototype of the Function for the MachineFunction being raised.
 FunctionType *X86MachineInstructionRaiser::getRaisedFunctionPrototype() {
   // Raise the jumptable
-  raiseMachineJumpTable();
+  if (!JumpTablesRaised) {
+    raiseMachineJumpTable();
+    JumpTablesRaised = true;
+  }
 
   if (RaisedFunction != nullptr)
     return RaisedFunction->getFunctionType();
@@ -485,6 +488,10 @@ FunctionType *X86MachineInstructionRaiser::getRaisedFunctionPrototype() {
 
   // 4. Delete the tempFunc from module list to allow for the creation of the
   //    real function to add the correct one to FunctionList of the module.
+  //    The real function is added at the position of tempFunc, so that the
+  //    order of functions in the module does not depend on the order in
+  //    which prototypes are constructed.
+  auto InsertPt = std::next(TempFunctionPtr->getIterator());
   Mod->getFunctionList().remove(TempFunctionPtr);
 
   // 3. Create a function type using the discovered arguments and return value.
@@ -493,7 +500,8 @@ FunctionType *X86MachineInstructionRaiser::getRaisedFunctionPrototype() {
 
   // 4. Create the real Function now that we have discovered the arguments.
   RaisedFunction =
-      Function::Create(FT, GlobalValue::ExternalLinkage, FunctionName, Mod);
+      Function::Create(FT, GlobalValue::ExternalLinkage, FunctionName);
+  Mod->getFunctionList().insert(InsertPt, RaisedFunction);
 
   // Set global linkage
   RaisedFunction->setLinkage(GlobalValue::ExternalLinkage);
@@ -519,6 +527,62 @@ FunctionType *X86MachineInstructionRaiser::getRaisedFunctionPrototype() {
   return RaisedFunction->getFunctionType();
 }
 
+// Add the MachineFunctionRaisers of functions of the module that are direct
+// call or tail call targets of MF to Callees.
+void X86MachineInstructionRaiser::collectCallees(
+    SmallPtrSetImpl<MachineFunctionRaiser *> &Callees) {
+  MCInstRaiser *MCIR = getMCInstRaiser();
+  assert(MCIR != nullptr && "MCInstRaiser not initialized");
+  for (const MachineBasicBlock &MBB : MF) {
+    for (const MachineInstr &MI : MBB) {
+      unsigned int Opcode = MI.getOpcode();
+      if ((Opcode != X86::CALL64pcrel32) && (Opcode != X86::JMP_1) &&
+          (Opcode != X86::JMP_4))
+        continue;
+
+      const MachineOperand &MO = MI.getOperand(0);
+      if (!MO.isImm())
+        continue;
+      // Compute the target of the control transfer as in getCalledFunction()
+      uint64_t MCInstOffset = MCIR->getMCInstIndex(MI);
+      uint64_t MCInstSize = MCIR->getMCInstSize(MCInstOffset);
+      uint64_t TargetOffset = MCInstOffset + MCInstSize + MO.getImm();
+      // A branch to a block of MF is not a tail call.
+      if ((Opcode != X86::CALL64pcrel32) &&
+          (MCIR->getMBBNumberOfMCInstOffset(TargetOffset, MF) != -1))
+        continue;
+
+      MachineFunctionRaiser *Callee =
+          MR->getMFRaiserAt(TargetOffset + MR->getTextSectionAddress());
+      if (Callee == nullptr)
+        Callee = MR->getMFRaiserUsingTextReloc(MCInstOffset, MCInstSize);
+      if (Callee != nullptr)
+        Callees.insert(Callee);
+    }
+  }
+}
+
+// Discard the raised function and restore the place-holder function in its
+// position in the module. The raised function is not expected to be
+// referenced since no instructions are raised yet.
+bool X86MachineInstructionRaiser::discardRaisedFunctionPrototype() {
+  if (RaisedFunction == nullptr)
+    return true;
+
+  assert(RaisedFunction->use_empty() &&
+         "Unexpected use of raised function being discarded");
+  Function *TempFunctionPtr =
+      const_cast<ModuleRaiser *>(MR)->removePlaceholderRaisedFunctionMap(
+          RaisedFunction);
+  auto &FunctionList = MR->getModule()->getFunctionList();
+  // Erase the raised function before inserting the place-holder function
+  // with the same name, to avoid renaming the latter.
+  auto InsertPt = FunctionList.erase(RaisedFunction->getIterator());
+  FunctionList.insert(InsertPt, TempFunctionPtr);
+  RaisedFunction = nullptr;
+  return true;
+}
+
 // Discover and return the type of return register (viz., RAX or its
 // sub-register) definition that reaches MBB. Only definition of return register
 // after the last call instruction or that found on a reverse traversal without
@@ -738,7 +802,7 @@ bool X86MachineInstructionRaiser::buildFuncArgTypeVector(
         SSEArgNumTypeMap.insert(
             std::make_pair(ArgNum, Type::getDoubleTy(Ctx)));
       } else {
-        outs() << x86RegisterInfo->getRegAsmName(PReg) << "\n";
+        errs() << (x86RegisterInfo->getRegAsmName(PReg) + "\n").str();
         llvm_unreachable("Unhandled register type encountered in binary");
       }
     }
@@ -13,6 +13,7 @@
 
 #include "X86MachineInstructionRaiser.h"
 #include "llvm-mctoll.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/CodeGen/MachineInstr.h"
 #include "llvm/CodeGen/MachineJumpTableInfo.h"
 #include "llvm/Object/ELFObjectFile.h"
@@ -26,6 +27,8 @@
 using namespace llvm;
 using namespace llvm::mctoll;
 
+STATISTIC(NumJumpTablesRecovered, "Number of jump tables recovered");
+
 bool X86MachineInstructionRaiser::raiseMachineJumpTable() {
   // A vector to record MBBS that need be erased upon jump table creation.
   std::vector<MachineBasicBlock *> MBBsToBeErased;
@@ -58,32 +61,21 @@ bool X86MachineInstructionRaiser::raiseMachineJumpTable() {
             TextSectionAddress + MCInstIndex + MCInstSz + JmpOffset;
         JmpTblBaseReg = JmpTblBaseCalcMI.getOperand(0).getReg();
         // Get the contents of the section with JmpTblBaseMemAddress
-        const ELF64LEObjectFile *Elf64LEObjFile =
-            dyn_cast<ELF64LEObjectFile>(MR->getObjectFile());
-        assert(Elf64LEObjFile != nullptr &&
+        assert(isa<ELF64LEObjectFile>(MR->getObjectFile()) &&
                "Only 64-bit ELF binaries supported at present.");
         const unsigned char *DataContent = nullptr;
         size_t DataSize = 0;
         size_t JmpTblEntryOffset = 0;
-        // Find the section.
-        for (section_iterator SecIter : Elf64LEObjFile->sections()) {
-          // BSS section content is not mapped. Skip it since reading its
-          // content for jump table is not valid.
-          if (!SecIter->isBSS()) {
-            uint64_t SecStart = SecIter->getAddress();
-            uint64_t SecEnd = SecStart + SecIter->getSize();
-            if ((SecStart <= JmpTblBaseMemAddress) &&
-                (SecEnd >= JmpTblBaseMemAddress)) {
-              StringRef Contents = unwrapOrError(
-                  SecIter->getContents(), MR->getObjectFile()->getFileName());
-              DataContent =
-                  static_cast<const unsigned char *>(Contents.bytes_begin());
-              DataSize = SecIter->getSize();
-              JmpTblEntryOffset = JmpTblBaseMemAddress - SecStart;
-
-              break;
-            }
-          }
+        // Find the section. BSS section content is not mapped. Skip it since
+        // reading its content for jump table is not valid.
+        const SectionMap::SectionEntry *Sec =
+            MR->getSectionMap().findSectionContaining(
+                JmpTblBaseMemAddress, /* IncludeEnd */ true,
+                [](const SectionMap::SectionEntry &S) { return !S.IsBSS; });
+        if (Sec != nullptr) {
+          DataContent = Sec->Contents.data();
+          DataSize = Sec->Size;
+          JmpTblEntryOffset = JmpTblBaseMemAddress - Sec->Address;
         }
 
         // Section with jump table base has no content.
@@ -137,29 +129,24 @@ bool X86MachineInstructionRaiser::raiseMachineJumpTable() {
             if (JmpTblBaseAddress > 0) {
               // This value should be an absolute offset into a rodata section.
               // Get the contents of the section with JmpTblBase
-              const ELF64LEObjectFile *Elf64LEObjFile =
-                  dyn_cast<ELF64LEObjectFile>(MR->getObjectFile());
-              assert(Elf64LEObjFile != nullptr &&
+              assert(isa<ELF64LEObjectFile>(MR->getObjectFile()) &&
                      "Only 64-bit ELF binaries supported at present.");
               StringRef Contents;
               JmpTblBaseReg = JmpTblBaseCalcMI.getOperand(0).getReg();
               size_t DataSize = 0;
               size_t JmpTblBaseOffset = 0;
-              // Find the section.
-              for (section_iterator SecIter : Elf64LEObjFile->sections()) {
-                uint64_t SecStart = SecIter->getAddress();
-                uint64_t SecEnd = SecStart + SecIter->getSize();
-                // Potential JmpTblBase is in a data section
-                // OK to cast to unsigned as JmpTblBase is > 0 at this point.
-                if ((SecStart <= (unsigned)JmpTblBaseAddress) &&
-                    (SecEnd >= (unsigned)JmpTblBaseAddress) &&
-                    SecIter->isData()) {
-                  Contents = unwrapOrError(SecIter->getContents(),
-                                           MR->getObjectFile()->getFileName());
-                  DataSize = SecIter->getSize();
-                  JmpTblBaseOffset = JmpTblBaseAddress - SecStart;
-                  break;
-                }
+              // Find the section. Potential JmpTblBase is in a data section.
+              // OK to cast to unsigned as JmpTblBase is > 0 at this point.
+              const SectionMap::SectionEntry *Sec =
+                  MR->getSectionMap().findSectionContaining(
+                      (unsigned)JmpTblBaseAddress, /* IncludeEnd */ true,
+                      [](const SectionMap::SectionEntry &S) {
+                        return S.IsData;
+                      });
+              if (Sec != nullptr) {
+                Contents = toStringRef(Sec->Contents);
+                DataSize = Sec->Size;
+                JmpTblBaseOffset = JmpTblBaseAddress - Sec->Address;
               }
 
               // Section with jump table base has no content.
@@ -277,6 +264,7 @@ bool X86MachineInstructionRaiser::raiseMachineJumpTable() {
         MachineInstr &BranchInstr = *(SwitchMBB->getFirstTerminator());
         assert(BranchInstr.isIndirectBranch());
         // Delete the unconditional branch instruction.
+        MCIR->forgetMCInstIndex(BranchInstr);
         SwitchMBB->erase(BranchInstr);
 
         // Set default basic block in jump table info
@@ -332,6 +320,7 @@ bool X86MachineInstructionRaiser::raiseMachineJumpTable() {
           // Delete the conditional branch instruction. The target of this
           // instruction is default block and fall-through is the block that
           // computes switch table base.
+          MCIR->forgetMCInstIndex(BranchInstr);
           SwitchMBB->erase(BranchInstr);
         } else
           llvm_unreachable("Conditional branch expected in switch basic block "
@@ -350,6 +339,7 @@ bool X86MachineInstructionRaiser::raiseMachineJumpTable() {
       BuildMI(SwitchMBB, DebugLoc(), TII->get(X86::JMP64r))
           .addJumpTableIndex(JmpTblInfo.JTIdx);
       JTList.push_back(JmpTblInfo);
+      ++NumJumpTablesRecovered;
 
       // Add jump table targets as successors of SwitchMBB.
       for (MachineBasicBlock *NewSucc : JmpTgtMBBvec) {
@@ -365,6 +355,8 @@ bool X86MachineInstructionRaiser::raiseMachineJumpTable() {
     // Remove MBB from the successors of all the predecessors of MBB
     for (auto *Pred : MBB->predecessors())
       Pred->removeSuccessor(MBB);
+    for (const MachineInstr &MI : *MBB)
+      MCIR->forgetMCInstIndex(MI);
     MBB->eraseFromParent();
   }
 
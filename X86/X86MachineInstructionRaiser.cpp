@@ -22,6 +22,7 @@
 #include "llvm-mctoll.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/CodeGen/LivePhysRegs.h"
 #include "llvm/CodeGen/LoopTraversal.h"
 #include "llvm/CodeGen/MachineInstr.h"
@@ -65,6 +66,9 @@ X86MachineInstructionRaiser::X86MachineInstructionRaiser(MachineFunction &MF,
   valueSetAnalysis = nullptr;
   MDB = nullptr;
   Domain = nullptr;
+  StackScope = nullptr;
+  GlobalScope = nullptr;
+  JumpTablesRaised = false;
 }
 
 bool X86MachineInstructionRaiser::raisePushInstruction(const MachineInstr &MI) {
@@ -114,8 +118,7 @@ bool X86MachineInstructionRaiser::raisePushInstruction(const MachineInstr &MI) {
 
   // Store operand at stack top (StackRef)
   StoreInst *Store = new StoreInst(RegValue, StackRef, RaisedBB);
-  MDNode *Scope = MDB->createAnonymousAliasScope(Domain, "store");
-  Store->setMetadata(LLVMContext::MD_alias_scope, Scope);
+  setMemAccessScope(Store, true);
 
   // TODO: Make memory ref relative to stack top
   int64_t StackSlotSize =
@@ -232,7 +235,7 @@ bool X86MachineInstructionRaiser::raiseConvertBWWDDQMachineInstr(
   raisedValues->setPhysRegSSAValue(DefReg, MI.getParent()->getNumber(),
                                    SextInst);
 
-  printf("Sign extension instruction\n"); fflush(stdout);
+  valueSetAnalysis->traceUnhandled(MI);
   return true;
 }
 
@@ -309,7 +312,7 @@ bool X86MachineInstructionRaiser::raiseConvertWDDQQOMachineInstr(
   // Update the value mapping of DefReg_1
   raisedValues->setPhysRegSSAValue(DefReg1, MI.getParent()->getNumber(),
                                    HighBytesInst);
-  printf("Unhandled VSA: \n"); fflush(stdout);
+  valueSetAnalysis->traceUnhandled(MI);
   return true;
 }
 
@@ -473,7 +476,7 @@ bool X86MachineInstructionRaiser::raiseMoveRegToRegMachineInstr(
 
     // Update the value mapping of DstPReg
     raisedValues->setPhysRegSSAValue(DstPReg, MBBNo, CInst);
-    printf("Unhandled VSA: \n"); fflush(stdout);
+    valueSetAnalysis->traceUnhandled(MI);
     
     Success = true;
   } break;
@@ -711,7 +714,7 @@ bool X86MachineInstructionRaiser::raiseMoveRegToRegMachineInstr(
 
       // Update the value mapping of DstPReg
       raisedValues->setPhysRegSSAValue(DstPReg, MBBNo, SI);
-      printf("Unhandled VSA: \n"); fflush(stdout);
+      valueSetAnalysis->traceUnhandled(MI);
     }
   } break;
   default:
@@ -1007,7 +1010,7 @@ bool X86MachineInstructionRaiser::raiseBinaryOpRegToRegMachineInstr(
     // Setting EFLAG bits does not seem to matter, so not setting
     // Set the DstReg value
     raisedValues->setPhysRegSSAValue(DstReg, MBBNo, DstValue);
-    printf("Unhandled VSA: \n"); fflush(stdout);
+    valueSetAnalysis->traceUnhandled(MI);
   } break;
   case X86::IMUL16r:
   case X86::IMUL32r:
@@ -1132,7 +1135,7 @@ bool X86MachineInstructionRaiser::raiseBinaryOpRegToRegMachineInstr(
       raisedValues->setPhysRegSSAValue(X86RegisterUtils::EFLAGS::CF, MBBNo,
                                        ZFTest);
     }
-    printf("Unhandled VSA: \n"); fflush(stdout);
+    valueSetAnalysis->traceUnhandled(MI);
   } break;
   case X86::AND8rr:
   case X86::AND16rr:
@@ -1210,7 +1213,7 @@ bool X86MachineInstructionRaiser::raiseBinaryOpRegToRegMachineInstr(
       raisedValues->testAndSetEflagSSAValue(EFLAGS::SF, MI, DstValue);
       raisedValues->testAndSetEflagSSAValue(EFLAGS::ZF, MI, DstValue);
       raisedValues->testAndSetEflagSSAValue(EFLAGS::PF, MI, DstValue);
-      printf("Unhandled VSA: \n"); fflush(stdout);
+      valueSetAnalysis->traceUnhandled(MI);
     }
     // Clear OF and CF
     raisedValues->setEflagBoolean(EFLAGS::OF, MBBNo, false);
@@ -1277,7 +1280,7 @@ bool X86MachineInstructionRaiser::raiseBinaryOpRegToRegMachineInstr(
     raisedValues->testAndSetEflagSSAValue(EFLAGS::PF, MI, DstValue);
 
     raisedValues->setPhysRegSSAValue(DstReg, MBBNo, DstValue);
-    printf("Unhandled VSA: \n"); fflush(stdout);
+    valueSetAnalysis->traceUnhandled(MI);
   } break;
   case X86::NOT8r:
   case X86::NOT16r:
@@ -1302,7 +1305,7 @@ bool X86MachineInstructionRaiser::raiseBinaryOpRegToRegMachineInstr(
     DstValue = BinOpInst;
 
     raisedValues->setPhysRegSSAValue(DstReg, MBBNo, DstValue);
-    printf("Unhandled VSA: \n"); fflush(stdout);  
+    valueSetAnalysis->traceUnhandled(MI);
   } break;
   case X86::SAR8rCL:
   case X86::SAR16rCL:
@@ -1372,7 +1375,7 @@ bool X86MachineInstructionRaiser::raiseBinaryOpRegToRegMachineInstr(
 
       raisedValues->setPhysRegSSAValue(DstReg, MBBNo, DstValue);
     }
-    printf("Unhandled VSA: \n"); fflush(stdout);
+    valueSetAnalysis->traceUnhandled(MI);
   } break;
   case X86::POPCNT16rr:
   case X86::POPCNT32rr:
@@ -1418,7 +1421,7 @@ bool X86MachineInstructionRaiser::raiseBinaryOpRegToRegMachineInstr(
     // ZF = (SrcValue==0).
     raisedValues->setPhysRegSSAValue(X86RegisterUtils::EFLAGS::ZF, MBBNo,
                                      ZFTest);
-    printf("Unhandled VSA: \n"); fflush(stdout);
+    valueSetAnalysis->traceUnhandled(MI);
   } break;
   case X86::SUBSSrr_Int:
   case X86::SUBSDrr_Int:
@@ -1487,7 +1490,7 @@ bool X86MachineInstructionRaiser::raiseBinaryOpRegToRegMachineInstr(
 
     // Update the value of DstReg
     raisedValues->setPhysRegSSAValue(DstReg, MBBNo, DstValue);
-    printf("Unhandled VSA: \n"); fflush(stdout);
+    valueSetAnalysis->traceUnhandled(MI);
   } break;
   case X86::PANDrr:
   case X86::PANDNrr:
@@ -1584,7 +1587,7 @@ bool X86MachineInstructionRaiser::raiseBinaryOpRegToRegMachineInstr(
     }
 
     raisedValues->setPhysRegSSAValue(DstReg, MBBNo, DstValue);
-    printf("Unhandled VSA: \n"); fflush(stdout);
+    valueSetAnalysis->traceUnhandled(MI);
   } break;
   case X86::MAXSDrr_Int:
   case X86::MAXSSrr_Int:
@@ -1605,7 +1608,7 @@ bool X86MachineInstructionRaiser::raiseBinaryOpRegToRegMachineInstr(
 
     DstReg = MI.getOperand(DestOpIndex).getReg();
     raisedValues->setPhysRegSSAValue(DstReg, MBBNo, SelectInst);
-    printf("Unhandled VSA: \n"); fflush(stdout);
+    valueSetAnalysis->traceUnhandled(MI);
   } break;
   case X86::SBB16rr:
   case X86::SBB32rr:
@@ -1629,7 +1632,7 @@ bool X86MachineInstructionRaiser::raiseBinaryOpRegToRegMachineInstr(
     raisedValues->setPhysRegSSAValue(DstReg, MBBNo, Result);
     raisedValues->testAndSetEflagSSAValue(EFLAGS::OF, MI, Result);
     raisedValues->testAndSetEflagSSAValue(EFLAGS::CF, MI, Result);
-    printf("Unhandled VSA: \n"); fflush(stdout);
+    valueSetAnalysis->traceUnhandled(MI);
   } break;
   case X86::SQRTSDr:
   case X86::SQRTSDr_Int:
@@ -1657,7 +1660,7 @@ bool X86MachineInstructionRaiser::raiseBinaryOpRegToRegMachineInstr(
 
     DstReg = MI.getOperand(DestOpIndex).getReg();
     raisedValues->setPhysRegSSAValue(DstReg, MBBNo, Result);
-    printf("Unhandled VSA: \n"); fflush(stdout);
+    valueSetAnalysis->traceUnhandled(MI);
 
   } break;
   case X86::PADDBrr:
@@ -1730,7 +1733,7 @@ bool X86MachineInstructionRaiser::raiseBinaryOpRegToRegMachineInstr(
 
     // Update the value of DstReg
     raisedValues->setPhysRegSSAValue(DstReg, MBBNo, DstValue);
-    printf("Unhandled VSA: \n"); fflush(stdout);
+    valueSetAnalysis->traceUnhandled(MI);
 
   } break;
   case X86::PMAXSBrr:
@@ -1821,7 +1824,7 @@ bool X86MachineInstructionRaiser::raiseBinaryOpRegToRegMachineInstr(
     raisedValues->setInstMetadataRODataIndex(Src1Value, (Instruction *)Result);
     // Update the value of DstReg
     raisedValues->setPhysRegSSAValue(DstReg, MBBNo, Result);
-    printf("Unhandled VSA: \n"); fflush(stdout);
+    valueSetAnalysis->traceUnhandled(MI);
   } break;
   case X86::UNPCKLPDrr:
   case X86::UNPCKLPSrr: {
@@ -1874,7 +1877,7 @@ bool X86MachineInstructionRaiser::raiseBinaryOpRegToRegMachineInstr(
     raisedValues->setInstMetadataRODataIndex(Src1Value, (Instruction *)Result);
     // Update the value of DstReg
     raisedValues->setPhysRegSSAValue(DstReg, MBBNo, Result);
-    printf("Unhandled VSA: \n"); fflush(stdout);
+    valueSetAnalysis->traceUnhandled(MI);
   } break;
   default:
     MI.dump();
@@ -2391,7 +2394,7 @@ bool X86MachineInstructionRaiser::raiseBinaryOpMemToRegInstr(
   // Update PhysReg to Value map
   raisedValues->setPhysRegSSAValue(DestPReg, MI.getParent()->getNumber(),
                                    BinOpInst);
-  printf("Unhandled VSA: \n"); fflush(stdout);
+  valueSetAnalysis->traceUnhandled(MI);
   return true;
 }
 
@@ -2502,7 +2505,7 @@ bool X86MachineInstructionRaiser::raiseLoadIntToFloatRegInstr(
     pushFPURegisterStack(CInst);
   }
   }
-  printf("Unhandled VSA: \n"); fflush(stdout);
+  valueSetAnalysis->traceUnhandled(MI);
   return true;
 }
 
@@ -2611,7 +2614,7 @@ bool X86MachineInstructionRaiser::raiseStoreIntToFloatRegInstr(
     popFPURegisterStack();
   }
   }
-  printf("Unhandled VSA: \n"); fflush(stdout);
+  valueSetAnalysis->traceUnhandled(MI);
   return true;
 }
 
@@ -2800,7 +2803,6 @@ bool X86MachineInstructionRaiser::raiseMoveFromMemInstr(const MachineInstr &MI,
     srcAloc = AlocType(AlocType::LocalMemLocTy,
                        static_cast<uint64_t>(EffectiveOffset));
     alocInitialized = true;
-    printf("hey there"); fflush(stdout);
   } else if (isEffectiveAddrValue(MemRefValue)) {
     // Effective address
   } else if (isa<GlobalValue>(MemRefValue)) {
@@ -2817,12 +2819,11 @@ bool X86MachineInstructionRaiser::raiseMoveFromMemInstr(const MachineInstr &MI,
     }
     alocInitialized = true;
   } else if (isa<SelectInst>(MemRefValue)) {
-    printf("select\n");
+    LLVM_DEBUG(dbgs() << "VSA: Unhandled load from select\n");
   } else if (isa<GetElementPtrInst>(MemRefValue)) {
-    printf("getelementptr\n");
-
+    LLVM_DEBUG(dbgs() << "VSA: Unhandled load from getelementptr\n");
   } else if (MemRefValue->getType()->isPointerTy()) {
-    printf("ptr\n");
+    LLVM_DEBUG(dbgs() << "VSA: Unhandled load from pointer\n");
     // Find a way to link the ptr to the value
   } 
   
@@ -3146,7 +3147,6 @@ bool X86MachineInstructionRaiser::raiseMoveToMemInstr(const MachineInstr &MI,
   } else if (isa<GlobalValue>(MemRefVal) || isa<GetElementPtrInst>(MemRefVal) ||
           MemRefVal->getType()->isPointerTy()) {
     // atid = AlocType::AlocTypeID::GlobalMemLocTy;
-    printf("move to ptr\n");
     int MemoryRefOpIndex = getMemoryRefOpIndex(MI);
     X86AddressMode MemRef = llvm::getAddressFromInstr(&MI, MemoryRefOpIndex);
     destAloc = AlocType(AlocType::GlobalMemLocTy, MemRef.Disp);
@@ -3230,7 +3230,7 @@ bool X86MachineInstructionRaiser::raiseInplaceMemOpInstr(const MachineInstr &MI,
   // Store the result back in MemRefVal
   new StoreInst(SrcValue, MemRefVal, false, Align(MemOpSize), RaisedBB);
 
-  printf("Unhandled VSA: \n"); fflush(stdout);
+  valueSetAnalysis->traceUnhandled(MI);
 
   return true;
 }
@@ -3245,7 +3245,7 @@ bool X86MachineInstructionRaiser::raiseDivideFromMemInstr(
 
   Value *SrcValue =
       loadMemoryRefValue(MI, MemRefValue, MemoryRefOpIndex, DestopTy);
-  printf("Unhandled VSA: \n"); fflush(stdout);
+  valueSetAnalysis->traceUnhandled(MI);
   return raiseDivideInstr(MI, SrcValue);
 }
 
@@ -3399,7 +3399,7 @@ bool X86MachineInstructionRaiser::raiseDivideInstr(const MachineInstr &MI,
     raisedValues->setPhysRegSSAValue(UseDefReg1, MI.getParent()->getNumber(),
                                      Remainder);
   }
-  printf("Unhandled VSA: \n"); fflush(stdout);
+  valueSetAnalysis->traceUnhandled(MI);
   return true;
 }
 
@@ -3777,7 +3777,7 @@ bool X86MachineInstructionRaiser::raiseCompareMachineInstr(
     default:
       assert(false && "Unhandled sub instruction found");
     }
-    printf("Unhandled VSA: \n"); fflush(stdout);
+    valueSetAnalysis->traceUnhandled(MI);
   }
   // Now update EFLAGS
   assert(MCIDesc.getNumImplicitDefs() == 1 &&
@@ -4033,7 +4033,7 @@ bool X86MachineInstructionRaiser::raiseSetCCMachineInstr(
 
     new StoreInst(StoreVal, MemoryRefValue, false, Align(), RaisedBB);
   }
-  printf("Unhandled VSA: \n"); fflush(stdout);
+  valueSetAnalysis->traceUnhandled(MI);
 
   return true;
 }
@@ -4177,7 +4177,7 @@ bool X86MachineInstructionRaiser::raiseBinaryOpMRIOrMRCEncodedMachineInstr(
   if (DstPReg != X86::NoRegister)
     raisedValues->setPhysRegSSAValue(DstPReg, MI.getParent()->getNumber(),
                                      BinOpInstr);
-  printf("Unhandled VSA: \n"); fflush(stdout);
+  valueSetAnalysis->traceUnhandled(MI);
   return Success;
 }
 
@@ -4684,7 +4684,7 @@ bool X86MachineInstructionRaiser::raiseBinaryOpImmToRegMachineInstr(
     
 
     if (!valueSetHandled) {
-      printf("Unhandled VSA: \n"); fflush(stdout);
+      valueSetAnalysis->traceUnhandled(MI);
     }
   }
   return true;
@@ -4743,7 +4743,7 @@ bool X86MachineInstructionRaiser::raiseIndirectBranchMachineInstr(
     assert(false && "Support to raise indirect branches to non-jumptable "
                     "location not yet implemented");
   }
-  printf("Unhandled VSA: \n"); fflush(stdout);
+  valueSetAnalysis->traceUnhandled(*MI);
 
   return true;
 }
@@ -4786,7 +4786,6 @@ bool X86MachineInstructionRaiser::raiseDirectBranchMachineInstr(
   } else if (MI->isConditionalBranch()) {
     // Find the fall through basic block
     MCInstRaiser::const_mcinst_iter MCIter = MCIR->getMCInstAt(MCInstOffset);
-    LLVMContext &Ctx(MF.getFunction().getContext());
     // Go to next non-nop instruction on the fall-through path.
     bool IsNop = true;
     while (IsNop) {
@@ -4814,241 +4813,19 @@ bool X86MachineInstructionRaiser::raiseDirectBranchMachineInstr(
 
     // Branch condition value
     Value *BranchCond = nullptr;
-    // Predicate operation to be performed
-    Value *TrueValue = ConstantInt::getTrue(Ctx);
-    Value *FalseValue = ConstantInt::getFalse(Ctx);
     auto Opcode = MI->getOpcode();
     assert(((Opcode == X86::JCC_1) || (Opcode == X86::JCC_2) ||
             (Opcode == X86::JCC_4)) &&
            "Conditional branch instruction expected");
-    X86::CondCode CC = X86::COND_INVALID;
-
-    // Unfortunately X86::getCondFromBranch(MI) only looks at JCC_1. We need
-    // to handle JCC_2 and JCC_4 as well.
-    switch (MI->getOpcode()) {
-    default:
-      CC = X86::COND_INVALID;
-      break;
-    case X86::JCC_1:
-    case X86::JCC_2:
-    case X86::JCC_4:
-      CC = static_cast<X86::CondCode>(
-          MI->getOperand(MI->getDesc().getNumOperands() - 1).getImm());
-    }
+    X86::CondCode CC = getBranchCondCode(*MI);
 
-    switch (CC) {
-    case X86::COND_B: {
-      // Test CF == 1
-      int CFIndex = getEflagBitIndex(EFLAGS::CF);
-      Value *CFValue = CTRec->RegValues[CFIndex];
-      assert(CFValue != nullptr &&
-             "Failed to get EFLAGS value while raising JB");
-      // Construct a compare instruction
-      BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, CFValue, TrueValue,
-                                "CmpCF_JB");
-      CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
-    } break;
-    case X86::COND_E: {
-      // Test ZF == 1
-      int ZFIndex = getEflagBitIndex(EFLAGS::ZF);
-      Value *ZFValue = CTRec->RegValues[ZFIndex];
-      assert(ZFValue != nullptr &&
-             "Failed to get EFLAGS value while raising JE");
-      // Construct a compare instruction
-      BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, ZFValue, TrueValue,
-                                "CmpZF_JE");
-      CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
-    } break;
-    case X86::COND_NE: {
-      // Test ZF == 0
-      int ZFIndex = getEflagBitIndex(EFLAGS::ZF);
-      Value *ZFValue = CTRec->RegValues[ZFIndex];
-      assert(ZFValue != nullptr &&
-             "Failed to get EFLAGS value while raising JNE");
-      // Construct a compare instruction
-      BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, ZFValue,
-                                FalseValue, "CmpZF_JNE");
-      CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
-    } break;
-    case X86::COND_S: {
-      // Test SF == 1
-      int SFIndex = getEflagBitIndex(EFLAGS::SF);
-      Value *SFValue = CTRec->RegValues[SFIndex];
-      assert(SFValue != nullptr &&
-             "Failed to get EFLAGS value while raising JS");
-      // Construct a compare instruction
-      BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, SFValue, TrueValue,
-                                "CmpSF_JS");
-      CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
-    } break;
-    case X86::COND_NS: {
-      // Test SF == 0
-      int SFIndex = getEflagBitIndex(EFLAGS::SF);
-      Value *SFValue = CTRec->RegValues[SFIndex];
-      assert(SFValue != nullptr &&
-             "Failed to get EFLAGS value while raising JNS");
-      // Construct a compare instruction
-      BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, SFValue,
-                                FalseValue, "CmpSF_JNS");
-      CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
-    } break;
-    case X86::COND_A: {
-      // CF == 0 and ZF == 0
-      int CFIndex = getEflagBitIndex(EFLAGS::CF);
-      int ZFIndex = getEflagBitIndex(EFLAGS::ZF);
-      Value *CFValue = CTRec->RegValues[CFIndex];
-      Value *ZFValue = CTRec->RegValues[ZFIndex];
-
-      assert((CFValue != nullptr) && (ZFValue != nullptr) &&
-             "Failed to get EFLAGS value while raising JA");
-      // Test CF == 0
-      Instruction *CFCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, CFValue,
-                                         FalseValue, "CFCmp_JA");
-      CandBB->getInstList().push_back(CFCond);
-      // Test ZF == 0
-      Instruction *ZFCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, ZFValue,
-                                         FalseValue, "ZFCmp_JA");
-      CandBB->getInstList().push_back(ZFCond);
-      BranchCond = BinaryOperator::CreateAnd(ZFCond, CFCond, "CFAndZF_JA");
-      CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
-    } break;
-    case X86::COND_AE: {
-      // CF == 0
-      int CFIndex = getEflagBitIndex(EFLAGS::CF);
-      Value *CFValue = CTRec->RegValues[CFIndex];
-      assert(CFValue != nullptr &&
-             "Failed to get EFLAGS value while raising JAE");
-      // Compare CF == 0
-      BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, CFValue,
-                                FalseValue, "CFCmp_JAE");
-      CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
-    } break;
-    case X86::COND_BE: {
-      // CF == 1 or ZF == 1
-      int CFIndex = getEflagBitIndex(EFLAGS::CF);
-      int ZFIndex = getEflagBitIndex(EFLAGS::ZF);
-      Value *CFValue = CTRec->RegValues[CFIndex];
-      Value *ZFValue = CTRec->RegValues[ZFIndex];
-      assert((CFValue != nullptr) && (ZFValue != nullptr) &&
-             "Failed to get EFLAGS value while raising JBE");
-      // Compare CF == 1
-      Instruction *CFCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, CFValue,
-                                         TrueValue, "CFCmp_JBE");
-      CandBB->getInstList().push_back(CFCond);
-      // Compare ZF == 1
-      Instruction *ZFCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, ZFValue,
-                                         TrueValue, "ZFCmp_JBE");
-      CandBB->getInstList().push_back(ZFCond);
-      BranchCond = BinaryOperator::CreateOr(ZFCond, CFCond, "CFAndZF_JBE");
-      CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
-    } break;
-    case X86::COND_G: {
-      // ZF == 0 and (SF == OF)
-      int ZFIndex = getEflagBitIndex(EFLAGS::ZF);
-      int SFIndex = getEflagBitIndex(EFLAGS::SF);
-      int OFIndex = getEflagBitIndex(EFLAGS::OF);
-      Value *ZFValue = CTRec->RegValues[ZFIndex];
-      Value *SFValue = CTRec->RegValues[SFIndex];
-      Value *OFValue = CTRec->RegValues[OFIndex];
-      Instruction *ZFCond = nullptr;
-      Instruction *SFOFCond = nullptr;
-      assert(((ZFValue != nullptr) && (SFValue != nullptr) &&
-              (OFValue != nullptr)) &&
-             "Failed to get EFLAGS value while raising JG");
-      // Compare ZF and 0
-      ZFCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, ZFValue, FalseValue,
-                            "ZFCmp_JG");
-      CandBB->getInstList().push_back(ZFCond);
-      // Test SF == OF
-      SFOFCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, SFValue, OFValue,
-                              "SFOFCmp_JG");
-      CandBB->getInstList().push_back(SFOFCond);
-      BranchCond = BinaryOperator::CreateAnd(ZFCond, SFOFCond, "ZFAndSFOF_JG");
-      CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
-    } break;
-    case X86::COND_GE: {
-      // SF == OF
-      int SFIndex = getEflagBitIndex(EFLAGS::SF);
-      int OFIndex = getEflagBitIndex(EFLAGS::OF);
-      Value *SFValue = CTRec->RegValues[SFIndex];
-      Value *OFValue = CTRec->RegValues[OFIndex];
-      assert(SFValue != nullptr && OFValue != nullptr &&
-             "Failed to get EFLAGS value while raising JGE");
-      // Compare SF and OF
-      BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, SFValue, OFValue,
-                                "CmpSFOF_JGE");
-      CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
-    } break;
-    case X86::COND_L: {
-      // SF != OF
-      int SFIndex = getEflagBitIndex(EFLAGS::SF);
-      int OFIndex = getEflagBitIndex(EFLAGS::OF);
-      Value *SFValue = CTRec->RegValues[SFIndex];
-      Value *OFValue = CTRec->RegValues[OFIndex];
-      assert(((SFValue != nullptr) && (OFValue != nullptr)) &&
-             "Failed to get EFLAGS value while raising JL");
-      // Test SF != OF
-      BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_NE, SFValue, OFValue,
-                                "SFAndOF_JL");
-      CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
-    } break;
-    case X86::COND_LE: {
-      // ZF == 1 or (SF != OF)
-      int ZFIndex = getEflagBitIndex(EFLAGS::ZF);
-      int SFIndex = getEflagBitIndex(EFLAGS::SF);
-      int OFIndex = getEflagBitIndex(EFLAGS::OF);
-      Value *ZFValue = CTRec->RegValues[ZFIndex];
-      Value *SFValue = CTRec->RegValues[SFIndex];
-      Value *OFValue = CTRec->RegValues[OFIndex];
-      Instruction *ZFCond = nullptr;
-      Instruction *SFOFCond = nullptr;
-      assert(((ZFValue != nullptr) && (SFValue != nullptr) &&
-              (OFValue != nullptr)) &&
-             "Failed to get EFLAGS value while raising JLE");
-      // Compare ZF and 1
-      ZFCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, ZFValue, TrueValue,
-                            "CmpZF_JLE");
-      CandBB->getInstList().push_back(ZFCond);
-      // Test SF != OF
-      SFOFCond = new ICmpInst(CmpInst::Predicate::ICMP_NE, SFValue, OFValue,
-                              "CmpOF_JLE");
-      CandBB->getInstList().push_back(SFOFCond);
-      BranchCond = BinaryOperator::CreateOr(ZFCond, SFOFCond, "ZFOrSF_JLE");
-      CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
-    } break;
-    // Parity flag is set by instructions that abstract unordered
-    // result of SSE compare instructions.
-    // NOTE: Setting of PF is not modeled while abstracting non-SSE2
-    // instructions
-    case X86::COND_P: {
-      // Test PF == 1
-      int PFIndex = getEflagBitIndex(EFLAGS::PF);
-      Value *PFValue = CTRec->RegValues[PFIndex];
-      assert(PFValue != nullptr &&
-             "Failed to get EFLAGS value while raising JP");
-      // Construct a compare instruction
-      BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, PFValue, TrueValue,
-                                "CmpPF_JP");
-      CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
-    } break;
-    case X86::COND_NP: {
-      // Test PF == 0
-      int PFIndex = getEflagBitIndex(EFLAGS::PF);
-      Value *PFValue = CTRec->RegValues[PFIndex];
-      assert(PFValue != nullptr &&
-             "Failed to get EFLAGS value while raising JNP");
-      // Construct a compare instruction
-      BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, PFValue,
-                                FalseValue, "CmpPF_JNP");
-      CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
-    } break;
-    case X86::COND_INVALID:
-      assert(false && "Invalid condition on branch");
-      break;
-    default:
-      LLVM_DEBUG(MI->dump());
-      assert(false && "Unhandled conditional branch");
-    }
+    // If the tested EFLAGS bits were set by a compare, subtract or test
+    // instruction of the block, the condition is a single compare of its
+    // operands. Else it is computed from the values of the bits.
+    BranchCond = raisedValues->foldCondition(CC, MI->getParent()->getNumber(),
+                                             CandBB);
+    if (BranchCond == nullptr)
+      BranchCond = getBranchCondFromFlags(CC, CTRec, CandBB);
 
     // Create branch instruction
     BranchInst *CondBr = BranchInst::Create(TgtBB, FTBB, BranchCond);
@@ -5057,11 +4834,241 @@ bool X86MachineInstructionRaiser::raiseDirectBranchMachineInstr(
   } else {
     assert(false && "Unhandled type of branch instruction");
   }
-  printf("Unhandled VSA: \n"); fflush(stdout);
+  valueSetAnalysis->traceUnhandled(*MI);
   
   return true;
 }
 
+// Return the value of condition CC of the conditional branch of CTRec
+// computed from the values of the EFLAGS bits it tests, upon inserting it at
+// the end of CandBB.
+Value *X86MachineInstructionRaiser::getBranchCondFromFlags(
+    X86::CondCode CC, ControlTransferInfo *CTRec, BasicBlock *CandBB) {
+  LLVMContext &Ctx(MF.getFunction().getContext());
+  // Branch condition value
+  Value *BranchCond = nullptr;
+  // Predicate operation to be performed
+  Value *TrueValue = ConstantInt::getTrue(Ctx);
+  Value *FalseValue = ConstantInt::getFalse(Ctx);
+
+  switch (CC) {
+  case X86::COND_B: {
+    // Test CF == 1
+    int CFIndex = getEflagBitIndex(EFLAGS::CF);
+    Value *CFValue = CTRec->RegValues[CFIndex];
+    assert(CFValue != nullptr &&
+           "Failed to get EFLAGS value while raising JB");
+    // Construct a compare instruction
+    BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, CFValue,
+                              TrueValue, "CmpCF_JB");
+    CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
+  } break;
+  case X86::COND_E: {
+    // Test ZF == 1
+    int ZFIndex = getEflagBitIndex(EFLAGS::ZF);
+    Value *ZFValue = CTRec->RegValues[ZFIndex];
+    assert(ZFValue != nullptr &&
+           "Failed to get EFLAGS value while raising JE");
+    // Construct a compare instruction
+    BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, ZFValue,
+                              TrueValue, "CmpZF_JE");
+    CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
+  } break;
+  case X86::COND_NE: {
+    // Test ZF == 0
+    int ZFIndex = getEflagBitIndex(EFLAGS::ZF);
+    Value *ZFValue = CTRec->RegValues[ZFIndex];
+    assert(ZFValue != nullptr &&
+           "Failed to get EFLAGS value while raising JNE");
+    // Construct a compare instruction
+    BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, ZFValue,
+                              FalseValue, "CmpZF_JNE");
+    CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
+  } break;
+  case X86::COND_S: {
+    // Test SF == 1
+    int SFIndex = getEflagBitIndex(EFLAGS::SF);
+    Value *SFValue = CTRec->RegValues[SFIndex];
+    assert(SFValue != nullptr &&
+           "Failed to get EFLAGS value while raising JS");
+    // Construct a compare instruction
+    BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, SFValue,
+                              TrueValue, "CmpSF_JS");
+    CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
+  } break;
+  case X86::COND_NS: {
+    // Test SF == 0
+    int SFIndex = getEflagBitIndex(EFLAGS::SF);
+    Value *SFValue = CTRec->RegValues[SFIndex];
+    assert(SFValue != nullptr &&
+           "Failed to get EFLAGS value while raising JNS");
+    // Construct a compare instruction
+    BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, SFValue,
+                              FalseValue, "CmpSF_JNS");
+    CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
+  } break;
+  case X86::COND_A: {
+    // CF == 0 and ZF == 0
+    int CFIndex = getEflagBitIndex(EFLAGS::CF);
+    int ZFIndex = getEflagBitIndex(EFLAGS::ZF);
+    Value *CFValue = CTRec->RegValues[CFIndex];
+    Value *ZFValue = CTRec->RegValues[ZFIndex];
+
+    assert((CFValue != nullptr) && (ZFValue != nullptr) &&
+           "Failed to get EFLAGS value while raising JA");
+    // Test CF == 0
+    Instruction *CFCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, CFValue,
+                                       FalseValue, "CFCmp_JA");
+    CandBB->getInstList().push_back(CFCond);
+    // Test ZF == 0
+    Instruction *ZFCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, ZFValue,
+                                       FalseValue, "ZFCmp_JA");
+    CandBB->getInstList().push_back(ZFCond);
+    BranchCond = BinaryOperator::CreateAnd(ZFCond, CFCond, "CFAndZF_JA");
+    CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
+  } break;
+  case X86::COND_AE: {
+    // CF == 0
+    int CFIndex = getEflagBitIndex(EFLAGS::CF);
+    Value *CFValue = CTRec->RegValues[CFIndex];
+    assert(CFValue != nullptr &&
+           "Failed to get EFLAGS value while raising JAE");
+    // Compare CF == 0
+    BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, CFValue,
+                              FalseValue, "CFCmp_JAE");
+    CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
+  } break;
+  case X86::COND_BE: {
+    // CF == 1 or ZF == 1
+    int CFIndex = getEflagBitIndex(EFLAGS::CF);
+    int ZFIndex = getEflagBitIndex(EFLAGS::ZF);
+    Value *CFValue = CTRec->RegValues[CFIndex];
+    Value *ZFValue = CTRec->RegValues[ZFIndex];
+    assert((CFValue != nullptr) && (ZFValue != nullptr) &&
+           "Failed to get EFLAGS value while raising JBE");
+    // Compare CF == 1
+    Instruction *CFCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, CFValue,
+                                       TrueValue, "CFCmp_JBE");
+    CandBB->getInstList().push_back(CFCond);
+    // Compare ZF == 1
+    Instruction *ZFCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, ZFValue,
+                                       TrueValue, "ZFCmp_JBE");
+    CandBB->getInstList().push_back(ZFCond);
+    BranchCond = BinaryOperator::CreateOr(ZFCond, CFCond, "CFAndZF_JBE");
+    CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
+  } break;
+  case X86::COND_G: {
+    // ZF == 0 and (SF == OF)
+    int ZFIndex = getEflagBitIndex(EFLAGS::ZF);
+    int SFIndex = getEflagBitIndex(EFLAGS::SF);
+    int OFIndex = getEflagBitIndex(EFLAGS::OF);
+    Value *ZFValue = CTRec->RegValues[ZFIndex];
+    Value *SFValue = CTRec->RegValues[SFIndex];
+    Value *OFValue = CTRec->RegValues[OFIndex];
+    Instruction *ZFCond = nullptr;
+    Instruction *SFOFCond = nullptr;
+    assert(((ZFValue != nullptr) && (SFValue != nullptr) &&
+            (OFValue != nullptr)) &&
+           "Failed to get EFLAGS value while raising JG");
+    // Compare ZF and 0
+    ZFCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, ZFValue, FalseValue,
+                          "ZFCmp_JG");
+    CandBB->getInstList().push_back(ZFCond);
+    // Test SF == OF
+    SFOFCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, SFValue, OFValue,
+                            "SFOFCmp_JG");
+    CandBB->getInstList().push_back(SFOFCond);
+    BranchCond =
+        BinaryOperator::CreateAnd(ZFCond, SFOFCond, "ZFAndSFOF_JG");
+    CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
+  } break;
+  case X86::COND_GE: {
+    // SF == OF
+    int SFIndex = getEflagBitIndex(EFLAGS::SF);
+    int OFIndex = getEflagBitIndex(EFLAGS::OF);
+    Value *SFValue = CTRec->RegValues[SFIndex];
+    Value *OFValue = CTRec->RegValues[OFIndex];
+    assert(SFValue != nullptr && OFValue != nullptr &&
+           "Failed to get EFLAGS value while raising JGE");
+    // Compare SF and OF
+    BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, SFValue, OFValue,
+                              "CmpSFOF_JGE");
+    CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
+  } break;
+  case X86::COND_L: {
+    // SF != OF
+    int SFIndex = getEflagBitIndex(EFLAGS::SF);
+    int OFIndex = getEflagBitIndex(EFLAGS::OF);
+    Value *SFValue = CTRec->RegValues[SFIndex];
+    Value *OFValue = CTRec->RegValues[OFIndex];
+    assert(((SFValue != nullptr) && (OFValue != nullptr)) &&
+           "Failed to get EFLAGS value while raising JL");
+    // Test SF != OF
+    BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_NE, SFValue, OFValue,
+                              "SFAndOF_JL");
+    CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
+  } break;
+  case X86::COND_LE: {
+    // ZF == 1 or (SF != OF)
+    int ZFIndex = getEflagBitIndex(EFLAGS::ZF);
+    int SFIndex = getEflagBitIndex(EFLAGS::SF);
+    int OFIndex = getEflagBitIndex(EFLAGS::OF);
+    Value *ZFValue = CTRec->RegValues[ZFIndex];
+    Value *SFValue = CTRec->RegValues[SFIndex];
+    Value *OFValue = CTRec->RegValues[OFIndex];
+    Instruction *ZFCond = nullptr;
+    Instruction *SFOFCond = nullptr;
+    assert(((ZFValue != nullptr) && (SFValue != nullptr) &&
+            (OFValue != nullptr)) &&
+           "Failed to get EFLAGS value while raising JLE");
+    // Compare ZF and 1
+    ZFCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, ZFValue, TrueValue,
+                          "CmpZF_JLE");
+    CandBB->getInstList().push_back(ZFCond);
+    // Test SF != OF
+    SFOFCond = new ICmpInst(CmpInst::Predicate::ICMP_NE, SFValue, OFValue,
+                            "CmpOF_JLE");
+    CandBB->getInstList().push_back(SFOFCond);
+    BranchCond = BinaryOperator::CreateOr(ZFCond, SFOFCond, "ZFOrSF_JLE");
+    CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
+  } break;
+  // Parity flag is set by instructions that abstract unordered
+  // result of SSE compare instructions.
+  // NOTE: Setting of PF is not modeled while abstracting non-SSE2
+  // instructions
+  case X86::COND_P: {
+    // Test PF == 1
+    int PFIndex = getEflagBitIndex(EFLAGS::PF);
+    Value *PFValue = CTRec->RegValues[PFIndex];
+    assert(PFValue != nullptr &&
+           "Failed to get EFLAGS value while raising JP");
+    // Construct a compare instruction
+    BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, PFValue,
+                              TrueValue, "CmpPF_JP");
+    CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
+  } break;
+  case X86::COND_NP: {
+    // Test PF == 0
+    int PFIndex = getEflagBitIndex(EFLAGS::PF);
+    Value *PFValue = CTRec->RegValues[PFIndex];
+    assert(PFValue != nullptr &&
+           "Failed to get EFLAGS value while raising JNP");
+    // Construct a compare instruction
+    BranchCond = new ICmpInst(CmpInst::Predicate::ICMP_EQ, PFValue,
+                              FalseValue, "CmpPF_JNP");
+    CandBB->getInstList().push_back(dyn_cast<Instruction>(BranchCond));
+  } break;
+  case X86::COND_INVALID:
+    assert(false && "Invalid condition on branch");
+    break;
+  default:
+    LLVM_DEBUG(CTRec->CandidateMachineInstr->dump());
+    assert(false && "Unhandled conditional branch");
+  }
+
+  return BranchCond;
+}
+
 // Raise a generic instruction. This is the catch all MachineInstr raiser
 bool X86MachineInstructionRaiser::raiseGenericMachineInstr(
     const MachineInstr &MI) {
@@ -5212,7 +5219,7 @@ bool X86MachineInstructionRaiser::raiseReturnMachineInstr(
           RaisedFunction, Type::getVoidTy(MF.getFunction().getContext()));
     }
   }
-  printf("Unhandled VSA: \n"); fflush(stdout);
+  valueSetAnalysis->traceUnhandled(MI);
 
   return true;
 }
@@ -5290,7 +5297,6 @@ bool X86MachineInstructionRaiser::raiseBranchMachineInstrs() {
   }
   LLVM_DEBUG(dbgs() << "CFG : After Raising Terminator Instructions\n");
   LLVM_DEBUG(RaisedFunction->dump());
-  printf("Unhandled VSA: \n"); fflush(stdout);
 
   return true;
 }
@@ -5351,7 +5357,7 @@ bool X86MachineInstructionRaiser::raiseFPURegisterOpInstr(
     assert(false && "Unhandled FPU instruction");
   } break;
   }
-  printf("Unhandled VSA: \n"); fflush(stdout);
+  valueSetAnalysis->traceUnhandled(MI);
 
   return true;
 }
@@ -5795,7 +5801,7 @@ bool X86MachineInstructionRaiser::raiseCallMachineInstr(
     assert(false && "Unhandled call instruction");
   } break;
   }
-  printf("Unhandled VSA: \n"); fflush(stdout);
+  valueSetAnalysis->traceUnhandled(MI);
 
   return Success;
 }
@@ -5829,8 +5835,15 @@ bool X86MachineInstructionRaiser::raiseMachineFunction() {
 
   // Initialize the value set analysis class.
   valueSetAnalysis = new X86ValueSetAnalysis(this);
+  // Compute the value sets at the entry of each basic block.
+  valueSetAnalysis->solve();
+  // Stop if the analysis alone exhausted the time budget.
+  if (!Budget.isWithinBudget(0))
+    return false;
   MDB = new MDBuilder(Ctx);
   Domain = MDB->createAnonymousAliasScopeDomain(CurFunction->getName());
+  StackScope = MDB->createAnonymousAliasScope(Domain, "stack");
+  GlobalScope = MDB->createAnonymousAliasScope(Domain, "global");
 
   Value *Zero64BitValue =
       ConstantInt::get(Type::getInt64Ty(Ctx), 0, false /* isSigned */);
@@ -5856,6 +5869,9 @@ bool X86MachineInstructionRaiser::raiseMachineFunction() {
   // of MachineFunction, except branch instructions.
   LoopTraversal Traversal;
   LoopTraversal::TraversalOrder TraversedMBBOrder = Traversal.traverse(MF);
+  // Number of IR instructions raised so far, checked against the budget after
+  // each block is raised.
+  uint64_t NumIRInstrs = 0;
   for (LoopTraversal::TraversedMBBInfo TraversedMBB : TraversedMBBOrder) {
     // Only perform the primary pass as we do not want to translate one
     // block more than once.
@@ -5875,6 +5891,8 @@ bool X86MachineInstructionRaiser::raiseMachineFunction() {
     // This information is used to raise branch instructions, if any, of the
     // MBB in a later walk of MachineBasicBlocks of MF.
     mbbToBBMap.insert(std::make_pair(MBBNo, CurIBB));
+    // Start from the value sets computed for the entry of MBB
+    valueSetAnalysis->enterBlock(MBB);
     // Walk MachineInsts of the MachineBasicBlock
     for (MachineInstr &MI : MBB.instrs()) {
       // Ignore padding instructions. ld uses nop and lld uses int3 for
@@ -5896,17 +5914,45 @@ bool X86MachineInstructionRaiser::raiseMachineFunction() {
         if (!raiseCallMachineInstr(MI)) {
           return false;
         }
-      } else if (!raiseMachineInstr(MI)) {
-        return false;
+      } else {
+        // Get the memory region accessed by MI, if known, and the last
+        // instruction of CurIBB, to find the memory accesses raised from MI.
+        MemRgnType MemRgn;
+        bool HasMemRgn = valueSetAnalysis->getMemAccessRegion(MI, MemRgn);
+        bool WasEmpty = CurIBB->empty();
+        WeakVH LastInst = WasEmpty ? nullptr : &CurIBB->back();
+        if (!raiseMachineInstr(MI)) {
+          return false;
+        }
+        if (HasMemRgn && (WasEmpty || (LastInst != nullptr))) {
+          bool IsStackAccess = (MemRgn == StackRegion);
+          auto InstIter = WasEmpty ? CurIBB->begin()
+                                   : std::next(cast<Instruction>(LastInst)
+                                                   ->getIterator());
+          for (Instruction &I : make_range(InstIter, CurIBB->end())) {
+            Value *Ptr = getLoadStorePointerOperand(&I);
+            if (Ptr == nullptr)
+              continue;
+            // Skip accesses known to be outside the region, such as those of
+            // stack slots of promoted registers or of read-only data.
+            const Value *Obj = getUnderlyingObject(Ptr);
+            if (IsStackAccess ? isa<GlobalValue>(Obj) : isa<AllocaInst>(Obj))
+              continue;
+            setMemAccessScope(&I, IsStackAccess);
+          }
+        }
       }
-      fprintf(stderr, "VSA at instruction: \n");
-      MI.dump();
-      valueSetAnalysis->dump();
-      fprintf(stderr, "-------------------------\n");
+      valueSetAnalysis->traceInstruction(MI);
+      valueSetAnalysis->stepInstruction(MI);
     }
+    raisedValues->setBlockRaised(MBBNo);
+    NumIRInstrs += CurIBB->size();
+    if (!Budget.isWithinBudget(NumIRInstrs))
+      return false;
   }
   return createFunctionStackFrame() && raiseBranchMachineInstrs() &&
-         handleUnpromotedReachingDefs() && handleUnterminatedBlocks();
+         raisedValues->completePHINodes() && handleUnpromotedReachingDefs() &&
+         handleUnterminatedBlocks() && recoverStackSlots();
 }
 
 bool X86MachineInstructionRaiser::raise() {
@@ -5926,7 +5972,7 @@ bool X86MachineInstructionRaiser::raise() {
     PM.add(createUnifyFunctionExitNodesPass());
     PM.run(*(RaisedFunction->getParent()));
 
-    valueSetAnalysis->dump();
+    LLVM_DEBUG(valueSetAnalysis->dump());
   }
   return Success;
 }
@@ -77,6 +77,9 @@ public:
   int getArgumentNumber(unsigned PReg) override;
   auto getRegisterInfo() const { return x86RegisterInfo; }
   bool instrNameStartsWith(const MachineInstr &MI, StringRef Name) const;
+  // Return the condition code of conditional branch MI, or COND_INVALID if MI
+  // is not a conditional branch.
+  X86::CondCode getBranchCondCode(const MachineInstr &MI) const;
   X86RaisedValueTracker *getRaisedValues() { return raisedValues; }
 
 private:
@@ -86,6 +89,10 @@ private:
 
   MDBuilder *MDB;
   MDNode *Domain;
+  // Alias scopes of memory accesses known to be in the stack region and the
+  // global region, i.e., at absolute addresses, by value set analysis.
+  MDNode *StackScope;
+  MDNode *GlobalScope;
 
   // Set of reaching definitions that were not promoted during since defining
   // block is not yet raised and need to be promoted upon raising all blocks.
@@ -109,6 +116,12 @@ private:
   // offset of objects allocated on the stack.
   std::map<int64_t, int> ShadowStackIndexedByOffset;
 
+  // Single stack frame created by createFunctionStackFrame, if any, and the
+  // size and name of each stack object it consolidates, indexed by the offset
+  // of the object in the frame.
+  AllocaInst *FunctionStackFrame = nullptr;
+  std::map<int64_t, std::pair<uint64_t, std::string>> StackFrameSlots;
+
   // Commonly used LLVM data structures during this phase
   MachineRegisterInfo &machineRegInfo;
   const X86Subtarget &x86TargetInfo;
@@ -121,6 +134,9 @@ private:
 
   bool raiseMachineFunction();
   FunctionType *getRaisedFunctionPrototype() override;
+  void
+  collectCallees(SmallPtrSetImpl<MachineFunctionRaiser *> &Callees) override;
+  bool discardRaisedFunctionPrototype() override;
   // This raises MachineInstr to MachineInstruction
   bool raiseMachineInstr(MachineInstr &);
 
@@ -165,6 +181,8 @@ private:
 
   bool raiseBranchMachineInstrs();
   bool raiseDirectBranchMachineInstr(ControlTransferInfo *);
+  Value *getBranchCondFromFlags(X86::CondCode CC, ControlTransferInfo *CTRec,
+                                BasicBlock *CandBB);
   bool raiseIndirectBranchMachineInstr(ControlTransferInfo *);
 
   Value *getMemoryRefValue(const MachineInstr &);
@@ -179,6 +197,9 @@ private:
   bool unlinkEmptyMBBs();
   // Adjust sizes of stack allocated objects
   bool createFunctionStackFrame();
+  // Split the stack frame into allocas of the stack slots accessed
+  // independently of each other
+  bool recoverStackSlots();
 
   // Method to record information that is used in a second pass
   // to raise control transfer instructions in a second pass.
@@ -212,6 +233,7 @@ private:
   Type *getReturnTypeFromMBB(const MachineBasicBlock &MBB, bool &HasCall);
   Function *getTargetFunctionAtPLTOffset(const MachineInstr &, uint64_t);
   Value *getStackAllocatedValue(const MachineInstr &, X86AddressMode &, bool);
+  void setMemAccessScope(Instruction *MemAccess, bool IsStackAccess);
   Value *getRegOperandValue(const MachineInstr &MI, unsigned OperandIndex);
 
   bool handleUnpromotedReachingDefs();
@@ -234,6 +256,9 @@ private:
   bool isEffectiveAddrValue(Value *Val);
 
   std::vector<JumpTableInfo> JTList;
+  // Flag to indicate that jump tables of MF are raised. Jump tables are
+  // raised once even if the function prototype is constructed again.
+  bool JumpTablesRaised;
 };
 
 } // end namespace mctoll
@@ -17,10 +17,12 @@
 #include "X86RaisedValueTracker.h"
 #include "X86RegisterUtils.h"
 #include "llvm-mctoll.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/CodeGen/MachineDominators.h"
 #include "llvm/Object/ELF.h"
 #include "llvm/Object/ELFObjectFile.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Local.h"
 #include <X86InstrBuilder.h>
 #include <X86Subtarget.h>
 #include <iterator>
@@ -30,6 +32,11 @@
 using namespace llvm::mctoll;
 using namespace llvm::mctoll::X86RegisterUtils;
 
+STATISTIC(NumStackPromotions,
+          "Number of register definitions promoted to stack slots");
+STATISTIC(NumStackSlotsRecovered,
+          "Number of stack slots split from function stack frames");
+
 Value *X86MachineInstructionRaiser::getMemoryRefValue(const MachineInstr &MI) {
   const MCInstrDesc &MIDesc = MI.getDesc();
   unsigned int Opcode = MI.getOpcode();
@@ -163,9 +170,8 @@ Value *X86MachineInstructionRaiser::getMemoryRefValue(const MachineInstr &MI) {
   } else {
     // TODO : Memory references with BaseType FrameIndexBase
     // (i.e., not RegBase type)
-    outs() << "****** Unhandled memory reference in instruction\n\t";
+    errs() << "****** Unhandled memory reference of type FrameIndexBase\n";
     LLVM_DEBUG(MI.dump());
-    outs() << "****** reference of type FrameIndexBase";
   }
 
   assert(MemoryRefValue != nullptr &&
@@ -731,27 +737,23 @@ Value *X86MachineInstructionRaiser::createPCRelativeAccesssValue(
           // symVirtualAddr. In executable and shared object files, st_value
           // holds a virtual address.
           uint64_t SymbVal = 0;
-          for (section_iterator SecIter : Elf64LEObjFile->sections()) {
-            uint64_t SecStart = SecIter->getAddress();
-            uint64_t SecEnd = SecStart + SecIter->getSize();
-            if ((SecStart <= SymVirtualAddr) && (SecEnd >= SymVirtualAddr)) {
-              // Get the initial symbol value only if this is not a bss
-              // section. Else, symVal is already initialized to 0.
-              if (SecIter->isBSS()) {
-                Lnkg = GlobalValue::CommonLinkage;
-              } else {
-                StringRef SecData = unwrapOrError(
-                    SecIter->getContents(), MR->getObjectFile()->getFileName());
-                unsigned Index = SymVirtualAddr - SecStart;
-                const unsigned char *Begin = SecData.bytes_begin() + Index;
-                char Shift = 0;
-                while (SymbSize-- > 0) {
-                  // We know this is little-endian
-                  SymbVal = ((*Begin++) << Shift) | SymbVal;
-                  Shift += 8;
-                }
+          const SectionMap::SectionEntry *Sec =
+              MR->getSectionMap().findSectionContaining(SymVirtualAddr,
+                                                        /* IncludeEnd */ true);
+          if (Sec != nullptr) {
+            // Get the initial symbol value only if this is not a bss
+            // section. Else, symVal is already initialized to 0.
+            if (Sec->IsBSS) {
+              Lnkg = GlobalValue::CommonLinkage;
+            } else {
+              unsigned Index = SymVirtualAddr - Sec->Address;
+              const unsigned char *Begin = Sec->Contents.data() + Index;
+              char Shift = 0;
+              while (SymbSize-- > 0) {
+                // We know this is little-endian
+                SymbVal = ((*Begin++) << Shift) | SymbVal;
+                Shift += 8;
               }
-              break;
             }
           }
 
@@ -838,18 +840,15 @@ Value *X86MachineInstructionRaiser::createPCRelativeAccesssValue(
           // get the initial value of the global data symbol at offset symVal
           // in section with index symValSecIndex
 
-          for (section_iterator SecIter : Elf64LEObjFile->sections()) {
-            if (SecIter->getIndex() == SymValSecIndex) {
-              StringRef SecData = unwrapOrError(
-                  SecIter->getContents(), MR->getObjectFile()->getFileName());
-              const unsigned char *Begin = SecData.bytes_begin() + SymVal;
-              char Shift = 0;
-              while (SymSize-- > 0) {
-                // We know this is little-endian
-                SymInitVal = ((*Begin++) << Shift) | SymInitVal;
-                Shift += 8;
-              }
-              break;
+          const SectionMap::SectionEntry *Sec =
+              MR->getSectionMap().getSectionAtIndex(SymValSecIndex);
+          if (Sec != nullptr) {
+            const unsigned char *Begin = Sec->Contents.data() + SymVal;
+            char Shift = 0;
+            while (SymSize-- > 0) {
+              // We know this is little-endian
+              SymInitVal = ((*Begin++) << Shift) | SymInitVal;
+              Shift += 8;
             }
           }
           // REVISIT : Set symbol alignment to be the same as symbol size
@@ -907,6 +906,7 @@ Value *X86MachineInstructionRaiser::createPCRelativeAccesssValue(
 // stack slot Alloca.
 StoreInst *X86MachineInstructionRaiser::promotePhysregToStackSlot(
     int PhysReg, Value *ReachingValue, int DefiningMBBNo, Instruction *Alloca) {
+  ++NumStackPromotions;
   StoreInst *StInst = nullptr;
   LLVMContext &Ctxt(MF.getFunction().getContext());
 
@@ -1161,6 +1161,9 @@ bool X86MachineInstructionRaiser::createFunctionStackFrame() {
 
     // Copy RODataIndex metadata
     raisedValues->setInstMetadataRODataIndex(TOSAlloca, StackFrameAlloca);
+    FunctionStackFrame = StackFrameAlloca;
+    StackFrameSlots[0] = std::make_pair(
+        MFrameInfo.getObjectSize(StackTopObjIndex), TOSAlloca->getName().str());
 
     // Update TOSAlloca entries to StackFrameAlloca in
     // reachingDefsToPromote. This map is used later while promoting
@@ -1242,6 +1245,10 @@ bool X86MachineInstructionRaiser::createFunctionStackFrame() {
         }
       }
 
+      StackFrameSlots[IRStackOffset] =
+          std::make_pair(MFrameInfo.getObjectSize(StackIndex),
+                         StackObjAlloca->getName().str());
+
       // Finally, replace StackObjAlloca with CastStackObjAlloca
       ReplaceInstWithInst(StackObjAlloca, CastStackObjAlloca);
       // Go to next entry
@@ -1251,6 +1258,244 @@ bool X86MachineInstructionRaiser::createFunctionStackFrame() {
   return true;
 }
 
+// Split the single stack frame created by createFunctionStackFrame into
+// allocas of the stack slots that are accessed independently of each other.
+// The frame is needed to preserve the layout of aggregate data whose address is
+// taken; keeping all stack slots in it prevents SROA and alias analysis from
+// reasoning about the slots when the raised LLVM IR is compiled. All loads and
+// stores at constant offsets from the frame are collected. An address in the
+// frame that is used in any other way escapes and may be used to access any
+// part of the stack object it points into, or any stack slot at a higher
+// offset. Such stack slots are left in the frame. The remaining accesses are
+// grouped into regions of overlapping accesses, each of which is allocated
+// separately - with the type of its accesses, if all access the entire region
+// with the same type. With --stack-layout=verify-slots, an access that
+// straddles two stack slots discovered while raising is reported as an error.
+bool X86MachineInstructionRaiser::recoverStackSlots() {
+  if ((FunctionStackFrame == nullptr) ||
+      (StackLayout == StackLayoutKind::Frame))
+    return true;
+
+  const DataLayout &DL = MR->getModule()->getDataLayout();
+  LLVMContext &Context(MF.getFunction().getContext());
+  auto *FrameSizeVal =
+      dyn_cast<ConstantInt>(FunctionStackFrame->getArraySize());
+  assert(FrameSizeVal != nullptr && "Unexpected stack frame size");
+  int64_t StackFrameSize = FrameSizeVal->getSExtValue();
+
+  struct StackSlotAccess {
+    Instruction *Inst;
+    int64_t Offset;
+    uint64_t Size;
+    Type *Ty;
+  };
+  std::vector<StackSlotAccess> Accesses;
+  // Lowest offset of the frame whose address escapes
+  int64_t EscapeOffset = StackFrameSize;
+  // An escaped address may be used to access any part of the stack object it
+  // points into, e.g., by walking a pointer down from the end of an array. So,
+  // the frame escapes from the start of that object. An offset one past the
+  // end of an object is considered to point into it. The frame is not split if
+  // the object is not known.
+  auto escapeAt = [&](int64_t Offset) {
+    int64_t ObjectStart = 0;
+    for (const auto &Slot : StackFrameSlots)
+      if ((Slot.first <= Offset) &&
+          (Offset <= Slot.first + int64_t(Slot.second.first))) {
+        ObjectStart = Slot.first;
+        break;
+      }
+    EscapeOffset = std::min(EscapeOffset, ObjectStart);
+  };
+
+  // Walk the uses of addresses at constant offsets in the frame. Addresses are
+  // pointers or, if cast to integers, integers.
+  SmallVector<std::tuple<Value *, int64_t, bool>, 16> WorkList;
+  WorkList.emplace_back(FunctionStackFrame, 0, true);
+  while (!WorkList.empty()) {
+    Value *Addr;
+    int64_t Offset;
+    bool IsPointer;
+    std::tie(Addr, Offset, IsPointer) = WorkList.pop_back_val();
+    for (User *U : Addr->users()) {
+      Instruction *UseInst = dyn_cast<Instruction>(U);
+      if (UseInst == nullptr) {
+        escapeAt(Offset);
+        continue;
+      }
+      if (IsPointer) {
+        if (auto *Load = dyn_cast<LoadInst>(UseInst)) {
+          Type *Ty = Load->getType();
+          Accesses.push_back({Load, Offset, DL.getTypeStoreSize(Ty), Ty});
+          continue;
+        }
+        if (auto *Store = dyn_cast<StoreInst>(UseInst)) {
+          // A store of the address itself is an escape
+          if (Store->getValueOperand() != Addr) {
+            Type *Ty = Store->getValueOperand()->getType();
+            Accesses.push_back({Store, Offset, DL.getTypeStoreSize(Ty), Ty});
+            continue;
+          }
+        } else if (isa<BitCastInst>(UseInst)) {
+          WorkList.emplace_back(UseInst, Offset, true);
+          continue;
+        } else if (isa<PtrToIntInst>(UseInst)) {
+          WorkList.emplace_back(UseInst, Offset, false);
+          continue;
+        } else if (auto *GEP = dyn_cast<GetElementPtrInst>(UseInst)) {
+          APInt GEPOffset(DL.getIndexTypeSizeInBits(GEP->getType()), 0);
+          if ((GEP->getPointerOperand() == Addr) &&
+              GEP->accumulateConstantOffset(DL, GEPOffset)) {
+            WorkList.emplace_back(GEP, Offset + GEPOffset.getSExtValue(), true);
+            continue;
+          }
+        }
+      } else {
+        if (isa<IntToPtrInst>(UseInst)) {
+          WorkList.emplace_back(UseInst, Offset, true);
+          continue;
+        }
+        if (auto *BinOp = dyn_cast<BinaryOperator>(UseInst)) {
+          Value *Op0 = BinOp->getOperand(0);
+          Value *Op1 = BinOp->getOperand(1);
+          auto Opcode = BinOp->getOpcode();
+          if ((Opcode == Instruction::Add) && (Op1 == Addr))
+            std::swap(Op0, Op1);
+          auto *Disp = dyn_cast<ConstantInt>(Op1);
+          if ((Op0 == Addr) && (Disp != nullptr) &&
+              ((Opcode == Instruction::Add) || (Opcode == Instruction::Sub))) {
+            int64_t DispVal = Disp->getSExtValue();
+            WorkList.emplace_back(BinOp,
+                                  (Opcode == Instruction::Add)
+                                      ? Offset + DispVal
+                                      : Offset - DispVal,
+                                  false);
+            continue;
+          }
+        }
+      }
+      escapeAt(Offset);
+    }
+  }
+
+  for (const StackSlotAccess &Access : Accesses) {
+    int64_t AccessEnd = Access.Offset + Access.Size;
+    // Leave the frame as is if it is accessed out of its bounds.
+    if ((Access.Offset < 0) || (AccessEnd > StackFrameSize))
+      EscapeOffset = 0;
+
+    if (StackLayout != StackLayoutKind::VerifiedSlots)
+      continue;
+    // Find the stack slots the access overlaps.
+    auto SlotIter = StackFrameSlots.upper_bound(Access.Offset);
+    if (SlotIter != StackFrameSlots.begin()) {
+      auto PrevSlotIter = std::prev(SlotIter);
+      if (PrevSlotIter->first + int64_t(PrevSlotIter->second.first) >
+          Access.Offset)
+        SlotIter = PrevSlotIter;
+    }
+    if ((SlotIter == StackFrameSlots.end()) || (SlotIter->first >= AccessEnd))
+      continue;
+    auto NextSlotIter = std::next(SlotIter);
+    if ((NextSlotIter != StackFrameSlots.end()) &&
+        (NextSlotIter->first < AccessEnd))
+      reportError(MR->getObjectFile()->getFileName(),
+                  "access of " + Twine(Access.Size) +
+                      " bytes at stack frame offset " + Twine(Access.Offset) +
+                      " of function " + MF.getName() +
+                      " straddles stack slots " + SlotIter->second.second +
+                      " and " + NextSlotIter->second.second);
+  }
+
+  if (EscapeOffset == 0)
+    return true;
+
+  // Group the accesses into regions of overlapping accesses and allocate each
+  // region below the escaped part of the frame.
+  llvm::sort(Accesses, [](const StackSlotAccess &A, const StackSlotAccess &B) {
+    return A.Offset < B.Offset;
+  });
+  unsigned AllocaAddrSpace = DL.getAllocaAddrSpace();
+  Type *ByteTy = Type::getInt8Ty(Context);
+  SmallVector<WeakTrackingVH, 16> DeadAddrs;
+  std::vector<std::pair<AllocaInst *, std::string>> SlotAllocas;
+  auto RegionBegin = Accesses.begin();
+  while (RegionBegin != Accesses.end()) {
+    int64_t RegionStart = RegionBegin->Offset;
+    int64_t RegionEnd = RegionStart + RegionBegin->Size;
+    Type *RegionTy = RegionBegin->Ty;
+    auto RegionIter = std::next(RegionBegin);
+    for (; (RegionIter != Accesses.end()) && (RegionIter->Offset < RegionEnd);
+         RegionIter++) {
+      RegionEnd =
+          std::max(RegionEnd, RegionIter->Offset + int64_t(RegionIter->Size));
+      if ((RegionIter->Offset != RegionStart) || (RegionIter->Ty != RegionTy))
+        RegionTy = nullptr;
+    }
+    // Regions are sorted by offset. So, all remaining regions are in the
+    // escaped part of the frame.
+    if (RegionEnd > EscapeOffset)
+      break;
+
+    uint64_t RegionSize = RegionEnd - RegionStart;
+    if ((RegionTy == nullptr) || (DL.getTypeStoreSize(RegionTy) != RegionSize))
+      RegionTy = ArrayType::get(ByteTy, RegionSize);
+    auto SlotIter = StackFrameSlots.find(RegionStart);
+    std::string SlotName = (SlotIter != StackFrameSlots.end())
+                               ? SlotIter->second.second
+                               : "stk_" + std::to_string(RegionStart);
+    // The alloca is named once the address computations it replaces, which
+    // may have the same name, are deleted.
+    AllocaInst *SlotAlloca =
+        new AllocaInst(RegionTy, AllocaAddrSpace, nullptr,
+                       DL.getPrefTypeAlign(RegionTy), "", FunctionStackFrame);
+    SlotAllocas.emplace_back(SlotAlloca, SlotName);
+    NumStackSlotsRecovered++;
+
+    // Access the region using the new alloca.
+    for (auto AccessIter = RegionBegin; AccessIter != RegionIter;
+         AccessIter++) {
+      Instruction *AccessInst = AccessIter->Inst;
+      unsigned PtrOpIndex = isa<LoadInst>(AccessInst)
+                                ? LoadInst::getPointerOperandIndex()
+                                : StoreInst::getPointerOperandIndex();
+      Value *OldAddr = AccessInst->getOperand(PtrOpIndex);
+      IRBuilder<> Builder(AccessInst);
+      Value *NewAddr = SlotAlloca;
+      if (AccessIter->Offset != RegionStart)
+        NewAddr = Builder.CreateConstInBoundsGEP1_64(
+            ByteTy, Builder.CreatePointerCast(NewAddr, ByteTy->getPointerTo()),
+            AccessIter->Offset - RegionStart);
+      NewAddr = Builder.CreatePointerCast(NewAddr, OldAddr->getType());
+      AccessInst->setOperand(PtrOpIndex, NewAddr);
+      DeadAddrs.push_back(OldAddr);
+    }
+    RegionBegin = RegionIter;
+  }
+
+  // Delete the address computations that are no longer used, including the
+  // frame if all its accesses are split.
+  for (WeakTrackingVH &Addr : DeadAddrs)
+    if (Addr != nullptr)
+      RecursivelyDeleteTriviallyDeadInstructions(Addr);
+  for (auto &SlotAlloca : SlotAllocas)
+    SlotAlloca.first->setName(SlotAlloca.second);
+  FunctionStackFrame = nullptr;
+  return true;
+}
+
+// Set the alias scope of memory access MemAccess to that of the stack region,
+// if IsStackAccess is true, or of the global region otherwise. Accesses in
+// either region do not alias those in the other.
+void X86MachineInstructionRaiser::setMemAccessScope(Instruction *MemAccess,
+                                                    bool IsStackAccess) {
+  LLVMContext &Ctx(MemAccess->getContext());
+  MDNode *Scope = IsStackAccess ? StackScope : GlobalScope;
+  MDNode *OtherScope = IsStackAccess ? GlobalScope : StackScope;
+  MemAccess->setMetadata(LLVMContext::MD_alias_scope, MDNode::get(Ctx, Scope));
+  MemAccess->setMetadata(LLVMContext::MD_noalias, MDNode::get(Ctx, OtherScope));
+}
+
 Value *X86MachineInstructionRaiser::getStackAllocatedValue(
     const MachineInstr &MI, X86AddressMode &MemRef, bool IsStackPointerAdjust) {
   unsigned int StackFrameIndex;
@@ -1417,144 +1662,135 @@ Function *X86MachineInstructionRaiser::getTargetFunctionAtPLTOffset(
          "Only 64-bit ELF binaries supported at present.");
   unsigned char ExecType = Elf64LEObjFile->getELFFile().getHeader().e_type;
   assert((ExecType == ELF::ET_DYN) || (ExecType == ELF::ET_EXEC));
-  // Find the section that contains the offset. That must be the PLT section
-  for (section_iterator SecIter : Elf64LEObjFile->sections()) {
-    uint64_t SecStart = SecIter->getAddress();
-    uint64_t SecEnd = SecStart + SecIter->getSize();
-    if ((SecStart <= PltEntOff) && (SecEnd > PltEntOff)) {
-      StringRef SecName;
-      if (auto NameOrErr = SecIter->getName())
-        SecName = *NameOrErr;
-      else {
-        consumeError(NameOrErr.takeError());
-        assert(false && "Failed to get section name with PLT offset");
-      }
-      if (!SecName.startswith(".plt"))
-        continue;
-      StringRef SecData = unwrapOrError(SecIter->getContents(),
-                                        MR->getObjectFile()->getFileName());
-      ArrayRef<uint8_t> Bytes(reinterpret_cast<const uint8_t *>(SecData.data()),
-                              SecData.size());
-      // Disassemble the first instruction at the offset
-      MCInst Inst;
-      uint64_t JmpInstSz;
-      uint64_t JmpInstOff = PltEntOff;
-      bool Success = MR->getMCDisassembler()->getInstruction(
-          Inst, JmpInstSz, Bytes.slice(JmpInstOff - SecStart), PltEntOff,
+  // Find the PLT section that contains the offset.
+  const SectionMap::SectionEntry *PLTSec =
+      MR->getSectionMap().findSectionContaining(
+          PltEntOff, /* IncludeEnd */ false,
+          [](const SectionMap::SectionEntry &S) {
+            return S.Kind == SectionMap::SK_PLT;
+          });
+  if (PLTSec != nullptr) {
+    uint64_t SecStart = PLTSec->Address;
+    ArrayRef<uint8_t> Bytes = PLTSec->Contents;
+    // Disassemble the first instruction at the offset
+    MCInst Inst;
+    uint64_t JmpInstSz;
+    uint64_t JmpInstOff = PltEntOff;
+    bool Success = MR->getMCDisassembler()->getInstruction(
+        Inst, JmpInstSz, Bytes.slice(JmpInstOff - SecStart), PltEntOff,
+        nulls());
+    assert(Success && "Failed to disassemble instruction in PLT");
+    unsigned int Opcode = Inst.getOpcode();
+    // If the first instruction of the PLT stub is ENDBR32/ENDBR64 - the
+    // instructions used for Indirect Branch Tracking - get to the next
+    // instruction that is expected to be the jump to target.
+    if ((Opcode == X86::ENDBR32) || (Opcode == X86::ENDBR64)) {
+      JmpInstOff += JmpInstSz;
+      Success = MR->getMCDisassembler()->getInstruction(
+          Inst, JmpInstSz, Bytes.slice(JmpInstOff - SecStart), JmpInstOff,
           nulls());
       assert(Success && "Failed to disassemble instruction in PLT");
-      unsigned int Opcode = Inst.getOpcode();
-      // If the first instruction of the PLT stub is ENDBR32/ENDBR64 - the
-      // instructions used for Indirect Branch Tracking - get to the next
-      // instruction that is expected to be the jump to target.
-      if ((Opcode == X86::ENDBR32) || (Opcode == X86::ENDBR64)) {
-        JmpInstOff += JmpInstSz;
-        Success = MR->getMCDisassembler()->getInstruction(
-            Inst, JmpInstSz, Bytes.slice(JmpInstOff - SecStart), JmpInstOff,
-            nulls());
-        assert(Success && "Failed to disassemble instruction in PLT");
-        Opcode = Inst.getOpcode();
-      }
-      MCInstrDesc MCID = MR->getMCInstrInfo()->get(Opcode);
-      if ((Opcode != X86::JMP64m) || (MCID.getNumOperands() != 5)) {
-        assert(false && "Unexpected non-jump instruction or number of operands "
-                        "of jmp instruction in PLT entry");
-      }
-      MCOperand Oprnd = Inst.getOperand(0);
-      int64_t PCOffset = 0;
+      Opcode = Inst.getOpcode();
+    }
+    MCInstrDesc MCID = MR->getMCInstrInfo()->get(Opcode);
+    if ((Opcode != X86::JMP64m) || (MCID.getNumOperands() != 5)) {
+      assert(false && "Unexpected non-jump instruction or number of operands "
+                      "of jmp instruction in PLT entry");
+    }
+    MCOperand Oprnd = Inst.getOperand(0);
+    int64_t PCOffset = 0;
 
-      // First operand should be PC
-      if (Oprnd.isReg()) {
-        if (Oprnd.getReg() != X86::RIP) {
-          assert(false && "PC-relative jmp instruction expected in PLT entry");
-        }
-      } else {
-        assert(false && "PC operand expected in jmp instruction of PLT entry");
+    // First operand should be PC
+    if (Oprnd.isReg()) {
+      if (Oprnd.getReg() != X86::RIP) {
+        assert(false && "PC-relative jmp instruction expected in PLT entry");
       }
+    } else {
+      assert(false && "PC operand expected in jmp instruction of PLT entry");
+    }
 
-      Oprnd = Inst.getOperand(1);
-      // Second operand should be 1
-      if (Oprnd.isImm()) {
-        if (Oprnd.getImm() != 1) {
-          assert(false && "Unexpected immediate second operand in jmp "
-                          "instruction of PLT entry");
-        }
-      } else {
-        assert(false && "Unexpected non-immediate second operand in jmp "
+    Oprnd = Inst.getOperand(1);
+    // Second operand should be 1
+    if (Oprnd.isImm()) {
+      if (Oprnd.getImm() != 1) {
+        assert(false && "Unexpected immediate second operand in jmp "
                         "instruction of PLT entry");
       }
+    } else {
+      assert(false && "Unexpected non-immediate second operand in jmp "
+                      "instruction of PLT entry");
+    }
 
-      Oprnd = Inst.getOperand(2);
-      // Third operand should be X86::No_Register
-      if (Oprnd.isReg()) {
-        if (Oprnd.getReg() != X86::NoRegister) {
-          assert(false && "Unexpected third operand - non-zero register in jmp "
-                          "instruction of PLT entry");
-        }
-      } else {
-        assert(false && "Unexpected third operand - non-register in jmp "
+    Oprnd = Inst.getOperand(2);
+    // Third operand should be X86::No_Register
+    if (Oprnd.isReg()) {
+      if (Oprnd.getReg() != X86::NoRegister) {
+        assert(false && "Unexpected third operand - non-zero register in jmp "
                         "instruction of PLT entry");
       }
+    } else {
+      assert(false && "Unexpected third operand - non-register in jmp "
+                      "instruction of PLT entry");
+    }
 
-      Oprnd = Inst.getOperand(3);
-      // Fourth operand should be an immediate
-      if (!Oprnd.isImm()) {
-        assert(false && "Unexpected non-immediate fourth operand in jmp "
-                        "instruction of PLT entry");
-      }
-      // Get the pc offset
-      PCOffset = Oprnd.getImm();
-
-      Oprnd = Inst.getOperand(4);
-      // Fifth operand should be X86::No_Register
-      if (Oprnd.isReg()) {
-        if (Oprnd.getReg() != X86::NoRegister) {
-          assert(false && "Unexpected fifth operand - non-zero register in jmp "
-                          "instruction of PLT entry");
-        }
-      } else {
-        assert(false && "Unexpected fifth operand - non-register in jmp "
+    Oprnd = Inst.getOperand(3);
+    // Fourth operand should be an immediate
+    if (!Oprnd.isImm()) {
+      assert(false && "Unexpected non-immediate fourth operand in jmp "
+                      "instruction of PLT entry");
+    }
+    // Get the pc offset
+    PCOffset = Oprnd.getImm();
+
+    Oprnd = Inst.getOperand(4);
+    // Fifth operand should be X86::No_Register
+    if (Oprnd.isReg()) {
+      if (Oprnd.getReg() != X86::NoRegister) {
+        assert(false && "Unexpected fifth operand - non-zero register in jmp "
                         "instruction of PLT entry");
       }
+    } else {
+      assert(false && "Unexpected fifth operand - non-register in jmp "
+                      "instruction of PLT entry");
+    }
 
-      // Get dynamic relocation in .got.plt section corresponding to the PLT
-      // entry. The relocation offset is calculated by adding the following:
-      //    a) offset of jmp instruction + size of the instruction
-      //    (representing pc-related addressing) b) jmp target offset in the
-      //    instruction
-      uint64_t GotPltRelocOffset = JmpInstOff + JmpInstSz + PCOffset;
-      const RelocationRef *GotPltReloc =
-          MR->getDynRelocAtOffset(GotPltRelocOffset);
-      assert(GotPltReloc != nullptr &&
-             "Failed to get dynamic relocation for jmp target of PLT entry");
-
-      assert(((GotPltReloc->getType() == ELF::R_X86_64_JUMP_SLOT) ||
-              (GotPltReloc->getType() == ELF::R_X86_64_GLOB_DAT)) &&
-             "Unexpected relocation type for PLT jmp instruction");
-      symbol_iterator CalledFuncSym = GotPltReloc->getSymbol();
-      assert(CalledFuncSym != Elf64LEObjFile->symbol_end() &&
-             "Failed to find relocation symbol for PLT entry");
-      Expected<StringRef> CalledFuncSymName = CalledFuncSym->getName();
-      assert(CalledFuncSymName &&
-             "Failed to find symbol associated with dynamic "
-             "relocation of PLT jmp target.");
-      Expected<uint64_t> CalledFuncSymAddr = CalledFuncSym->getAddress();
-      assert(CalledFuncSymAddr &&
-             "Failed to get called function address of PLT entry");
-      CalledFunc = MR->getRaisedFunctionAt(CalledFuncSymAddr.get());
-
-      if (CalledFunc == nullptr) {
-        // This is an undefined function symbol. Look through the list of
-        // user provided function prototypes and construct a Function
-        // accordingly.
-        CalledFunc = IncludedFileInfo::CreateFunction(
-            *CalledFuncSymName, *const_cast<ModuleRaiser *>(MR));
-        // Bail out if function prototype is not available
-        if (!CalledFunc)
-          exit(-1);
-      }
-      // Found the section we are looking for
-      break;
+    // Get dynamic relocation in .got.plt section corresponding to the PLT
+    // entry. The relocation offset is calculated by adding the following:
+    //    a) offset of jmp instruction + size of the instruction
+    //    (representing pc-related addressing) b) jmp target offset in the
+    //    instruction
+    uint64_t GotPltRelocOffset = JmpInstOff + JmpInstSz + PCOffset;
+    const RelocationRef *GotPltReloc =
+        MR->getDynRelocAtOffset(GotPltRelocOffset);
+    assert(GotPltReloc != nullptr &&
+           "Failed to get dynamic relocation for jmp target of PLT entry");
+
+    assert(((GotPltReloc->getType() == ELF::R_X86_64_JUMP_SLOT) ||
+            (GotPltReloc->getType() == ELF::R_X86_64_GLOB_DAT)) &&
+           "Unexpected relocation type for PLT jmp instruction");
+    symbol_iterator CalledFuncSym = GotPltReloc->getSymbol();
+    assert(CalledFuncSym != Elf64LEObjFile->symbol_end() &&
+           "Failed to find relocation symbol for PLT entry");
+    Expected<StringRef> CalledFuncSymName = CalledFuncSym->getName();
+    assert(CalledFuncSymName &&
+           "Failed to find symbol associated with dynamic "
+           "relocation of PLT jmp target.");
+    Expected<uint64_t> CalledFuncSymAddr = CalledFuncSym->getAddress();
+    assert(CalledFuncSymAddr &&
+           "Failed to get called function address of PLT entry");
+    CalledFunc = MR->getRaisedFunctionAt(CalledFuncSymAddr.get());
+
+    if (CalledFunc == nullptr) {
+      // This is an undefined function symbol. Look through the list of
+      // user provided function prototypes and construct a Function
+      // accordingly.
+      CalledFunc = IncludedFileInfo::CreateFunction(
+          *CalledFuncSymName, *const_cast<ModuleRaiser *>(MR));
+      // Bail out if function prototype is not available
+      if (!CalledFunc)
+        reportError(MR->getObjectFile()->getFileName(),
+                    "unknown prototype of external function " +
+                        *CalledFuncSymName);
     }
   }
   return CalledFunc;
@@ -1572,66 +1808,55 @@ Value *X86MachineInstructionRaiser::getOrCreateGlobalRODataValueAtOffset(
     return nullptr;
   }
   Value *RODataValue = nullptr;
-  const ELF64LEObjectFile *Elf64LEObjFile =
-      dyn_cast<ELF64LEObjectFile>(MR->getObjectFile());
-  assert(Elf64LEObjFile != nullptr &&
+  assert(isa<ELF64LEObjectFile>(MR->getObjectFile()) &&
          "Only 64-bit ELF binaries supported at present.");
   LLVMContext &Context(MF.getFunction().getContext());
   // Check if this is an address in .rodata
-  for (section_iterator SecIter : Elf64LEObjFile->sections()) {
-    uint64_t SecStart = SecIter->getAddress();
-    uint64_t SecEnd = SecStart + SecIter->getSize();
-    // We know that Offset is a positive value. So, casting it is OK.
-    if ((SecStart <= (uint64_t)Offset) && (SecEnd >= (uint64_t)Offset)) {
-      if (SecIter->isData()) {
-        // Get the associated global value if one exists
-        uint64_t SecIndex = SecIter->getIndex();
-        std::string RODataSecValueName;
-        if (auto NameOrErr = SecIter->getName())
-          // Drop the leading '.' from section name
-          RODataSecValueName.append((*NameOrErr).substr(1).data());
-        else {
-          consumeError(NameOrErr.takeError());
-          RODataSecValueName.append("AnonDataSec");
-        }
-
-        RODataSecValueName.append("_").append(std::to_string(SecIndex));
-        GlobalVariable *RODataSecValue = MR->getModule()->getGlobalVariable(
-            RODataSecValueName, true /* AllowInternal */);
-        // If ROData Value representing the contents of this section was not
-        // materialized yet, create one.
-        if (RODataSecValue == nullptr) {
-          // Create the global variable corresponding to the content of
-          // .rodata
-          StringRef SecData = unwrapOrError(SecIter->getContents(),
-                                            MR->getObjectFile()->getFileName());
-          unsigned DataSize = SecIter->getSize();
-          auto DataStr = makeArrayRef(SecData.bytes_begin(), DataSize);
-          Constant *StrConstant = ConstantDataArray::get(Context, DataStr);
-          auto *GlobalStrConstVal = new GlobalVariable(
-              *(MR->getModule()), StrConstant->getType(), true /* isConstant */,
-              GlobalValue::PrivateLinkage, StrConstant, RODataSecValueName);
-          GlobalStrConstVal->setAlignment(MaybeAlign(SecIter->getAlignment()));
-          // Address is not significant
-          GlobalStrConstVal->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
-          // Add metadata that indicates the section start
-          getRaisedValues()->setGVMetadataRODataInfo(GlobalStrConstVal,
-                                                     SecStart);
-          RODataSecValue = GlobalStrConstVal;
-        }
-        unsigned DataOffset = (Offset - SecStart);
-        // Construct index array for a GEP instruction that accesses
-        // byte array
-        Value *Zero32Value = ConstantInt::get(Type::getInt32Ty(Context), 0);
-        Value *DataOffsetIndex =
-            ConstantInt::get(Type::getInt32Ty(Context), DataOffset);
-        Constant *GetElem = ConstantExpr::getInBoundsGetElementPtr(
-            getPointerElementType(RODataSecValue), RODataSecValue,
-            {Zero32Value, DataOffsetIndex});
-        RODataValue = GetElem;
-      }
-      break;
+  // We know that Offset is a positive value. So, casting it is OK.
+  const SectionMap::SectionEntry *Sec =
+      MR->getSectionMap().findSectionContaining((uint64_t)Offset,
+                                                /* IncludeEnd */ true);
+  if ((Sec != nullptr) && Sec->IsData) {
+    uint64_t SecStart = Sec->Address;
+    // Get the associated global value if one exists
+    std::string RODataSecValueName;
+    if (!Sec->Name.empty())
+      // Drop the leading '.' from section name
+      RODataSecValueName.append(Sec->Name.substr(1).data());
+    else
+      RODataSecValueName.append("AnonDataSec");
+
+    RODataSecValueName.append("_").append(std::to_string(Sec->Index));
+    GlobalVariable *RODataSecValue = MR->getModule()->getGlobalVariable(
+        RODataSecValueName, true /* AllowInternal */);
+    // If ROData Value representing the contents of this section was not
+    // materialized yet, create one.
+    if (RODataSecValue == nullptr) {
+      // Create the global variable corresponding to the content of
+      // .rodata
+      unsigned DataSize = Sec->Size;
+      auto DataStr = makeArrayRef(Sec->Contents.data(), DataSize);
+      Constant *StrConstant = ConstantDataArray::get(Context, DataStr);
+      auto *GlobalStrConstVal = new GlobalVariable(
+          *(MR->getModule()), StrConstant->getType(), true /* isConstant */,
+          GlobalValue::PrivateLinkage, StrConstant, RODataSecValueName);
+      GlobalStrConstVal->setAlignment(MaybeAlign(Sec->Alignment));
+      // Address is not significant
+      GlobalStrConstVal->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+      // Add metadata that indicates the section start
+      getRaisedValues()->setGVMetadataRODataInfo(GlobalStrConstVal, SecStart);
+      RODataSecValue = GlobalStrConstVal;
     }
+    unsigned DataOffset = (Offset - SecStart);
+    // Construct index array for a GEP instruction that accesses
+    // byte array
+    Value *Zero32Value = ConstantInt::get(Type::getInt32Ty(Context), 0);
+    Value *DataOffsetIndex =
+        ConstantInt::get(Type::getInt32Ty(Context), DataOffset);
+    Constant *GetElem = ConstantExpr::getInBoundsGetElementPtr(
+        getPointerElementType(RODataSecValue), RODataSecValue,
+        {Zero32Value, DataOffsetIndex});
+    RODataValue = GetElem;
   }
   return RODataValue;
 }
@@ -1660,36 +1885,14 @@ X86MachineInstructionRaiser::getGlobalVariableValueAt(const MachineInstr &MI,
   // Raised instruction is added to this BasicBlock.
   BasicBlock *RaisedBB = getRaisedBasicBlock(MI.getParent());
 
-  for (auto Symbol : Elf64LEObjFile->symbols()) {
-    auto SymNameOrErr = Symbol.getName();
-    if (!SymNameOrErr) {
-      // No need to report. Just consume it.
-      consumeError(SymNameOrErr.takeError());
-    } else {
-      GlobalSymType = Symbol.getELFType();
-
-      if ((GlobalSymType == ELF::STT_OBJECT) ||
-          (GlobalSymType == ELF::STT_FUNC)) {
-        auto SymAddr = Symbol.getAddress();
-        auto SymSize = Symbol.getSize();
-
-        if (!SymAddr)
-          reportError(SymAddr.takeError(),
-                      "Failed to lookup symbol for global address");
-        uint64_t SymAddrVal = SymAddr.get();
-        // We have established that Offset is not negative above. So, OK to
-        // cast.
-        // Check if the memory address Offset is in the range [SymAddrVal,
-        // SymAddrVal+SymSize)
-        if ((SymAddrVal <= (unsigned)Offset) &&
-            ((SymAddrVal + SymSize) > (unsigned)Offset)) {
-          GlobalSymRef = Symbol;
-          GlobalSymOffset = Offset - SymAddrVal;
-          GlobalSymFound = true;
-          break;
-        }
-      }
-    }
+  const SymbolIndex::SymbolEntry *GlobalSym =
+      MR->getSymbolIndex().findSymbolContaining(
+          Offset, {ELF::STT_OBJECT, ELF::STT_FUNC});
+  if (GlobalSym != nullptr) {
+    GlobalSymRef = GlobalSym->Symbol;
+    GlobalSymOffset = Offset - GlobalSym->Address;
+    GlobalSymType = GlobalSym->Type;
+    GlobalSymFound = true;
   }
 
   if (!GlobalSymFound) {
@@ -1712,11 +1915,8 @@ X86MachineInstructionRaiser::getGlobalVariableValueAt(const MachineInstr &MI,
       // Find if a global value associated with symbol name is already
       // created
       StringRef GlobalDataSymNameIndexStrRef(GlobalDataSymName.get());
-      for (GlobalVariable &GV : MR->getModule()->globals()) {
-        if (GV.getName().compare(GlobalDataSymNameIndexStrRef) == 0) {
-          GlobalVariableValue = &GV;
-        }
-      }
+      GlobalVariableValue = MR->getModule()->getGlobalVariable(
+          GlobalDataSymNameIndexStrRef, /* AllowInternal */ true);
       // By default, the symbol alignment is the symbol section alignment.
       // Will be adjusted as needed based on the size of the symbol later.
       auto GlobalDataSymSection = GlobalSymRef.getSection();
@@ -1793,72 +1993,69 @@ X86MachineInstructionRaiser::getGlobalVariableValueAt(const MachineInstr &MI,
         // address.
         SmallVector<Constant *, 32> ConstantVec;
         bool IsBSSSymbol = false;
-        for (section_iterator SecIter : Elf64LEObjFile->sections()) {
-          uint64_t SecStart = SecIter->getAddress();
-          uint64_t SecEnd = SecStart + SecIter->getSize();
-          if ((SecStart <= SymVirtualAddr) && (SecEnd > SymVirtualAddr)) {
-            // Get the initial symbol value only if this is not a bss section.
-            // Else, symVal is already initialized to 0.
-            if (SecIter->isBSS()) {
-              Lnkg = GlobalValue::CommonLinkage;
-              IsBSSSymbol = true;
-            } else {
-              StringRef SecData = unwrapOrError(
-                  SecIter->getContents(), MR->getObjectFile()->getFileName());
-              unsigned Index = SymVirtualAddr - SecStart;
-              const char *Beg =
-                  reinterpret_cast<const char *>(SecData.bytes_begin() + Index);
-
-              // Symbol size should at least be the same as memory access size
-              // of the instruction.
-              assert(
-                  MemAccessSizeInBytes <= SymbSize &&
-                  "Inconsistent values of memory access size and symbol size");
-              // Read MemAccessSize number of bytes and check if they represent
-              // addresses in .rodata.
-              StringRef SymbolBytes(Beg, SymbSize);
-              unsigned BytesRead = 0;
-              // Symbol represents addresses into .rodata section.
-              bool SymHasRODataAddrs = false;
-              // Symbol array values greater that 8 bytes are not yet supported.
-              uint64_t SymArrayElem = 0;
-              for (unsigned char B : SymbolBytes) {
-                unsigned ByteNum = ++BytesRead % MemAccessSizeInBytes;
-                if (ByteNum == 0) {
-                  // Finish reading one symbol data item of size.
-                  SymArrayElem |= B << (MemAccessSizeInBytes - 1) * 8;
-                  // Get the value representing .rodata content if it is .rodata
-                  // section address.
-                  Value *RODataValue = getOrCreateGlobalRODataValueAtOffset(
-                      SymArrayElem, RaisedBB);
-                  // Note if the first unit of data read is an address of
-                  // .rodata content.
-                  if (BytesRead == MemAccessSizeInBytes)
-                    SymHasRODataAddrs = (RODataValue != nullptr);
-                  // If the SymArrElem does not correspond to an .rodata address
-                  // consider it to be data.
-                  if (!SymHasRODataAddrs) {
-                    Constant *ConstVal = ConstantInt::get(
-                        Ctx, APInt(MemAccessSizeInBytes * 8, SymArrayElem));
-                    ConstantVec.push_back(ConstVal);
+        const SectionMap::SectionEntry *Sec =
+            MR->getSectionMap().findSectionContaining(SymVirtualAddr,
+                                                      /* IncludeEnd */ false);
+        if (Sec != nullptr) {
+          uint64_t SecStart = Sec->Address;
+          // Get the initial symbol value only if this is not a bss section.
+          // Else, symVal is already initialized to 0.
+          if (Sec->IsBSS) {
+            Lnkg = GlobalValue::CommonLinkage;
+            IsBSSSymbol = true;
+          } else {
+            StringRef SecData = toStringRef(Sec->Contents);
+            unsigned Index = SymVirtualAddr - SecStart;
+            const char *Beg =
+                reinterpret_cast<const char *>(SecData.bytes_begin() + Index);
+
+            // Symbol size should at least be the same as memory access size
+            // of the instruction.
+            assert(MemAccessSizeInBytes <= SymbSize &&
+                   "Inconsistent values of memory access size and symbol size");
+            // Read MemAccessSize number of bytes and check if they represent
+            // addresses in .rodata.
+            StringRef SymbolBytes(Beg, SymbSize);
+            unsigned BytesRead = 0;
+            // Symbol represents addresses into .rodata section.
+            bool SymHasRODataAddrs = false;
+            // Symbol array values greater that 8 bytes are not yet supported.
+            uint64_t SymArrayElem = 0;
+            for (unsigned char B : SymbolBytes) {
+              unsigned ByteNum = ++BytesRead % MemAccessSizeInBytes;
+              if (ByteNum == 0) {
+                // Finish reading one symbol data item of size.
+                SymArrayElem |= B << (MemAccessSizeInBytes - 1) * 8;
+                // Get the value representing .rodata content if it is .rodata
+                // section address.
+                Value *RODataValue = getOrCreateGlobalRODataValueAtOffset(
+                    SymArrayElem, RaisedBB);
+                // Note if the first unit of data read is an address of
+                // .rodata content.
+                if (BytesRead == MemAccessSizeInBytes)
+                  SymHasRODataAddrs = (RODataValue != nullptr);
+                // If the SymArrElem does not correspond to an .rodata address
+                // consider it to be data.
+                if (!SymHasRODataAddrs) {
+                  Constant *ConstVal = ConstantInt::get(
+                      Ctx, APInt(MemAccessSizeInBytes * 8, SymArrayElem));
+                  ConstantVec.push_back(ConstVal);
+                } else {
+                  // SymArrElem corresponds to an .rodata address,
+                  if (isa<ConstantExpr>(RODataValue)) {
+                    ConstantVec.push_back(dyn_cast<Constant>(RODataValue));
                   } else {
-                    // SymArrElem corresponds to an .rodata address,
-                    if (isa<ConstantExpr>(RODataValue)) {
-                      ConstantVec.push_back(dyn_cast<Constant>(RODataValue));
-                    } else {
-                      assert(false && "Unhandled global value");
-                    }
+                    assert(false && "Unhandled global value");
                   }
-                  // Clear symbol element value
-                  SymArrayElem = 0;
-                } else
-                  SymArrayElem |= B << (ByteNum - 1) * 8;
-              }
-              // Ensure that all SymSize bytes were read.
-              assert(BytesRead == SymbSize &&
-                     "Incorrect number of symbol bytes read");
+                }
+                // Clear symbol element value
+                SymArrayElem = 0;
+              } else
+                SymArrayElem |= B << (ByteNum - 1) * 8;
             }
-            break;
+            // Ensure that all SymSize bytes were read.
+            assert(BytesRead == SymbSize &&
+                   "Incorrect number of symbol bytes read");
           }
         }
 
@@ -2481,10 +2678,21 @@ bool X86MachineInstructionRaiser::recordMachineInstrInfo(
       for (unsigned Idx = 0; Idx < ImplUsesCount; Idx++) {
         // Get the reaching definition of the implicit use register.
         if (ImplUses[Idx] == X86::EFLAGS) {
+          // Only the values of the bits tested by the condition of a
+          // conditional branch are read, so that no others are computed.
+          // None are read if the condition folds into a compare.
+          int MBBNo = MI.getParent()->getNumber();
+          X86::CondCode CC = getBranchCondCode(MI);
+          vector<EFLAGBit> TestedBits;
+          if (!raisedValues->isConditionFoldable(CC, MBBNo))
+            TestedBits = getCondEflagBits(CC);
           for (auto FlgBit : EFlagBits) {
-            Value *Val = getRegOrArgValue(FlgBit, MI.getParent()->getNumber());
-            assert((Val != nullptr) &&
-                   "Unexpected null value of implicit eflags bits");
+            Value *Val = nullptr;
+            if (llvm::is_contained(TestedBits, FlgBit)) {
+              Val = getRegOrArgValue(FlgBit, MBBNo);
+              assert((Val != nullptr) &&
+                     "Unexpected null value of implicit eflags bits");
+            }
             CurCTInfo->RegValues.push_back(Val);
           }
         } else {
@@ -2507,4 +2715,19 @@ bool X86MachineInstructionRaiser::instrNameStartsWith(const MachineInstr &MI,
   return x86InstrInfo->getName(MI.getOpcode()).startswith(Name);
 }
 
+X86::CondCode
+X86MachineInstructionRaiser::getBranchCondCode(const MachineInstr &MI) const {
+  // Unfortunately X86::getCondFromBranch(MI) only looks at JCC_1. We need
+  // to handle JCC_2 and JCC_4 as well.
+  switch (MI.getOpcode()) {
+  case X86::JCC_1:
+  case X86::JCC_2:
+  case X86::JCC_4:
+    return static_cast<X86::CondCode>(
+        MI.getOperand(MI.getDesc().getNumOperands() - 1).getImm());
+  default:
+    return X86::COND_INVALID;
+  }
+}
+
 #undef DEBUG_TYPE
@@ -29,11 +29,13 @@ bool X86ModuleRaiser::collectDynamicRelocations() {
   std::vector<SectionRef> DynRelSec = Obj->dynamic_relocation_sections();
   for (const SectionRef &Section : DynRelSec)
     for (const RelocationRef &Reloc : Section.relocations())
-      DynRelocs.push_back(Reloc);
+      Relocs.addDynamicRelocation(Reloc);
 
   return true;
 }
 
 void registerX86ModuleRaiser() {
-  registerModuleRaiser(new X86ModuleRaiser());
+  registerModuleRaiser(Triple::x86_64, []() -> ModuleRaiser * {
+    return new X86ModuleRaiser();
+  });
 }
@@ -31,6 +31,8 @@ public:
   CreateAndAddMachineFunctionRaiser(Function *F, const ModuleRaiser *MR,
                                     uint64_t Start, uint64_t End) override;
   bool collectDynamicRelocations() override;
+  // X86 raiser passes look up MCInst offsets only through MCInstRaiser.
+  bool needsMCInstOffsetMetadata() const override { return false; }
 };
 
 } // end namespace mctoll
@@ -15,6 +15,10 @@
 #include "InstMetadata.h"
 #include "RuntimeFunction.h"
 #include "X86RegisterUtils.h"
+#include "llvm-mctoll.h"
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/CFG.h"
 #include "llvm/Support/Debug.h"
 #include <X86InstrBuilder.h>
 #include <X86Subtarget.h>
@@ -25,9 +29,45 @@ using namespace llvm;
 using namespace llvm::mctoll;
 using namespace llvm::mctoll::X86RegisterUtils;
 
+STATISTIC(NumEflagsMaterialized, "Number of EFLAGS bit values materialized");
+STATISTIC(NumEflagsElided, "Number of EFLAGS bit computations elided");
+STATISTIC(NumConditionsFolded, "Number of conditions folded into a compare");
+STATISTIC(NumCastsFolded, "Number of casts folded upon creation");
+
+void PhysRegDefTable::init(unsigned NumMBBs) {
+  this->NumMBBs = NumMBBs;
+  LaneIndex.assign(EFLAGS::UNDEFINED + 1, 0);
+  Lanes.clear();
+  // EFLAGS bits are defined by most blocks.
+  for (EFLAGBit FlagBit : EFlagBits)
+    getOrCreateLane(FlagBit);
+}
+
+PhysRegDefTable::Lane &PhysRegDefTable::getOrCreateLane(unsigned int SuperReg) {
+  assert((SuperReg < LaneIndex.size()) && "Unexpected register");
+  if (LaneIndex[SuperReg] == 0) {
+    Lanes.emplace_back();
+    Lane &L = Lanes.back();
+    L.Defs.resize(NumMBBs, std::make_pair(0, nullptr));
+    L.DefMBBs.resize(NumMBBs);
+    LaneIndex[SuperReg] = Lanes.size();
+  }
+  return Lanes[LaneIndex[SuperReg] - 1];
+}
+
+void PhysRegDefTable::replaceDefValue(Value *From, Value *To) {
+  for (Lane &L : Lanes)
+    for (unsigned MBBNo : L.DefMBBs.set_bits())
+      if (L.Defs[MBBNo].second == From)
+        L.Defs[MBBNo].second = To;
+}
+
 X86RaisedValueTracker::X86RaisedValueTracker(
     X86MachineInstructionRaiser *MIRaiser)
-    : X86MIRaiser(MIRaiser) {
+    : X86MIRaiser(MIRaiser),
+      Builder(MIRaiser->getMF().getFunction().getContext(),
+              InstSimplifyFolder(
+                  MIRaiser->getModuleRaiser()->getModule()->getDataLayout())) {
 
   // Initialize entries for function register arguments in physToValueMap
   // Only first 6 arguments are passed as registers
@@ -35,6 +75,8 @@ X86RaisedValueTracker::X86RaisedValueTracker(
   unsigned SSERegArgCount = X86RegisterUtils::SSEArgRegs64Bit.size();
   MachineFunction &MF = X86MIRaiser->getMF();
   Function *CurFunction = X86MIRaiser->getRaisedFunction();
+  PhysRegDefsInMBB.init(MF.getNumBlockIDs());
+  EflagProducers.resize(MF.getNumBlockIDs());
 
   unsigned GPArgNum = 0;
   unsigned SSEArgNum = 0;
@@ -59,8 +101,18 @@ X86RaisedValueTracker::X86RaisedValueTracker(
     }
 
     unsigned ArgTySzInBits = ArgTy->getPrimitiveSizeInBits();
-    PhysRegDefsInMBB[ArgReg][0] = std::make_pair(ArgTySzInBits, nullptr);
+    PhysRegDefsInMBB.getOrCreateDef(ArgReg, 0) =
+        std::make_pair(ArgTySzInBits, nullptr);
   }
+
+  // Record the blocks that are raised, i.e., those reachable from the entry
+  // block.
+  ReachableMBBs.resize(MF.getNumBlockIDs());
+  RaisedMBBs.resize(MF.getNumBlockIDs());
+  if (!MF.empty())
+    for (MachineBasicBlock *MBB : depth_first(&MF))
+      ReachableMBBs.set(MBB->getNumber());
+
   // Walk all blocks to initialize physRegDefsInMBB based on register defs.
   for (MachineBasicBlock &MBB : MF) {
     int MBBNo = MBB.getNumber();
@@ -91,11 +143,11 @@ X86RaisedValueTracker::X86RaisedValueTracker(
         if (isSSE2Instruction(MI.getOpcode())) {
           uint8_t InstrBitPrecision =
               getInstructionBitPrecision(MI.getDesc().TSFlags);
-          PhysRegDefsInMBB[SuperReg][MBBNo] =
+          PhysRegDefsInMBB.getOrCreateDef(SuperReg, MBBNo) =
               std::make_pair(InstrBitPrecision, nullptr);
         } else {
           uint8_t PhysRegSzInBits = getPhysRegSizeInBits(PhysReg);
-          PhysRegDefsInMBB[SuperReg][MBBNo] =
+          PhysRegDefsInMBB.getOrCreateDef(SuperReg, MBBNo) =
               std::make_pair(PhysRegSzInBits, nullptr);
         }
       }
@@ -116,17 +168,18 @@ bool X86RaisedValueTracker::setPhysRegSSAValue(unsigned int PhysReg, int MBBNo,
 
   if (!Val->hasName() && PhysReg < X86::NUM_TARGET_REGS)
     Val->setName(X86MIRaiser->getRegisterInfo()->getName(PhysReg));
-  PhysRegDefsInMBB[SuperReg][MBBNo].second = Val;
+  DefRegSzValuePair &Def = PhysRegDefsInMBB.getOrCreateDef(SuperReg, MBBNo);
+  Def.second = Val;
+  if (isEflagBit(SuperReg))
+    getEflagProducer(SuperReg, MBBNo) = EflagProducer();
   if (Val->getType()->isFloatingPointTy()) {
     auto BitPrecision = Val->getType()->getPrimitiveSizeInBits();
-    PhysRegDefsInMBB[SuperReg][MBBNo].first = BitPrecision;
+    Def.first = BitPrecision;
   } else {
-    PhysRegDefsInMBB[SuperReg][MBBNo].first =
-        X86RegisterUtils::getPhysRegSizeInBits(PhysReg);
+    Def.first = X86RegisterUtils::getPhysRegSizeInBits(PhysReg);
   }
 
-  assert((PhysRegDefsInMBB[SuperReg][MBBNo].first != 0) &&
-         "Found incorrect size of physical register");
+  assert((Def.first != 0) && "Found incorrect size of physical register");
   return true;
 }
 
@@ -153,54 +206,23 @@ X86RaisedValueTracker::getGlobalReachingDefs(unsigned int PhysReg, int MBBNo,
     assert((LocalDef.first == MBBNo) && "Inconsistent local def info found");
     ReachingDefs.push_back(LocalDef);
   } else {
-    // For each of the predecessors find if SuperReg has a definition in its
+    // For each of the predecessors find the definitions of SuperReg in its
     // reach tree.
-    bool RDFound = true;
     for (auto *P : CurMBB->predecessors()) {
-      // Initialize a bit vector tracking visited basic blocks.
-      BitVector BlockVisited(MF.getNumBlockIDs(), false);
-      SmallVector<MachineBasicBlock *, 8> WorkList;
-
-      if (AllPreds && !RDFound)
-        break;
-      // Visit an unvisited predecessor P
-      if (BlockVisited[P->getNumber()])
-        continue;
-
-      WorkList.push_back(P);
-
-      // New path being traversed. Set RDFound to be false
-      RDFound = false;
-      while (!WorkList.empty()) {
-        MachineBasicBlock *PredMBB = WorkList.pop_back_val();
-        int CurPredMBBNo = PredMBB->getNumber();
-        if (!BlockVisited[CurPredMBBNo]) {
-          // Mark block as visited
-          BlockVisited.set(CurPredMBBNo);
-          const std::pair<int, Value *> ReachInfo =
-              getInBlockRegOrArgDefVal(PhysReg, CurPredMBBNo);
-
-          // if reach info found or if CurPredMBB has a definition of SuperReg,
-          // record it
-          if (ReachInfo.first != INVALID_MBB) {
-            ReachingDefs.push_back(ReachInfo);
-            RDFound = true;
-          } else {
-            // Reach info not found, continue walking the predecessors of CurBB.
-            for (auto *Pred : PredMBB->predecessors()) {
-              // push_back the block which was not visited.
-              if (!BlockVisited[Pred->getNumber()])
-                WorkList.push_back(Pred);
-            }
-          }
+      const SmallVectorImpl<int> &DefMBBNos =
+          getReachingDefBlocks(PhysReg, P->getNumber());
+      if (DefMBBNos.empty()) {
+        // If reaching definitions along all predecessors is requested, but
+        // were not found, clear the return list
+        if (AllPreds) {
+          ReachingDefs.clear();
+          break;
         }
+        continue;
       }
+      for (int DefMBBNo : DefMBBNos)
+        ReachingDefs.push_back(getInBlockRegOrArgDefVal(PhysReg, DefMBBNo));
     }
-
-    // If reaching definitions along all predecessors is requested, but were not
-    // found, clear the return list
-    if (AllPreds && !RDFound)
-      ReachingDefs.clear();
   }
 
   // Clean up any duplicate entries in ReachingDefs
@@ -213,6 +235,46 @@ X86RaisedValueTracker::getGlobalReachingDefs(unsigned int PhysReg, int MBBNo,
   return ReachingDefs;
 }
 
+// Return the numbers of the blocks with definitions of PhysReg that reach the
+// end of the block numbered MBBNo, i.e., the blocks in the reach tree of MBBNo
+// that define PhysReg. The walk of the reach tree is memoized. Since
+// definitions are never removed, the memoized blocks remain valid until a
+// block that did not define PhysReg defines it.
+const SmallVectorImpl<int> &
+X86RaisedValueTracker::getReachingDefBlocks(unsigned int PhysReg, int MBBNo) {
+  MachineFunction &MF = X86MIRaiser->getMF();
+  unsigned int SuperReg = X86MIRaiser->find64BitSuperReg(PhysReg);
+  int NumDefMBBs = PhysRegDefsInMBB.getNumDefMBBs(SuperReg);
+
+  ReachingDefBlocks &RDBlocks =
+      ReachingDefBlocksCache[std::make_pair(SuperReg, MBBNo)];
+  if (RDBlocks.NumDefMBBs == NumDefMBBs)
+    return RDBlocks.DefMBBNos;
+
+  RDBlocks.NumDefMBBs = NumDefMBBs;
+  RDBlocks.DefMBBNos.clear();
+  VisitedMBBs.resize(MF.getNumBlockIDs());
+  VisitedMBBs.reset();
+  SmallVector<int, 8> WorkList;
+  WorkList.push_back(MBBNo);
+  while (!WorkList.empty()) {
+    int CurMBBNo = WorkList.pop_back_val();
+    if (VisitedMBBs.test(CurMBBNo))
+      continue;
+    VisitedMBBs.set(CurMBBNo);
+    // If CurMBBNo has a definition of SuperReg, record it. Else continue
+    // walking its predecessors.
+    if (getInBlockRegOrArgDefVal(PhysReg, CurMBBNo).first != INVALID_MBB) {
+      RDBlocks.DefMBBNos.push_back(CurMBBNo);
+      continue;
+    }
+    for (auto *Pred : MF.getBlockNumbered(CurMBBNo)->predecessors())
+      if (!VisitedMBBs.test(Pred->getNumber()))
+        WorkList.push_back(Pred->getNumber());
+  }
+  return RDBlocks.DefMBBNos;
+}
+
 // Get last defined value of PhysReg in MBBNo. Returns nullptr if no definition
 // is found. NOTE: If this function is called while raising MBBNo, this returns
 // a value representing most recent definition of PhysReg as of current
@@ -227,21 +289,16 @@ X86RaisedValueTracker::getInBlockRegOrArgDefVal(unsigned int PhysReg,
 
   Value *DefValue = nullptr;
   int DefMBBNo = INVALID_MBB;
+  // The value of an EFLAGS bit is computed when first read.
+  if (isEflagBit(SuperReg))
+    materializeEflag(SuperReg, MBBNo);
   // TODO : Support outside of GPRs need to be implemented.
-  // Find the per-block definitions SuperReg
-  PhysRegMBBValueDefMap::iterator PhysRegBBValDefIter =
-      PhysRegDefsInMBB.find(SuperReg);
-  // If per-block definition map exists
-  if (PhysRegBBValDefIter != PhysRegDefsInMBB.end()) {
-    // Find if there is a definition in MBB with number MBBNo
-    MBBNoToValueMap MBBToValMap = PhysRegBBValDefIter->second;
-    MBBNoToValueMap::iterator MBBToValMapIter = MBBToValMap.find(MBBNo);
-    if (MBBToValMapIter != MBBToValMap.end()) {
-      assert((MBBToValMapIter->second.first != 0) &&
-             "Found incorrect size of physical register");
-      DefMBBNo = MBBToValMapIter->first;
-      DefValue = MBBToValMapIter->second.second;
-    }
+  // Find if there is a definition of SuperReg in MBB with number MBBNo
+  if (const DefRegSzValuePair *Def =
+          PhysRegDefsInMBB.lookupDef(SuperReg, MBBNo)) {
+    assert((Def->first != 0) && "Found incorrect size of physical register");
+    DefMBBNo = MBBNo;
+    DefValue = Def->second;
   }
   // If MBBNo is entry and ReachingDef was not found, check to see
   // if this is an argument value.
@@ -291,19 +348,11 @@ unsigned X86RaisedValueTracker::getInBlockPhysRegSize(unsigned int PhysReg,
   unsigned int SuperReg = X86MIRaiser->find64BitSuperReg(PhysReg);
 
   // TODO : Support outside of GPRs need to be implemented.
-  // Find the per-block definitions SuperReg
-  PhysRegMBBValueDefMap::iterator PhysRegBBValDefIter =
-      PhysRegDefsInMBB.find(SuperReg);
-  // If per-block definition map exists
-  if (PhysRegBBValDefIter != PhysRegDefsInMBB.end()) {
-    // Find if there is a definition in MBB with number MBBNo
-    MBBNoToValueMap MBBToValMap = PhysRegBBValDefIter->second;
-    MBBNoToValueMap::iterator MBBToValMapIter = MBBToValMap.find(MBBNo);
-    if (MBBToValMapIter != MBBToValMap.end()) {
-      assert((MBBToValMapIter->second.first != 0) &&
-             "Found incorrect size of physical register");
-      return MBBToValMapIter->second.first;
-    }
+  // Find if there is a definition of SuperReg in MBB with number MBBNo
+  if (const DefRegSzValuePair *Def =
+          PhysRegDefsInMBB.lookupDef(SuperReg, MBBNo)) {
+    assert((Def->first != 0) && "Found incorrect size of physical register");
+    return Def->first;
   }
   // MachineBasicBlock with MBBNo does not define SuperReg.
   return 0;
@@ -330,8 +379,18 @@ Value *X86RaisedValueTracker::getReachingDef(unsigned int PhysReg, int MBBNo,
   const ModuleRaiser *MR = X86MIRaiser->getModuleRaiser();
   ReachingDefs = getGlobalReachingDefs(PhysReg, MBBNo, AllPreds);
   int RDVecSz = ReachingDefs.size();
-  // If there are more than one distinct incoming reaching defs
-  if (RDVecSz > 1) {
+  if (RDVecSz > 1 && SSAWithPHIs) {
+    // Construct PHI nodes that merge the reaching definitions instead of
+    // promoting PhysReg to a stack slot.
+    RetValue = readRegAtBlockEntry(PhysReg, MBBNo);
+    if ((RetValue != nullptr) && !AnySubReg && !isSSE2Reg(PhysReg)) {
+      Type *RegType = (isEflagBit(PhysReg))
+                          ? Type::getInt1Ty(Ctxt)
+                          : X86MIRaiser->getPhysRegType(PhysReg);
+      RetValue = castAfterDef(RetValue, RegType);
+    }
+  } else if (RDVecSz > 1) {
+    // If there are more than one distinct incoming reaching defs
     // 1. Allocate stack slot with type general enough to hold any of the
     //    reaching values
     // 2. store each of the incoming values in that stack slot. cast the value
@@ -504,15 +563,470 @@ Value *X86RaisedValueTracker::getReachingDef(unsigned int PhysReg, int MBBNo,
   return RetValue;
 }
 
-// Set the value of FlagBit to BitVal based on the value computed by TestVal.
-// If the test corresponding to FlagBit is true, it is set, else it is cleared.
-// TestVal is the raised value of MI.
+// Return true if all reachable predecessors of the block numbered MBBNo have
+// been raised.
+bool X86RaisedValueTracker::isBlockSealed(int MBBNo) {
+  if (PHINodesSealed)
+    return true;
+  MachineFunction &MF = X86MIRaiser->getMF();
+  for (auto *Pred : MF.getBlockNumbered(MBBNo)->predecessors()) {
+    int PredMBBNo = Pred->getNumber();
+    if (ReachableMBBs.test(PredMBBNo) && !RaisedMBBs.test(PredMBBNo))
+      return false;
+  }
+  return true;
+}
+
+Type *X86RaisedValueTracker::getPHIType(unsigned int SuperReg) {
+  LLVMContext &Ctx(X86MIRaiser->getMF().getFunction().getContext());
+  if (isEflagBit(SuperReg))
+    return Type::getInt1Ty(Ctx);
+  // SSE register values are merged as 128-bit values, as is done when they
+  // are promoted to stack slots.
+  if (isSSE2Reg(SuperReg))
+    return VectorType::get(Type::getInt32Ty(Ctx), 4, false);
+  return Type::getInt64Ty(Ctx);
+}
+
+Value *X86RaisedValueTracker::castAfterDef(Value *Val, Type *Ty) {
+  if (Val->getType() == Ty)
+    return Val;
+
+  // Insert the cast right after the definition of Val. Values that are not
+  // instructions are cast at the start of the entry block.
+  BasicBlock *InsertBB = nullptr;
+  Instruction *InsertBefore = nullptr;
+  if (auto *I = dyn_cast<Instruction>(Val)) {
+    InsertBB = I->getParent();
+    assert(InsertBB != nullptr &&
+           "Unexpected reaching definition not inserted in a block");
+    InsertBefore =
+        isa<PHINode>(I) ? InsertBB->getFirstNonPHI() : I->getNextNode();
+  } else {
+    InsertBB = &X86MIRaiser->getRaisedFunction()->getEntryBlock();
+    InsertBefore = InsertBB->getFirstNonPHI();
+  }
+
+  Type *ValTy = Val->getType();
+  bool IsSSEValue = ValTy->isFloatingPointTy() || ValTy->isVectorTy() ||
+                    Ty->isFloatingPointTy() || Ty->isVectorTy();
+  unsigned CastOp = IsSSEValue ? ReinterpretSSECast
+                               : CastInst::getCastOpcode(Val, false, Ty, false);
+  return createCast(CastOp, Val, Ty, InsertBB, InsertBefore);
+}
+
+Value *X86RaisedValueTracker::createCast(unsigned CastOp, Value *SrcVal,
+                                         Type *DstTy, BasicBlock *InsertBB,
+                                         Instruction *InsertBefore) {
+  // Reuse the cast of SrcVal to DstTy inserted in InsertBB, if any. Casts are
+  // inserted at the end of the block or right after the definition of SrcVal,
+  // so it is available at the insertion point.
+  auto Key = std::make_tuple(CastOp, SrcVal, DstTy, InsertBB);
+  auto Iter = CastValues.find(Key);
+  if (Iter != CastValues.end()) {
+    auto *I = dyn_cast_or_null<Instruction>(Iter->second);
+    if ((I != nullptr) && (I->getParent() == InsertBB) &&
+        (I->getType() == DstTy)) {
+      if (CastOp == ReinterpretSSECast)
+        return I;
+      auto *CInst = dyn_cast<CastInst>(I);
+      if ((CInst != nullptr) && (CInst->getOperand(0) == SrcVal) &&
+          (CInst->getOpcode() == CastOp))
+        return CInst;
+    }
+  }
+
+  if (CastOp == ReinterpretSSECast) {
+    Value *CastVal = reinterpretSSERegValue(SrcVal, DstTy, InsertBB,
+                                            InsertBefore);
+    if (isa<Instruction>(CastVal))
+      CastValues[Key] = CastVal;
+    else
+      ++NumCastsFolded;
+    return CastVal;
+  }
+
+  // Casts of constants and of casts are folded as they are created.
+  if (InsertBefore != nullptr)
+    Builder.SetInsertPoint(InsertBefore);
+  else
+    Builder.SetInsertPoint(InsertBB);
+  Value *CastVal = Builder.CreateCast(
+      static_cast<Instruction::CastOps>(CastOp), SrcVal, DstTy);
+  auto *CInst = dyn_cast<CastInst>(CastVal);
+  if ((CInst != nullptr) && (CInst->getOperand(0) == SrcVal) &&
+      (CInst->getOpcode() == CastOp)) {
+    setInstMetadataRODataIndex(SrcVal, CInst);
+    CastValues[Key] = CInst;
+  } else
+    ++NumCastsFolded;
+  return CastVal;
+}
+
+// Return the value of PhysReg at the end of the block numbered MBBNo.
+Value *X86RaisedValueTracker::readRegAtBlockEnd(unsigned int PhysReg,
+                                                int MBBNo) {
+  std::pair<int, Value *> Def = getInBlockRegOrArgDefVal(PhysReg, MBBNo);
+  if (Def.first != INVALID_MBB)
+    return Def.second;
+  return readRegAtBlockEntry(PhysReg, MBBNo);
+}
+
+// Return the value of PhysReg at the entry of the block numbered MBBNo. This
+// is an implementation of the SSA construction algorithm described in "Simple
+// and Efficient Construction of Static Single Assignment Form" by Braun et
+// al. Blocks are sealed once all their predecessors are raised. Until then,
+// and in blocks with more than one predecessor, a PHI node is constructed
+// whose incoming values are added once all branches are raised.
+Value *X86RaisedValueTracker::readRegAtBlockEntry(unsigned int PhysReg,
+                                                  int MBBNo) {
+  MachineFunction &MF = X86MIRaiser->getMF();
+  unsigned int SuperReg = X86MIRaiser->find64BitSuperReg(PhysReg);
+
+  // The value at the entry of a sealed block with a single predecessor is
+  // that at the end of the predecessor. Walk such blocks iteratively.
+  SmallVector<int, 8> SinglePredMBBNos;
+  int CurMBBNo = MBBNo;
+  Value *Val = nullptr;
+  bool PHICreated = false;
+  while (true) {
+    auto Iter = RegEntryValues.find(std::make_pair(SuperReg, CurMBBNo));
+    if (Iter != RegEntryValues.end()) {
+      Val = Iter->second;
+      break;
+    }
+
+    SmallVector<int, 4> PredMBBNos;
+    for (auto *Pred : MF.getBlockNumbered(CurMBBNo)->predecessors())
+      if (ReachableMBBs.test(Pred->getNumber()))
+        PredMBBNos.push_back(Pred->getNumber());
+    // The value is undefined at the entry of the function.
+    if (PredMBBNos.empty())
+      break;
+
+    if ((PredMBBNos.size() == 1) && isBlockSealed(CurMBBNo)) {
+      SinglePredMBBNos.push_back(CurMBBNo);
+      std::pair<int, Value *> Def =
+          getInBlockRegOrArgDefVal(PhysReg, PredMBBNos[0]);
+      if (Def.first != INVALID_MBB) {
+        Val = Def.second;
+        break;
+      }
+      CurMBBNo = PredMBBNos[0];
+      continue;
+    }
+
+    // Construct a PHI node at the start of the block.
+    BasicBlock *BB =
+        X86MIRaiser->getRaisedBasicBlock(MF.getBlockNumbered(CurMBBNo));
+    std::string RegName =
+        isEflagBit(SuperReg)
+            ? getEflagName(SuperReg)
+            : X86MIRaiser->getRegisterInfo()->getName(SuperReg);
+    PHINode *Phi =
+        PHINode::Create(getPHIType(SuperReg), PredMBBNos.size(), RegName);
+    if (BB->empty())
+      BB->getInstList().push_back(Phi);
+    else
+      Phi->insertBefore(&BB->front());
+    RegEntryValues[std::make_pair(SuperReg, CurMBBNo)] = Phi;
+    IncompletePHIs.push_back({Phi, SuperReg, CurMBBNo});
+    RegPHIs.push_back(Phi);
+    Val = Phi;
+    PHICreated = true;
+    break;
+  }
+
+  for (int SinglePredMBBNo : SinglePredMBBNos)
+    RegEntryValues[std::make_pair(SuperReg, SinglePredMBBNo)] = Val;
+
+  // Incoming values of PHI nodes constructed after all blocks are raised are
+  // added right away. The PHI node may turn out to be trivial and be replaced.
+  if (PHICreated && PHINodesSealed && !CompletingPHINodes) {
+    completePHINodes();
+    Val = RegEntryValues[std::make_pair(SuperReg, MBBNo)];
+  }
+  return Val;
+}
+
+void X86RaisedValueTracker::addPHIIncomingValues(const RegPHINode &RegPhi) {
+  PHINode *Phi = RegPhi.Phi;
+  // Add an incoming value for each predecessor of the raised block. Note that
+  // a block may appear more than once as predecessor.
+  for (BasicBlock *PredBB : predecessors(Phi->getParent())) {
+    Value *Val = nullptr;
+    auto Iter = BBToMBBNoMap.find(PredBB);
+    if (Iter != BBToMBBNoMap.end())
+      Val = readRegAtBlockEnd(RegPhi.SuperReg, Iter->second);
+    if (Val == nullptr) {
+      Val = UndefValue::get(Phi->getType());
+    } else {
+      Val = castAfterDef(Val, Phi->getType());
+      setInstMetadataRODataIndex(Val, Phi);
+    }
+    Phi->addIncoming(Val, PredBB);
+  }
+}
+
+void X86RaisedValueTracker::setBlockRaised(int MBBNo) {
+  MachineFunction &MF = X86MIRaiser->getMF();
+  RaisedMBBs.set(MBBNo);
+  BBToMBBNoMap[X86MIRaiser->getRaisedBasicBlock(MF.getBlockNumbered(MBBNo))] =
+      MBBNo;
+}
+
+bool X86RaisedValueTracker::completePHINodes() {
+  PHINodesSealed = true;
+  // Values may have been replaced or deleted since the casts were created.
+  CastValues.clear();
+
+  CompletingPHINodes = true;
+  // Adding incoming values may construct more PHI nodes.
+  while (!IncompletePHIs.empty()) {
+    RegPHINode RegPhi = IncompletePHIs.pop_back_val();
+    addPHIIncomingValues(RegPhi);
+  }
+  CompletingPHINodes = false;
+
+  // Remove trivial PHI nodes, i.e., those that merge a single value other
+  // than themselves. Removing a PHI node may make its users trivial.
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (WeakVH &PhiVH : RegPHIs) {
+      PHINode *Phi = dyn_cast_or_null<PHINode>(PhiVH);
+      if (Phi == nullptr)
+        continue;
+      Value *SameVal = nullptr;
+      bool IsTrivial = true;
+      for (Value *Incoming : Phi->incoming_values()) {
+        if ((Incoming == Phi) || (Incoming == SameVal))
+          continue;
+        if (SameVal != nullptr) {
+          IsTrivial = false;
+          break;
+        }
+        SameVal = Incoming;
+      }
+      if (!IsTrivial)
+        continue;
+      if (SameVal == nullptr)
+        SameVal = UndefValue::get(Phi->getType());
+
+      // Update the recorded register definitions that refer to Phi.
+      PhysRegDefsInMBB.replaceDefValue(Phi, SameVal);
+      for (auto Iter = CastValues.begin(), End = CastValues.end();
+           Iter != End;) {
+        auto Cur = Iter++;
+        if (std::get<1>(Cur->first) == Phi)
+          CastValues.erase(Cur);
+      }
+      Phi->replaceAllUsesWith(SameVal);
+      Phi->eraseFromParent();
+      Changed = true;
+    }
+  }
+  erase_if(RegPHIs, [](const WeakVH &PhiVH) { return PhiVH == nullptr; });
+  return true;
+}
+
+// Record that MI sets FlagBit based on the value computed by TestResultVal,
+// the raised value of MI. Most flag-setting instructions are followed by
+// another that sets the same bits before any of them is read, so the value of
+// FlagBit is only computed when it is read. The value is a function of
+// values available at the end of the block of MI and is computed there.
 bool X86RaisedValueTracker::testAndSetEflagSSAValue(unsigned int FlagBit,
                                                     const MachineInstr &MI,
                                                     Value *TestResultVal) {
   assert((FlagBit >= X86RegisterUtils::EFLAGS::CF) &&
          (FlagBit < X86RegisterUtils::EFLAGS::UNDEFINED) &&
          "Unknown EFLAGS bit specified");
+  int MBBNo = MI.getParent()->getNumber();
+  if (!isEflagComputationDeferred(FlagBit, MI)) {
+    // The value of FlagBit before MI may be used to compute its new value.
+    materializeEflag(FlagBit, MBBNo);
+    getEflagProducer(FlagBit, MBBNo) = EflagProducer();
+    return computeEflagValue(FlagBit, MI, TestResultVal);
+  }
+
+  EflagProducer &Producer = getEflagProducer(FlagBit, MBBNo);
+  if ((Producer.MI != nullptr) && !Producer.Materialized)
+    ++NumEflagsElided;
+  Producer.MI = &MI;
+  Producer.TestResultVal = TestResultVal;
+  Producer.Materialized = false;
+  // EFLAGS bit size is 1. The value is set when materialized.
+  PhysRegDefsInMBB.getOrCreateDef(FlagBit, MBBNo) = std::make_pair(1, nullptr);
+  return true;
+}
+
+// Return true if the computation of the value of FlagBit set by MI can be
+// deferred, i.e., if it does not depend on the value of any EFLAGS bit before
+// MI and defines no other bit.
+bool X86RaisedValueTracker::isEflagComputationDeferred(unsigned int FlagBit,
+                                                       const MachineInstr &MI) {
+  switch (FlagBit) {
+  case X86RegisterUtils::EFLAGS::CF:
+    // CF is left unchanged by shifts with a count of 0. IMUL sets OF along
+    // with CF.
+    return !(X86MIRaiser->instrNameStartsWith(MI, "SHL") ||
+             X86MIRaiser->instrNameStartsWith(MI, "SHR") ||
+             X86MIRaiser->instrNameStartsWith(MI, "SAR") ||
+             X86MIRaiser->instrNameStartsWith(MI, "IMUL"));
+  case X86RegisterUtils::EFLAGS::OF:
+    // OF is left unchanged by rotates of more than 1 bit.
+    return !(X86MIRaiser->instrNameStartsWith(MI, "ROL") ||
+             X86MIRaiser->instrNameStartsWith(MI, "ROR"));
+  default:
+    return true;
+  }
+}
+
+// Compute the value of FlagBit last set in MBBNo, if its computation was
+// deferred and it is not yet computed.
+void X86RaisedValueTracker::materializeEflag(unsigned int FlagBit, int MBBNo) {
+  EflagProducer &Producer = getEflagProducer(FlagBit, MBBNo);
+  if ((Producer.MI == nullptr) || Producer.Materialized)
+    return;
+  assert((Producer.TestResultVal != nullptr) &&
+         "Value setting EFLAGS bit deleted before the bit is read");
+  Producer.Materialized = true;
+
+  // The block is being raised or all its instructions other than branches
+  // are raised. Instructions are added at the end of the block, so insert the
+  // value before any terminator.
+  MachineFunction &MF = X86MIRaiser->getMF();
+  BasicBlock *RaisedBB =
+      X86MIRaiser->getRaisedBasicBlock(MF.getBlockNumbered(MBBNo));
+  Instruction *TermInst = RaisedBB->getTerminator();
+  if (TermInst != nullptr)
+    TermInst->removeFromParent();
+  computeEflagValue(FlagBit, *Producer.MI, Producer.TestResultVal);
+  if (TermInst != nullptr)
+    RaisedBB->getInstList().push_back(TermInst);
+}
+
+CmpInst::Predicate X86RaisedValueTracker::getFoldedPredicate(X86::CondCode CC,
+                                                             int MBBNo,
+                                                             Value *&LHS,
+                                                             Value *&RHS) {
+  // All EFLAGS bits tested by CC must have been last set by the same
+  // instruction.
+  const MachineInstr *ProducerMI = nullptr;
+  Value *TestResultVal = nullptr;
+  for (EFLAGBit FlagBit : getCondEflagBits(CC)) {
+    const EflagProducer &Producer = getEflagProducer(FlagBit, MBBNo);
+    if (Producer.MI == nullptr)
+      return CmpInst::Predicate::BAD_ICMP_PREDICATE;
+    Value *ProducerVal = Producer.TestResultVal;
+    if (ProducerMI == nullptr) {
+      ProducerMI = Producer.MI;
+      TestResultVal = ProducerVal;
+    } else if ((Producer.MI != ProducerMI) || (ProducerVal != TestResultVal)) {
+      return CmpInst::Predicate::BAD_ICMP_PREDICATE;
+    }
+  }
+
+  BinaryOperator *TestInst = dyn_cast_or_null<BinaryOperator>(TestResultVal);
+  if ((ProducerMI == nullptr) || (TestInst == nullptr))
+    return CmpInst::Predicate::BAD_ICMP_PREDICATE;
+  Value *ZeroVal = ConstantInt::get(TestInst->getType(), 0);
+
+  // The bits set by a compare or subtract of A and B are those of A - B.
+  if ((X86MIRaiser->instrNameStartsWith(*ProducerMI, "CMP") ||
+       X86MIRaiser->instrNameStartsWith(*ProducerMI, "SUB")) &&
+      (TestInst->getOpcode() == Instruction::Sub)) {
+    LHS = TestInst->getOperand(0);
+    RHS = TestInst->getOperand(1);
+    switch (CC) {
+    case X86::COND_E:
+      return CmpInst::Predicate::ICMP_EQ;
+    case X86::COND_NE:
+      return CmpInst::Predicate::ICMP_NE;
+    case X86::COND_B:
+      return CmpInst::Predicate::ICMP_ULT;
+    case X86::COND_AE:
+      return CmpInst::Predicate::ICMP_UGE;
+    case X86::COND_BE:
+      return CmpInst::Predicate::ICMP_ULE;
+    case X86::COND_A:
+      return CmpInst::Predicate::ICMP_UGT;
+    case X86::COND_L:
+      return CmpInst::Predicate::ICMP_SLT;
+    case X86::COND_GE:
+      return CmpInst::Predicate::ICMP_SGE;
+    case X86::COND_LE:
+      return CmpInst::Predicate::ICMP_SLE;
+    case X86::COND_G:
+      return CmpInst::Predicate::ICMP_SGT;
+    case X86::COND_S:
+      LHS = TestInst;
+      RHS = ZeroVal;
+      return CmpInst::Predicate::ICMP_SLT;
+    case X86::COND_NS:
+      LHS = TestInst;
+      RHS = ZeroVal;
+      return CmpInst::Predicate::ICMP_SGE;
+    default:
+      return CmpInst::Predicate::BAD_ICMP_PREDICATE;
+    }
+  }
+
+  // The bits set by a test of A and B are those of A & B, with OF and CF
+  // cleared.
+  if (X86MIRaiser->instrNameStartsWith(*ProducerMI, "TEST") &&
+      (TestInst->getOpcode() == Instruction::And)) {
+    LHS = TestInst;
+    RHS = ZeroVal;
+    switch (CC) {
+    case X86::COND_E:
+    case X86::COND_BE:
+      return CmpInst::Predicate::ICMP_EQ;
+    case X86::COND_NE:
+    case X86::COND_A:
+      return CmpInst::Predicate::ICMP_NE;
+    case X86::COND_S:
+    case X86::COND_L:
+      return CmpInst::Predicate::ICMP_SLT;
+    case X86::COND_NS:
+    case X86::COND_GE:
+      return CmpInst::Predicate::ICMP_SGE;
+    case X86::COND_LE:
+      return CmpInst::Predicate::ICMP_SLE;
+    case X86::COND_G:
+      return CmpInst::Predicate::ICMP_SGT;
+    default:
+      return CmpInst::Predicate::BAD_ICMP_PREDICATE;
+    }
+  }
+  return CmpInst::Predicate::BAD_ICMP_PREDICATE;
+}
+
+bool X86RaisedValueTracker::isConditionFoldable(X86::CondCode CC, int MBBNo) {
+  Value *LHS = nullptr;
+  Value *RHS = nullptr;
+  return getFoldedPredicate(CC, MBBNo, LHS, RHS) !=
+         CmpInst::Predicate::BAD_ICMP_PREDICATE;
+}
+
+Value *X86RaisedValueTracker::foldCondition(X86::CondCode CC, int MBBNo,
+                                            BasicBlock *InsertBlock) {
+  Value *LHS = nullptr;
+  Value *RHS = nullptr;
+  CmpInst::Predicate Pred = getFoldedPredicate(CC, MBBNo, LHS, RHS);
+  if (Pred == CmpInst::Predicate::BAD_ICMP_PREDICATE)
+    return nullptr;
+  ++NumConditionsFolded;
+  return new ICmpInst(*InsertBlock, Pred, LHS, RHS, "Cond");
+}
+
+// Set the value of FlagBit to BitVal based on the value computed by TestVal.
+// If the test corresponding to FlagBit is true, it is set, else it is cleared.
+// TestVal is the raised value of MI.
+bool X86RaisedValueTracker::computeEflagValue(unsigned int FlagBit,
+                                              const MachineInstr &MI,
+                                              Value *TestResultVal) {
+  ++NumEflagsMaterialized;
 
   int MBBNo = MI.getParent()->getNumber();
   MachineFunction &MF = X86MIRaiser->getMF();
@@ -532,7 +1046,7 @@ bool X86RaisedValueTracker::testAndSetEflagSSAValue(unsigned int FlagBit,
                      X86RegisterUtils::getEflagName(FlagBit));
 
     RaisedBB->getInstList().push_back(ZFTest);
-    PhysRegDefsInMBB[FlagBit][MBBNo].second = ZFTest;
+    PhysRegDefsInMBB.getOrCreateDef(FlagBit, MBBNo).second = ZFTest;
   } break;
   case X86RegisterUtils::EFLAGS::SF: {
     Value *ZeroVal = ConstantInt::get(Ctx, APInt(ResTyNumBits, 0));
@@ -554,7 +1068,7 @@ bool X86RaisedValueTracker::testAndSetEflagSSAValue(unsigned int FlagBit,
         new ICmpInst(CmpInst::Predicate::ICMP_NE, AndInst, ZeroVal,
                      X86RegisterUtils::getEflagName(FlagBit));
     RaisedBB->getInstList().push_back(SFTest);
-    PhysRegDefsInMBB[FlagBit][MBBNo].second = SFTest;
+    PhysRegDefsInMBB.getOrCreateDef(FlagBit, MBBNo).second = SFTest;
   } break;
   case X86RegisterUtils::EFLAGS::OF: {
     auto IntrinsicOF = Intrinsic::not_intrinsic;
@@ -590,7 +1104,7 @@ bool X86RaisedValueTracker::testAndSetEflagSSAValue(unsigned int FlagBit,
                                          ArrayRef<Value *>(TestArg));
       RaisedBB->getInstList().push_back(GetOF);
       // Extract OF and set it
-      PhysRegDefsInMBB[FlagBit][MBBNo].second =
+      PhysRegDefsInMBB.getOrCreateDef(FlagBit, MBBNo).second =
           ExtractValueInst::Create(GetOF, 1, "OF", RaisedBB);
     } else if (X86MIRaiser->instrNameStartsWith(MI, "ADD")) {
       IntrinsicOF = Intrinsic::sadd_with_overflow;
@@ -607,7 +1121,7 @@ bool X86RaisedValueTracker::testAndSetEflagSSAValue(unsigned int FlagBit,
                                          ArrayRef<Value *>(TestArg));
       RaisedBB->getInstList().push_back(GetOF);
       // Extract OF and set it
-      PhysRegDefsInMBB[FlagBit][MBBNo].second =
+      PhysRegDefsInMBB.getOrCreateDef(FlagBit, MBBNo).second =
           ExtractValueInst::Create(GetOF, 1, "OF", RaisedBB);
     } else if (X86MIRaiser->instrNameStartsWith(MI, "ROL")) {
       // OF flag is defined only for 1-bit rotates i.e., ROLr*1).
@@ -651,7 +1165,7 @@ bool X86RaisedValueTracker::testAndSetEflagSSAValue(unsigned int FlagBit,
         // Generate XOR ResultCF, MSBIsSet to compute OF
         Instruction *ResultOF =
             BinaryOperator::CreateXor(ResultCF, MSBIsSet, "OF", RaisedBB);
-        PhysRegDefsInMBB[FlagBit][MBBNo].second = ResultOF;
+        PhysRegDefsInMBB.getOrCreateDef(FlagBit, MBBNo).second = ResultOF;
       }
     } else if (X86MIRaiser->instrNameStartsWith(MI, "ROR")) {
       // OF flag is defined only for 1-bit rotates i.e., RORr*1).
@@ -701,11 +1215,11 @@ bool X86RaisedValueTracker::testAndSetEflagSSAValue(unsigned int FlagBit,
         // Generate XOR MSBIsSet, PreMSBIsSet to compute OF
         Instruction *ResultOF =
             BinaryOperator::CreateXor(MSBIsSet, PreMSBIsSet, "OF", RaisedBB);
-        PhysRegDefsInMBB[FlagBit][MBBNo].second = ResultOF;
+        PhysRegDefsInMBB.getOrCreateDef(FlagBit, MBBNo).second = ResultOF;
       }
     } else if (X86MIRaiser->instrNameStartsWith(MI, "TEST")) {
       // Set CF to 0 and make type to i1
-      PhysRegDefsInMBB[FlagBit][MBBNo].second =
+      PhysRegDefsInMBB.getOrCreateDef(FlagBit, MBBNo).second =
           ConstantInt::get(Type::getInt1Ty(Ctx), 0);
     } else {
       LLVM_DEBUG(MI.dump());
@@ -747,7 +1261,7 @@ bool X86RaisedValueTracker::testAndSetEflagSSAValue(unsigned int FlagBit,
     Instruction *PFTest = new ICmpInst(CmpInst::Predicate::ICMP_EQ,
                                        ParityEvenBit, ZeroValue, "PF");
     RaisedBB->getInstList().push_back(PFTest);
-    PhysRegDefsInMBB[FlagBit][MBBNo].second = PFTest;
+    PhysRegDefsInMBB.getOrCreateDef(FlagBit, MBBNo).second = PFTest;
   } break;
   case X86RegisterUtils::EFLAGS::CF: {
     Module *M = X86MIRaiser->getModuleRaiser()->getModule();
@@ -865,7 +1379,7 @@ bool X86RaisedValueTracker::testAndSetEflagSSAValue(unsigned int FlagBit,
 
       RaisedBB->getInstList().push_back(NewCFInst);
 
-      Value *OldCF = PhysRegDefsInMBB[FlagBit][MBBNo].second;
+      Value *OldCF = PhysRegDefsInMBB.getOrCreateDef(FlagBit, MBBNo).second;
       if (OldCF == nullptr) {
         // if CF is undefined, assume CF = 0
         LLVMContext &FuncCtx(MF.getFunction().getContext());
@@ -945,7 +1459,7 @@ bool X86RaisedValueTracker::testAndSetEflagSSAValue(unsigned int FlagBit,
 
       RaisedBB->getInstList().push_back(NewCFInst);
 
-      Value *OldCF = PhysRegDefsInMBB[FlagBit][MBBNo].second;
+      Value *OldCF = PhysRegDefsInMBB.getOrCreateDef(FlagBit, MBBNo).second;
       if (OldCF == nullptr) {
         // if CF is undefined, assume CF = 0
         LLVMContext &FuncCtx(MF.getFunction().getContext());
@@ -1019,10 +1533,10 @@ bool X86RaisedValueTracker::testAndSetEflagSSAValue(unsigned int FlagBit,
       RaisedBB->getInstList().push_back(GetOF);
       // Extract OF and set both OF and CF to the same value
       auto *NewOF = ExtractValueInst::Create(GetOF, 1, "OF", RaisedBB);
-      PhysRegDefsInMBB[EFLAGS::OF][MBBNo].second = NewOF;
+      PhysRegDefsInMBB.getOrCreateDef(EFLAGS::OF, MBBNo).second = NewOF;
       NewCF = NewOF;
       // Set OF to the same value of CF
-      PhysRegDefsInMBB[EFLAGS::OF][MBBNo].second = NewCF;
+      PhysRegDefsInMBB.getOrCreateDef(EFLAGS::OF, MBBNo).second = NewCF;
     } else if (X86MIRaiser->instrNameStartsWith(MI, "TEST")) {
       // Set CF to 0 and make type to i1
       NewCF = ConstantInt::get(Type::getInt1Ty(Ctx), 0);
@@ -1033,7 +1547,7 @@ bool X86RaisedValueTracker::testAndSetEflagSSAValue(unsigned int FlagBit,
     }
     // Update CF.
     assert((NewCF != nullptr) && "Value to update CF not found");
-    PhysRegDefsInMBB[FlagBit][MBBNo].second = NewCF;
+    PhysRegDefsInMBB.getOrCreateDef(FlagBit, MBBNo).second = NewCF;
   } break;
 
   // TODO: Add code to test for other flags
@@ -1041,7 +1555,7 @@ bool X86RaisedValueTracker::testAndSetEflagSSAValue(unsigned int FlagBit,
     assert(false && "Unhandled EFLAGS bit specified");
   }
   // EFLAGS bit size is 1
-  PhysRegDefsInMBB[FlagBit][MBBNo].first = 1;
+  PhysRegDefsInMBB.getOrCreateDef(FlagBit, MBBNo).first = 1;
   return true;
 }
 
@@ -1052,9 +1566,10 @@ bool X86RaisedValueTracker::setEflagValue(unsigned int FlagBit, int MBBNo,
          (FlagBit < X86RegisterUtils::EFLAGS::UNDEFINED) &&
          "Unknown EFLAGS bit specified");
   Val->setName(X86RegisterUtils::getEflagName(FlagBit));
-  PhysRegDefsInMBB[FlagBit][MBBNo].second = Val;
+  getEflagProducer(FlagBit, MBBNo) = EflagProducer();
+  PhysRegDefsInMBB.getOrCreateDef(FlagBit, MBBNo).second = Val;
   // EFLAGS bit size is 1
-  PhysRegDefsInMBB[FlagBit][MBBNo].first = 1;
+  PhysRegDefsInMBB.getOrCreateDef(FlagBit, MBBNo).first = 1;
   return true;
 }
 
@@ -1084,11 +1599,18 @@ Value *X86RaisedValueTracker::getEflagReachingDef(unsigned int FlagBit,
 Value *X86RaisedValueTracker::castValue(Value *SrcValue, Type *DstTy,
                                         BasicBlock *InsertBlock,
                                         bool SrcIsSigned) {
-  if (SrcValue->getType() != DstTy) {
-    // If SrcValue is signed, Dst is also signed
-    Instruction *CInst = CastInst::Create(
-        CastInst::getCastOpcode(SrcValue, SrcIsSigned, DstTy, SrcIsSigned),
-        SrcValue, DstTy);
+  if (SrcValue->getType() == DstTy)
+    return SrcValue;
+
+  // If SrcValue is signed, Dst is also signed
+  Instruction::CastOps CastOp =
+      CastInst::getCastOpcode(SrcValue, SrcIsSigned, DstTy, SrcIsSigned);
+  // Casts of global values and of values that abstract rodata addresses or
+  // content are distinct instructions annotated with rodata metadata.
+  Instruction *SrcInst = dyn_cast<Instruction>(SrcValue);
+  if (isa<GlobalValue>(SrcValue) || isa<ConstantExpr>(SrcValue) ||
+      ((SrcInst != nullptr) && hasRODataAccess(SrcInst))) {
+    Instruction *CInst = CastInst::Create(CastOp, SrcValue, DstTy);
     // Set RODataIndex metadata
     setInstMetadataRODataIndex(SrcValue, CInst);
     // Add the cast instruction RaisedBB.
@@ -1096,7 +1618,7 @@ Value *X86RaisedValueTracker::castValue(Value *SrcValue, Type *DstTy,
     return CInst;
   }
 
-  return SrcValue;
+  return createCast(CastOp, SrcValue, DstTy, InsertBlock);
 }
 
 // Reinterpret an SSE register value to another type
@@ -1109,15 +1631,6 @@ Value *
 X86RaisedValueTracker::reinterpretSSERegValue(Value *SrcVal, Type *DstTy,
                                               BasicBlock *InsertBlock,
                                               Instruction *InsertBefore) {
-#define INSERT_INSTRUCTION(Inst)                                               \
-  do {                                                                         \
-    if (InsertBefore != nullptr) {                                             \
-      Inst->insertBefore(InsertBefore);                                        \
-    } else {                                                                   \
-      InsertBlock->getInstList().push_back(Inst);                              \
-    }                                                                          \
-  } while (0)
-
   assert((InsertBlock != nullptr || InsertBefore != nullptr) &&
          "Expected either InsertBlock or InsertBefore to be not null");
 
@@ -1125,7 +1638,14 @@ X86RaisedValueTracker::reinterpretSSERegValue(Value *SrcVal, Type *DstTy,
     return SrcVal;
   }
 
-  Instruction *Result;
+  // Reinterpretations of constants and of other casts are folded as they are
+  // created.
+  if (InsertBefore != nullptr)
+    Builder.SetInsertPoint(InsertBefore);
+  else
+    Builder.SetInsertPoint(InsertBlock);
+
+  Value *Result;
   if (SrcVal->getType()->isVectorTy() && DstTy->isVectorTy() &&
       SrcVal->getType()->getPrimitiveSizeInBits() !=
           DstTy->getPrimitiveSizeInBits()) {
@@ -1133,13 +1653,11 @@ X86RaisedValueTracker::reinterpretSSERegValue(Value *SrcVal, Type *DstTy,
         DstTy->getContext(), SrcVal->getType()->getPrimitiveSizeInBits());
     Type *DstIntTy =
         Type::getIntNTy(DstTy->getContext(), DstTy->getPrimitiveSizeInBits());
-    auto *IntCastInst = new BitCastInst(SrcVal, SrcIntTy);
-    INSERT_INSTRUCTION(IntCastInst);
-    auto *CastInst = CastInst::Create(
-        CastInst::getCastOpcode(IntCastInst, false, DstIntTy, false),
-        IntCastInst, DstIntTy);
-    INSERT_INSTRUCTION(CastInst);
-    Result = new BitCastInst(CastInst, DstTy);
+    Value *IntVal = Builder.CreateBitCast(SrcVal, SrcIntTy);
+    Value *CastVal = Builder.CreateCast(
+        CastInst::getCastOpcode(IntVal, false, DstIntTy, false), IntVal,
+        DstIntTy);
+    Result = Builder.CreateBitCast(CastVal, DstTy);
   } else if (SrcVal->getType()->getPrimitiveSizeInBits() >
              DstTy->getPrimitiveSizeInBits()) {
     Type *SrcTyVec =
@@ -1147,11 +1665,10 @@ X86RaisedValueTracker::reinterpretSSERegValue(Value *SrcVal, Type *DstTy,
                         SrcVal->getType()->getPrimitiveSizeInBits() /
                             DstTy->getPrimitiveSizeInBits(),
                         false);
-    auto *SrcVec = new BitCastInst(SrcVal, SrcTyVec);
-    INSERT_INSTRUCTION(SrcVec);
+    Value *SrcVec = Builder.CreateBitCast(SrcVal, SrcTyVec);
 
     auto *Zero = ConstantInt::get(Type::getInt64Ty(DstTy->getContext()), 0);
-    Result = ExtractElementInst::Create(SrcVec, Zero);
+    Result = Builder.CreateExtractElement(SrcVec, Zero);
   } else if (SrcVal->getType()->getPrimitiveSizeInBits() <
              DstTy->getPrimitiveSizeInBits()) {
     Type *SrcTyVec =
@@ -1167,20 +1684,17 @@ X86RaisedValueTracker::reinterpretSSERegValue(Value *SrcVal, Type *DstTy,
     }
 
     auto *Zero = ConstantInt::get(Type::getInt64Ty(DstTy->getContext()), 0);
-    auto *InsertElem = InsertElementInst::Create(SrcVec, SrcVal, Zero);
-    INSERT_INSTRUCTION(InsertElem);
+    Value *InsertElem = Builder.CreateInsertElement(SrcVec, SrcVal, Zero);
 
-    Result = new BitCastInst(InsertElem, DstTy);
+    Result = Builder.CreateBitCast(InsertElem, DstTy);
   } else {
     // same width, just bitcast
-    Result = new BitCastInst(SrcVal, DstTy);
+    Result = Builder.CreateBitCast(SrcVal, DstTy);
   }
 
   assert(Result->getType() == DstTy);
 
-  INSERT_INSTRUCTION(Result);
   return Result;
-#undef INSERT_INSTRUCTION
 }
 
 Type *X86RaisedValueTracker::getSSEInstructionType(const MachineInstr &MI,
@@ -15,6 +15,14 @@
 #define LLVM_TOOLS_LLVM_MCTOLL_X86_X86RAISEDVALUETRACKER_H
 
 #include "X86MachineInstructionRaiser.h"
+#include "X86RegisterUtils.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Analysis/InstSimplifyFolder.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/ValueHandle.h"
+#include <array>
+#include <tuple>
 
 namespace llvm {
 namespace mctoll {
@@ -22,39 +30,104 @@ namespace mctoll {
 // This class encapsulates all the necessary bookkeeping and look up of SSA
 // values constructed while a MachineFunction is raised.
 
-// Begin - Type aliases of data structures used to facilitate promotion of
-// registers to stack slots.
-
 // DefRegSizeInBits, Value pair
 using DefRegSzValuePair = std::pair<uint8_t, Value *>;
 
-// Map of MBBNo -> DefRegSzValuePair
-using MBBNoToValueMap = std::map<unsigned int, DefRegSzValuePair>;
-
-// Map of physical registers -> MBBNoToValueMap.
-// Pictorially, this map looks as follows:
-//     { SuperReg1 -> { MBBNo_1 -> { <PhysReg_1_Sz, Val_A> },
-//                      MBBNo_2 -> { <PhysReg_2_Sz, Val_B> }
-//                      MBBNo_3 -> { <PhysReg_3_Sz, Val_C> } },
-//       SuperReg2 -> { MBBNo_4 -> { <PhysReg_4_Sz, Val_X> },
-//                      MBBNo_2 -> { <PhysReg_2_Sz, Val_Y> } },
+// Table of per-block register definitions. Each super-register defined in the
+// function has a lane of DefRegSzValuePair entries indexed by block number.
+// Pictorially, with lanes indexed by MBBNo, this table looks as follows:
+//     { SuperReg1 -> [ <PhysReg_0_Sz, Val_A>, <PhysReg_1_Sz, Val_B>, ... ],
+//       SuperReg2 -> [ -, <PhysReg_1_Sz, Val_Y>, -, ... ],
 //       ......
 //      }
-// Each entry of this map has the following semantics:
+// Each entry of this table has the following semantics:
 // SuperReg is defined in MBBNo using Val as a sub-register of size
 // PhysReg_Sz. E.g., SuperReg RAX may be actually defined as register of size 16
 // (i.e. AX).
-using PhysRegMBBValueDefMap = std::map<unsigned int, MBBNoToValueMap>;
+// Lanes of EFLAGS bits are allocated when the table is sized. Lanes of other
+// registers are allocated upon their first definition.
+class PhysRegDefTable {
+public:
+  // Size the table for a function with NumMBBs block numbers.
+  void init(unsigned NumMBBs);
+
+  // Return the entry of SuperReg in the block numbered MBBNo, recording that
+  // the block defines SuperReg.
+  DefRegSzValuePair &getOrCreateDef(unsigned int SuperReg, int MBBNo) {
+    Lane &L = getOrCreateLane(SuperReg);
+    assert((MBBNo >= 0) && ((unsigned)MBBNo < NumMBBs) &&
+           "Unexpected block number");
+    if (!L.DefMBBs.test(MBBNo)) {
+      L.DefMBBs.set(MBBNo);
+      L.NumDefMBBs++;
+    }
+    return L.Defs[MBBNo];
+  }
+
+  // Return the entry of SuperReg in the block numbered MBBNo, or nullptr if
+  // the block does not define SuperReg.
+  const DefRegSzValuePair *lookupDef(unsigned int SuperReg, int MBBNo) const {
+    const Lane *L = getLane(SuperReg);
+    if ((L == nullptr) || !L->DefMBBs.test(MBBNo))
+      return nullptr;
+    return &L->Defs[MBBNo];
+  }
+
+  // Return the number of blocks that define SuperReg.
+  unsigned getNumDefMBBs(unsigned int SuperReg) const {
+    const Lane *L = getLane(SuperReg);
+    return (L == nullptr) ? 0 : L->NumDefMBBs;
+  }
+
+  // Replace the value of all definitions defined as From with To.
+  void replaceDefValue(Value *From, Value *To);
+
+private:
+  struct Lane {
+    std::vector<DefRegSzValuePair> Defs;
+    // Blocks that define the register
+    BitVector DefMBBs;
+    unsigned NumDefMBBs = 0;
+  };
+
+  const Lane *getLane(unsigned int SuperReg) const {
+    if ((SuperReg >= LaneIndex.size()) || (LaneIndex[SuperReg] == 0))
+      return nullptr;
+    return &Lanes[LaneIndex[SuperReg] - 1];
+  }
+  Lane &getOrCreateLane(unsigned int SuperReg);
+
+  unsigned NumMBBs = 0;
+  // Map of SuperReg -> index of its lane in Lanes plus one, or 0 if SuperReg
+  // has no lane.
+  std::vector<unsigned> LaneIndex;
+  std::vector<Lane> Lanes;
+};
 
 class X86RaisedValueTracker {
 public:
   X86RaisedValueTracker() = delete;
   X86RaisedValueTracker(X86MachineInstructionRaiser *);
   bool setPhysRegSSAValue(unsigned int PhysReg, int MBBNo, Value *Val);
-  bool testAndSetEflagSSAValue(unsigned Flag, const MachineInstr &MI, Value *);
+  // Record that MI, raised as the value TestResultVal, sets Flag. The value of
+  // Flag is computed only when it is read, unless computing it requires the
+  // value of Flag before MI.
+  bool testAndSetEflagSSAValue(unsigned Flag, const MachineInstr &MI,
+                               Value *TestResultVal);
   bool setEflagBoolean(unsigned FlagBit, int MBBNo, bool Set);
   bool setEflagValue(unsigned FlagBit, int MBBNo, Value *);
 
+  // Return true if condition CC of an instruction that ends the block
+  // numbered MBBNo folds into a compare, i.e., if the EFLAGS bits tested by CC
+  // were all last set in the block by the same compare, subtract or test
+  // instruction.
+  bool isConditionFoldable(X86::CondCode CC, int MBBNo);
+  // Return the value of condition CC of an instruction that ends the block
+  // numbered MBBNo computed as a compare of the operands of the instruction
+  // that set the EFLAGS bits tested by CC, upon inserting it at the end of
+  // InsertBlock. Return nullptr if CC does not fold into a compare.
+  Value *foldCondition(X86::CondCode CC, int MBBNo, BasicBlock *InsertBlock);
+
   // Get the reaching definition of PhysReg. Perform any necessary stack
   // promotions. If AllPreds is true, perform the stack promotions only if
   // PhysReg is reachable along all predecessors of MBBNo or is defined in
@@ -72,7 +145,9 @@ public:
                                                    int MBBNo);
   unsigned getInBlockPhysRegSize(unsigned int PhysReg, int MBBNo);
   // Cast SrcVal to type DstTy, if the type of SrcVal is different from DstTy.
-  // Return the cast instruction upon inserting it at the end of InsertBlock
+  // Return the cast instruction upon inserting it at the end of InsertBlock.
+  // A cast of SrcVal to DstTy already inserted in InsertBlock is reused, and
+  // casts of constants and of other casts are folded.
   Value *castValue(Value *SrcVal, Type *DstTy, BasicBlock *InsertBlock,
                    bool SrcIsSigned = false);
 
@@ -103,13 +178,135 @@ public:
   bool setGVMetadataRODataInfo(GlobalVariable *, uint64_t RODataSecStart);
   Value *getRelocOffsetForRODataAddress(Value *SrcRODataAddr);
 
+  // Record that all instructions of the block numbered MBBNo, except
+  // branches, are raised. Used to construct PHI nodes when --ssa-phis is
+  // specified.
+  void setBlockRaised(int MBBNo);
+  // Add the incoming values of all PHI nodes constructed for reaching
+  // definitions and remove those that turn out to be trivial. Must be called
+  // after all branches are raised, as incoming values are added for the
+  // predecessors of the raised blocks.
+  bool completePHINodes();
+
   enum { INVALID_MBB = -1 };
 
 private:
+  // Blocks with definitions of a register that reach the end of a block,
+  // computed when the register was defined in NumDefMBBs blocks.
+  struct ReachingDefBlocks {
+    int NumDefMBBs = -1;
+    SmallVector<int, 4> DefMBBNos;
+  };
+
+  const SmallVectorImpl<int> &getReachingDefBlocks(unsigned int PhysReg,
+                                                   int MBBNo);
+
+  // The instruction that last set an EFLAGS bit in a block and the value it
+  // was raised as. The value of the bit is computed from them when it is
+  // first read.
+  struct EflagProducer {
+    const MachineInstr *MI = nullptr;
+    WeakTrackingVH TestResultVal;
+    // Set once the value of the bit is computed
+    bool Materialized = false;
+  };
+
+  // Number of EFLAGS bits tracked
+  static constexpr unsigned NumEflagBits =
+      X86RegisterUtils::EFLAGS::UNDEFINED - X86RegisterUtils::EFLAGS::CF;
+  // Return the instruction that last set FlagBit in the block numbered MBBNo.
+  // Its MI is nullptr if the computation of the value of FlagBit is not
+  // deferred.
+  EflagProducer &getEflagProducer(unsigned FlagBit, int MBBNo) {
+    return EflagProducers[MBBNo][FlagBit - X86RegisterUtils::EFLAGS::CF];
+  }
+  // Return true if the value of FlagBit set by MI is computed only when read.
+  bool isEflagComputationDeferred(unsigned FlagBit, const MachineInstr &MI);
+  // Compute the value of FlagBit set by MI from TestResultVal at the end of
+  // the block of MI and record it as the definition of FlagBit.
+  bool computeEflagValue(unsigned FlagBit, const MachineInstr &MI,
+                         Value *TestResultVal);
+  // Compute the value of FlagBit last set in the block numbered MBBNo, if it
+  // is yet to be computed. The value is inserted before the terminator of the
+  // block, if it has one.
+  void materializeEflag(unsigned FlagBit, int MBBNo);
+  // Return the predicate and set the operands of the compare that CC folds
+  // into in the block numbered MBBNo, or return BAD_ICMP_PREDICATE.
+  CmpInst::Predicate getFoldedPredicate(X86::CondCode CC, int MBBNo,
+                                        Value *&LHS, Value *&RHS);
+
+  // A PHI node constructed for the value of SuperReg at the entry of the block
+  // numbered MBBNo.
+  struct RegPHINode {
+    PHINode *Phi;
+    unsigned int SuperReg;
+    int MBBNo;
+  };
+
+  // Return the value of PhysReg reaching the entry (or the end) of the block
+  // numbered MBBNo, constructing PHI nodes as necessary. Return nullptr if the
+  // value is undefined.
+  Value *readRegAtBlockEntry(unsigned int PhysReg, int MBBNo);
+  Value *readRegAtBlockEnd(unsigned int PhysReg, int MBBNo);
+  // Return true if all predecessors of the block numbered MBBNo are raised.
+  bool isBlockSealed(int MBBNo);
+  // Return the type of the PHI nodes constructed for SuperReg.
+  Type *getPHIType(unsigned int SuperReg);
+  // Return Val cast to type Ty. The cast is inserted right after the
+  // definition of Val, so that it can be used wherever Val is available.
+  Value *castAfterDef(Value *Val, Type *Ty);
+  // Return SrcVal cast to DstTy using CastOp, or reinterpreted as DstTy if
+  // CastOp is ReinterpretSSECast, upon inserting it before InsertBefore or, if
+  // it is null, at the end of InsertBB. A cast of SrcVal to DstTy already
+  // inserted in InsertBB is reused, and casts of constants and of other casts
+  // are folded.
+  Value *createCast(unsigned CastOp, Value *SrcVal, Type *DstTy,
+                    BasicBlock *InsertBB, Instruction *InsertBefore = nullptr);
+  // Opcode of reinterpretations of SSE register values in CastValues
+  static constexpr unsigned ReinterpretSSECast = 0;
+  void addPHIIncomingValues(const RegPHINode &RegPhi);
+
   X86MachineInstructionRaiser *X86MIRaiser;
-  // Map of physical registers -> MBBNoToValueMap, representing per-block
-  // register definitions.
-  PhysRegMBBValueDefMap PhysRegDefsInMBB;
+  // Builder of the values folded upon creation
+  IRBuilder<InstSimplifyFolder> Builder;
+  // Map of <cast opcode, Value, Type, BasicBlock> -> cast of Value to Type
+  // inserted in BasicBlock
+  DenseMap<std::tuple<unsigned, Value *, Type *, BasicBlock *>,
+           WeakTrackingVH>
+      CastValues;
+  // Per-block register definitions
+  PhysRegDefTable PhysRegDefsInMBB;
+  // Map of <SuperReg, MBBNo> -> blocks with definitions of SuperReg that reach
+  // the end of the block numbered MBBNo
+  DenseMap<std::pair<unsigned int, int>, ReachingDefBlocks>
+      ReachingDefBlocksCache;
+  // Blocks visited while walking a reach tree
+  BitVector VisitedMBBs;
+  // Per-block instructions that last set each EFLAGS bit in the block
+  std::vector<std::array<EflagProducer, NumEflagBits>> EflagProducers;
+
+  // Begin - Data structures used to construct PHI nodes.
+
+  // Blocks reachable from the entry block, i.e., the blocks that are raised.
+  BitVector ReachableMBBs;
+  // Blocks all of whose non-branch instructions are raised.
+  BitVector RaisedMBBs;
+  // Map of raised BasicBlock -> MBBNo
+  DenseMap<BasicBlock *, int> BBToMBBNoMap;
+  // Map of <SuperReg, MBBNo> -> value of SuperReg at the entry of the block
+  // numbered MBBNo, for blocks that do not define SuperReg before its use.
+  // Values are tracked as PHI nodes may be replaced.
+  std::map<std::pair<unsigned int, int>, WeakTrackingVH> RegEntryValues;
+  // PHI nodes whose incoming values are yet to be added
+  SmallVector<RegPHINode, 16> IncompletePHIs;
+  // All PHI nodes constructed
+  std::vector<WeakVH> RegPHIs;
+  // Set once incoming values of PHI nodes can be added, i.e., when all blocks
+  // and branches are raised.
+  bool PHINodesSealed = false;
+  bool CompletingPHINodes = false;
+
+  // End - Data structures used to construct PHI nodes.
 };
 
 
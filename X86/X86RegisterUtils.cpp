@@ -86,6 +86,37 @@ string X86RegisterUtils::getEflagName(unsigned EFBit) {
   return "";
 }
 
+vector<EFLAGBit> X86RegisterUtils::getCondEflagBits(X86::CondCode CC) {
+  switch (CC) {
+  case X86::COND_O:
+  case X86::COND_NO:
+    return {EFLAGS::OF};
+  case X86::COND_B:
+  case X86::COND_AE:
+    return {EFLAGS::CF};
+  case X86::COND_E:
+  case X86::COND_NE:
+    return {EFLAGS::ZF};
+  case X86::COND_BE:
+  case X86::COND_A:
+    return {EFLAGS::CF, EFLAGS::ZF};
+  case X86::COND_S:
+  case X86::COND_NS:
+    return {EFLAGS::SF};
+  case X86::COND_P:
+  case X86::COND_NP:
+    return {EFLAGS::PF};
+  case X86::COND_L:
+  case X86::COND_GE:
+    return {EFLAGS::SF, EFLAGS::OF};
+  case X86::COND_LE:
+  case X86::COND_G:
+    return {EFLAGS::ZF, EFLAGS::SF, EFLAGS::OF};
+  default:
+    return EFlagBits;
+  }
+}
+
 bool X86RegisterUtils::is32BitSSE2Reg(unsigned int PReg) {
   return X86MCRegisterClasses[X86::FR32RegClassID].contains(PReg);
 }
@@ -60,6 +60,9 @@ extern const vector<EFLAGBit> EFlagBits;
 bool isEflagBit(unsigned RegNo);
 int getEflagBitIndex(unsigned EFBit);
 string getEflagName(unsigned EFBit);
+// Return the EFLAGS bits tested by condition code CC, or all bits if CC is
+// not known.
+vector<EFLAGBit> getCondEflagBits(X86::CondCode CC);
 bool is64BitPhysReg(unsigned int PReg);
 bool is32BitPhysReg(unsigned int PReg);
 bool is16BitPhysReg(unsigned int PReg);
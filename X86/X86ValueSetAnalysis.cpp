@@ -12,6 +12,20 @@
 //===----------------------------------------------------------------------===//
 
 #include "X86ValueSetAnalysis.h"
+#include "Raiser/ModuleRaiser.h"
+#include "X86RegisterUtils.h"
+#include "X86ValueSetAnalysisTracer.h"
+#include "llvm-mctoll.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/CodeGen/TargetInstrInfo.h"
+#include "llvm/CodeGen/TargetSubtargetInfo.h"
+#include "llvm/Support/MathExtras.h"
+#include <X86InstrBuilder.h>
+#include <X86Subtarget.h>
+#include <chrono>
+#include <map>
+#include <numeric>
+#include <queue>
 
 #define DEBUG_TYPE "mctoll"
 
@@ -21,8 +35,14 @@ using namespace llvm::mctoll;
 X86ValueSetAnalysis::X86ValueSetAnalysis(
     X86MachineInstructionRaiser *MIRaiser)
     : X86MIRaiser(MIRaiser) {
-
-  fprintf(stderr, "Created VSA for func: %s\n", MIRaiser->getMF().getName().data());
+  StringRef FuncName = MIRaiser->getMF().getName();
+  LLVM_DEBUG(dbgs() << "Created VSA for func: " << FuncName << "\n");
+  Tracer = X86ValueSetAnalysisTracer::getForFunction(FuncName);
+  if (Tracer != nullptr) {
+    const ModuleRaiser *MR = MIRaiser->getModuleRaiser();
+    Tracer->traceFunction(FuncName, MIRaiser->getMCInstRaiser()->getFuncStart() +
+                                        MR->getTextSectionAddress());
+  }
 }
 
 void X86ValueSetAnalysis::assignZeroRic(AlocType dest) {
@@ -35,10 +55,8 @@ void X86ValueSetAnalysis::assignZeroRic(AlocType dest) {
 
 bool X86ValueSetAnalysis::tryInsertValue(AlocType dest, int64_t value) {
   if (alocToVSMap.find(dest) != alocToVSMap.end()) {
-    printf("Not inserted\n");
     return false;
   }
-  printf("Inserted\n");
   alocToVSMap[dest] = new ValueSet;
   RgnRICPair p;
   p.first = 0;
@@ -260,3 +278,888 @@ void X86ValueSetAnalysis::dump() {
     fprintf(stderr, "\n");
   }
 }
+
+void X86ValueSetAnalysis::traceMachineInstr(const MachineInstr &MI,
+                                            StringRef Event,
+                                            bool IncludeValueSets) {
+  // Instructions not corresponding to an instruction of the binary have no
+  // address and are not traced.
+  const MCInstRaiser *MCIR = X86MIRaiser->getMCInstRaiser();
+  if (!MCIR->hasMCInstIndex(MI))
+    return;
+  const ModuleRaiser *MR = X86MIRaiser->getModuleRaiser();
+  uint64_t Addr = MCIR->getMCInstIndex(MI) + MR->getTextSectionAddress();
+  if (!Tracer->shouldTraceAddress(Addr))
+    return;
+
+  const TargetInstrInfo *TII = MI.getMF()->getSubtarget().getInstrInfo();
+  Tracer->traceInstruction(Event, X86MIRaiser->getMF().getName(), Addr,
+                           TII->getName(MI.getOpcode()),
+                           IncludeValueSets ? &alocToVSMap : nullptr,
+                           MR->getMCRegisterInfo());
+}
+
+// Helpers on value sets used by the fixpoint iteration. Value sets computed by
+// the fixpoint iteration hold at most one RIC per memory region.
+
+static ValueSet makeConstantVS(int64_t Value,
+                               MemRgnType Rgn = GlobalRegion) {
+  return ValueSet{RgnRICPair(Rgn, ReducedIntervalCongruence(1, 0, 0, Value))};
+}
+
+static ValueSet makeRangeVS(int64_t Min, int64_t Max) {
+  return ValueSet{RgnRICPair(
+      GlobalRegion, ReducedIntervalCongruence(1, 0, Max - Min, Min))};
+}
+
+// Return true if VS holds a single value, and set Rgn and Value to its region
+// and value.
+static bool getSingleValue(const ValueSet &VS, MemRgnType &Rgn,
+                           int64_t &Value) {
+  if (VS.size() != 1)
+    return false;
+  const RgnRICPair &P = *VS.begin();
+  if (!P.second.isSingleton() || !P.second.getMinValue(Value))
+    return false;
+  Rgn = P.first;
+  return true;
+}
+
+// Return true if all values of VS are absolute values in [Min, Max].
+static bool isWithinRange(const ValueSet &VS, int64_t Min, int64_t Max) {
+  if (VS.empty())
+    return false;
+  for (const RgnRICPair &P : VS) {
+    int64_t Lo, Hi;
+    if (P.first != GlobalRegion || !P.second.getMinValue(Lo) ||
+        !P.second.getMaxValue(Hi) || Lo < Min || Hi > Max)
+      return false;
+  }
+  return true;
+}
+
+static ValueSet joinValueSets(const ValueSet &Left, const ValueSet &Right) {
+  std::map<MemRgnType, ReducedIntervalCongruence> Joined;
+  for (const ValueSet *VS : {&Left, &Right}) {
+    for (const RgnRICPair &P : *VS) {
+      auto Res = Joined.emplace(P.first, P.second);
+      if (!Res.second) {
+        ReducedIntervalCongruence RIC = P.second;
+        Res.first->second.unionRIC(RIC);
+      }
+    }
+  }
+  return ValueSet(Joined.begin(), Joined.end());
+}
+
+// Widen Old with New, a superset of Old.
+static ValueSet widenValueSets(const ValueSet &Old, const ValueSet &New) {
+  std::map<MemRgnType, ReducedIntervalCongruence> Widened(New.begin(),
+                                                          New.end());
+  for (const RgnRICPair &P : Old) {
+    auto Iter = Widened.find(P.first);
+    if (Iter == Widened.end())
+      continue;
+    ReducedIntervalCongruence RIC = P.second;
+    RIC.widenRIC(Iter->second);
+    Iter->second = RIC;
+  }
+  return ValueSet(Widened.begin(), Widened.end());
+}
+
+// Compute the RIC of the sums of the values of A and B. Return false if the
+// result is not representable.
+static bool addRICs(const ReducedIntervalCongruence &A,
+                    const ReducedIntervalCongruence &B,
+                    ReducedIntervalCongruence &Sum) {
+  if (A.isSingleton() || B.isSingleton()) {
+    const ReducedIntervalCongruence &Single = A.isSingleton() ? A : B;
+    int64_t Value;
+    if (!Single.getMinValue(Value))
+      return false;
+    Sum = A.isSingleton() ? B : A;
+    int64_t Offset;
+    if (AddOverflow(Sum.getOffset(), Value, Offset))
+      return false;
+    Sum.setOffset(Offset);
+    return true;
+  }
+
+  // Neither is a singleton. The sum is computed as the union of the RICs
+  // formed by the sum of the bounds.
+  int64_t MinA, MinB, MaxA, MaxB, Min, Max;
+  bool HasMin = A.getMinValue(MinA) && B.getMinValue(MinB) &&
+                !AddOverflow(MinA, MinB, Min);
+  bool HasMax = A.getMaxValue(MaxA) && B.getMaxValue(MaxB) &&
+                !AddOverflow(MaxA, MaxB, Max);
+  int64_t Base;
+  if (AddOverflow(A.getOffset(), B.getOffset(), Base))
+    return false;
+  uint64_t Alignment = std::gcd(A.getAlignment(), B.getAlignment());
+  if (Alignment == 0)
+    return false;
+  if (!HasMin) {
+    Sum = ReducedIntervalCongruence(Alignment, 0, 0, Base, BoundState::NEG_INF,
+                                    BoundState::INF);
+    if (HasMax)
+      Sum.meetInterval(std::numeric_limits<int64_t>::min(), Max);
+    return true;
+  }
+  Sum = ReducedIntervalCongruence(Alignment, 0, 0, Min, BoundState::SET,
+                                  BoundState::INF);
+  if (HasMax)
+    Sum.meetInterval(Min, Max);
+  return true;
+}
+
+// Compute the value set of the sums of the values of Left and Right. Return
+// false if the result is unknown.
+static bool addValueSets(const ValueSet &Left, const ValueSet &Right,
+                         ValueSet &Sum) {
+  ValueSet Result;
+  for (const RgnRICPair &L : Left) {
+    for (const RgnRICPair &R : Right) {
+      // Addresses of different regions can not be added.
+      if (L.first != GlobalRegion && R.first != GlobalRegion)
+        return false;
+      ReducedIntervalCongruence RIC;
+      if (!addRICs(L.second, R.second, RIC))
+        return false;
+      MemRgnType Rgn = L.first != GlobalRegion ? L.first : R.first;
+      Result = joinValueSets(Result, ValueSet{RgnRICPair(Rgn, RIC)});
+    }
+  }
+  if (Result.empty())
+    return false;
+  Sum = std::move(Result);
+  return true;
+}
+
+// Scale the absolute values of VS by Scale. Return false if the result is
+// unknown.
+static bool scaleValueSet(ValueSet &VS, int64_t Scale) {
+  if (Scale <= 0)
+    return false;
+  ValueSet Result;
+  for (const RgnRICPair &P : VS) {
+    if (P.first != GlobalRegion)
+      return false;
+    const ReducedIntervalCongruence &RIC = P.second;
+    int64_t Alignment, Offset;
+    if (RIC.getAlignment() >
+            static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) ||
+        MulOverflow(static_cast<int64_t>(RIC.getAlignment()), Scale,
+                    Alignment) ||
+        MulOverflow(RIC.getOffset(), Scale, Offset))
+      return false;
+    Result.emplace(P.first, ReducedIntervalCongruence(
+                                Alignment, RIC.getIndexLowerBound(),
+                                RIC.getIndexUpperBound(), Offset,
+                                RIC.getLowerBoundState(),
+                                RIC.getUpperBoundState()));
+  }
+  VS = std::move(Result);
+  return true;
+}
+
+static bool addConstant(ValueSet &VS, int64_t Value) {
+  return addValueSets(ValueSet(VS), makeConstantVS(Value), VS);
+}
+
+// Join the value sets of Src into Dst, widening them if Widen is true.
+// Return true if Dst changed.
+static bool mergeStates(AlocToVSState &Dst, const AlocToVSState &Src,
+                        bool Widen) {
+  bool Changed = false;
+  for (auto Iter = Dst.begin(); Iter != Dst.end();) {
+    auto SrcIter = Src.find(Iter->first);
+    if (SrcIter == Src.end()) {
+      Iter = Dst.erase(Iter);
+      Changed = true;
+      continue;
+    }
+    ValueSet Joined = joinValueSets(Iter->second, SrcIter->second);
+    if (Widen)
+      Joined = widenValueSets(Iter->second, Joined);
+    if (Joined != Iter->second) {
+      Iter->second = std::move(Joined);
+      Changed = true;
+    }
+    ++Iter;
+  }
+  return Changed;
+}
+
+ValueSet *X86ValueSetAnalysis::unionVS(ValueSet *left, ValueSet *right) {
+  return new ValueSet(joinValueSets(*left, *right));
+}
+
+ValueSet *X86ValueSetAnalysis::widenVS(ValueSet *left, ValueSet *right) {
+  return new ValueSet(widenValueSets(*left, joinValueSets(*left, *right)));
+}
+
+bool X86ValueSetAnalysis::readReg(const AlocToVSState &State, unsigned Reg,
+                                  ValueSet &VS) {
+  if (!X86RegisterUtils::is64BitPhysReg(Reg) &&
+      !X86RegisterUtils::is32BitPhysReg(Reg))
+    return false;
+  auto Iter = State.find(AlocType(X86MIRaiser->find64BitSuperReg(Reg)));
+  if (Iter == State.end())
+    return false;
+  if (X86RegisterUtils::is64BitPhysReg(Reg)) {
+    VS = Iter->second;
+    return true;
+  }
+
+  // 32-bit register
+  MemRgnType Rgn;
+  int64_t Value;
+  if (getSingleValue(Iter->second, Rgn, Value) && Rgn == GlobalRegion) {
+    VS = makeConstantVS(static_cast<uint32_t>(Value));
+    return true;
+  }
+  if (isWithinRange(Iter->second, 0, std::numeric_limits<uint32_t>::max())) {
+    VS = Iter->second;
+    return true;
+  }
+  return false;
+}
+
+void X86ValueSetAnalysis::writeReg(AlocToVSState &State, unsigned Reg,
+                                   const ValueSet *VS) {
+  if (!X86RegisterUtils::isGPReg(Reg))
+    return;
+  AlocType Aloc(X86MIRaiser->find64BitSuperReg(Reg));
+  if (X86RegisterUtils::is64BitPhysReg(Reg)) {
+    if (VS != nullptr)
+      State[Aloc] = *VS;
+    else
+      State.erase(Aloc);
+    return;
+  }
+  if (X86RegisterUtils::is32BitPhysReg(Reg)) {
+    // Writes to 32-bit registers zero-extend the value to 64 bits.
+    MemRgnType Rgn;
+    int64_t Value;
+    if (VS != nullptr && getSingleValue(*VS, Rgn, Value) &&
+        Rgn == GlobalRegion)
+      State[Aloc] = makeConstantVS(static_cast<uint32_t>(Value));
+    else if (VS != nullptr &&
+             isWithinRange(*VS, 0, std::numeric_limits<uint32_t>::max()))
+      State[Aloc] = *VS;
+    else
+      State[Aloc] = makeRangeVS(0, std::numeric_limits<uint32_t>::max());
+    return;
+  }
+  // Writes to 8-bit and 16-bit registers preserve the other bits.
+  State.erase(Aloc);
+}
+
+bool X86ValueSetAnalysis::getMemAddress(const MachineInstr &MI,
+                                        const AlocToVSState &State,
+                                        ValueSet &Addr) {
+  const MCInstrDesc &Desc = MI.getDesc();
+  int MemOpIdx = X86II::getMemoryOperandNo(Desc.TSFlags);
+  if (MemOpIdx < 0)
+    return false;
+  MemOpIdx += X86II::getOperandBias(Desc);
+  const MachineOperand &BaseOp = MI.getOperand(MemOpIdx + X86::AddrBaseReg);
+  const MachineOperand &SegOp = MI.getOperand(MemOpIdx + X86::AddrSegmentReg);
+  if (!BaseOp.isReg() || (SegOp.isReg() && SegOp.getReg() != X86::NoRegister))
+    return false;
+  X86AddressMode AM = getAddressFromInstr(&MI, MemOpIdx);
+  if (AM.GV != nullptr)
+    return false;
+
+  ValueSet Result = makeConstantVS(AM.Disp);
+  if (AM.Base.Reg == X86::RIP) {
+    // PC-relative address
+    const MCInstRaiser *MCIR = X86MIRaiser->getMCInstRaiser();
+    if (!MCIR->hasMCInstIndex(MI))
+      return false;
+    uint64_t Offset = MCIR->getMCInstIndex(MI);
+    int64_t NextInstAddr = Offset + MCIR->getMCInstSize(Offset) +
+                           X86MIRaiser->getModuleRaiser()->getTextSectionAddress();
+    if (!addConstant(Result, NextInstAddr))
+      return false;
+  } else if (AM.Base.Reg != X86::NoRegister) {
+    ValueSet BaseVS;
+    if (!readReg(State, AM.Base.Reg, BaseVS) ||
+        !addValueSets(BaseVS, ValueSet(Result), Result))
+      return false;
+  }
+  if (AM.IndexReg != X86::NoRegister) {
+    ValueSet IndexVS;
+    if (!readReg(State, AM.IndexReg, IndexVS) ||
+        !scaleValueSet(IndexVS, AM.Scale) ||
+        !addValueSets(IndexVS, ValueSet(Result), Result))
+      return false;
+  }
+  Addr = std::move(Result);
+  return true;
+}
+
+// Return the a-loc at address Addr, or false if Addr is not a single address.
+static bool getMemAloc(const ValueSet &Addr, AlocType &Aloc) {
+  MemRgnType Rgn;
+  int64_t Value;
+  if (!getSingleValue(Addr, Rgn, Value))
+    return false;
+  Aloc = AlocType(Rgn == StackRegion ? AlocType::LocalMemLocTy
+                                     : AlocType::GlobalMemLocTy,
+                  static_cast<uint64_t>(Value));
+  return true;
+}
+
+void X86ValueSetAnalysis::storeMem(AlocToVSState &State, const ValueSet *Addr,
+                                   unsigned Size, const ValueSet *VS) {
+  AlocType Aloc;
+  bool HasAloc = Addr != nullptr && getMemAloc(*Addr, Aloc);
+  bool StackOnly = Addr != nullptr && !Addr->empty() &&
+                   all_of(*Addr, [](const RgnRICPair &P) {
+                     return P.first == StackRegion;
+                   });
+  bool GlobalOnly = Addr != nullptr && !Addr->empty() &&
+                    all_of(*Addr, [](const RgnRICPair &P) {
+                      return P.first == GlobalRegion;
+                    });
+
+  // Kill all memory a-locs that may be overwritten. Memory a-locs hold
+  // 8-byte values.
+  for (auto Iter = State.begin(); Iter != State.end();) {
+    const AlocType &A = Iter->first;
+    bool Kill = false;
+    if (A.isLocalMemLocType() || A.isGlobalMemLocType()) {
+      if (HasAloc) {
+        int64_t Start = static_cast<int64_t>(Aloc.getGlobalAddress());
+        int64_t Cur = static_cast<int64_t>(A.getGlobalAddress());
+        Kill = A.getAlocTypeID() == Aloc.getAlocTypeID() && Cur > Start - 8 &&
+               Cur < Start + static_cast<int64_t>(Size);
+      } else if (StackOnly) {
+        Kill = A.isLocalMemLocType();
+      } else if (GlobalOnly) {
+        Kill = A.isGlobalMemLocType();
+      } else {
+        Kill = true;
+      }
+    }
+    if (Kill)
+      Iter = State.erase(Iter);
+    else
+      ++Iter;
+  }
+
+  if (HasAloc && Size == 8 && VS != nullptr)
+    State[Aloc] = *VS;
+}
+
+bool X86ValueSetAnalysis::loadMem(const AlocToVSState &State,
+                                  const ValueSet &Addr, unsigned Size,
+                                  ValueSet &VS) {
+  AlocType Aloc;
+  if (!getMemAloc(Addr, Aloc))
+    return false;
+  auto Iter = State.find(Aloc);
+  if (Iter == State.end())
+    return false;
+  if (Size == 8) {
+    VS = Iter->second;
+    return true;
+  }
+  // Narrower loads of a known value read its low order bytes.
+  MemRgnType Rgn;
+  int64_t Value;
+  if (Size == 4 && getSingleValue(Iter->second, Rgn, Value) &&
+      Rgn == GlobalRegion) {
+    VS = makeConstantVS(static_cast<uint32_t>(Value));
+    return true;
+  }
+  return false;
+}
+
+void X86ValueSetAnalysis::transferInstr(const MachineInstr &MI,
+                                        AlocToVSState &State) {
+  ValueSet VS, Addr;
+  unsigned Opcode = MI.getOpcode();
+  switch (Opcode) {
+  case X86::MOV64ri:
+  case X86::MOV64ri32:
+  case X86::MOV32ri:
+    VS = makeConstantVS(MI.getOperand(1).getImm());
+    writeReg(State, MI.getOperand(0).getReg(), &VS);
+    return;
+  case X86::MOV64rr:
+  case X86::MOV32rr:
+    writeReg(State, MI.getOperand(0).getReg(),
+             readReg(State, MI.getOperand(1).getReg(), VS) ? &VS : nullptr);
+    return;
+  case X86::LEA64r:
+  case X86::LEA64_32r:
+  case X86::LEA32r:
+    writeReg(State, MI.getOperand(0).getReg(),
+             getMemAddress(MI, State, VS) ? &VS : nullptr);
+    return;
+  case X86::ADD64ri8:
+  case X86::ADD64ri32:
+  case X86::ADD32ri:
+  case X86::ADD32ri8:
+  case X86::SUB64ri8:
+  case X86::SUB64ri32:
+  case X86::SUB32ri:
+  case X86::SUB32ri8: {
+    bool IsSub = (Opcode == X86::SUB64ri8 || Opcode == X86::SUB64ri32 ||
+                  Opcode == X86::SUB32ri || Opcode == X86::SUB32ri8);
+    int64_t Imm = MI.getOperand(2).getImm();
+    bool Known = readReg(State, MI.getOperand(1).getReg(), VS) &&
+                 Imm != std::numeric_limits<int64_t>::min() &&
+                 addConstant(VS, IsSub ? -Imm : Imm);
+    writeReg(State, MI.getOperand(0).getReg(), Known ? &VS : nullptr);
+    return;
+  }
+  case X86::INC64r:
+  case X86::INC32r:
+  case X86::DEC64r:
+  case X86::DEC32r: {
+    bool IsInc = (Opcode == X86::INC64r || Opcode == X86::INC32r);
+    bool Known = readReg(State, MI.getOperand(1).getReg(), VS) &&
+                 addConstant(VS, IsInc ? 1 : -1);
+    writeReg(State, MI.getOperand(0).getReg(), Known ? &VS : nullptr);
+    return;
+  }
+  case X86::ADD64rr:
+  case X86::ADD32rr: {
+    ValueSet Src2VS;
+    bool Known = readReg(State, MI.getOperand(1).getReg(), VS) &&
+                 readReg(State, MI.getOperand(2).getReg(), Src2VS) &&
+                 addValueSets(ValueSet(VS), Src2VS, VS);
+    writeReg(State, MI.getOperand(0).getReg(), Known ? &VS : nullptr);
+    return;
+  }
+  case X86::XOR64rr:
+  case X86::XOR32rr:
+  case X86::SUB64rr:
+  case X86::SUB32rr:
+    if (MI.getOperand(1).getReg() == MI.getOperand(2).getReg()) {
+      VS = makeConstantVS(0);
+      writeReg(State, MI.getOperand(0).getReg(), &VS);
+      return;
+    }
+    break;
+  case X86::AND64ri8:
+  case X86::AND64ri32:
+  case X86::AND32ri:
+  case X86::AND32ri8: {
+    // The result of masking with a non-negative value is at most that value.
+    int64_t Imm = MI.getOperand(2).getImm();
+    if (Opcode == X86::AND32ri || Opcode == X86::AND32ri8)
+      Imm = static_cast<uint32_t>(Imm);
+    if (Imm < 0)
+      break;
+    VS = makeRangeVS(0, Imm);
+    writeReg(State, MI.getOperand(0).getReg(), &VS);
+    return;
+  }
+  case X86::SHL64ri:
+  case X86::SHL32ri: {
+    int64_t Shift = MI.getOperand(2).getImm();
+    bool Known = Shift >= 0 && Shift < 32 &&
+                 readReg(State, MI.getOperand(1).getReg(), VS) &&
+                 scaleValueSet(VS, int64_t(1) << Shift);
+    writeReg(State, MI.getOperand(0).getReg(), Known ? &VS : nullptr);
+    return;
+  }
+  case X86::MOVZX32rr8:
+  case X86::MOVZX32rm8:
+    VS = makeRangeVS(0, std::numeric_limits<uint8_t>::max());
+    writeReg(State, MI.getOperand(0).getReg(), &VS);
+    return;
+  case X86::MOVZX32rr16:
+  case X86::MOVZX32rm16:
+    VS = makeRangeVS(0, std::numeric_limits<uint16_t>::max());
+    writeReg(State, MI.getOperand(0).getReg(), &VS);
+    return;
+  case X86::PUSH64r:
+  case X86::PUSH64i8:
+  case X86::PUSH64i32: {
+    bool Known = true;
+    if (Opcode == X86::PUSH64r)
+      Known = readReg(State, MI.getOperand(0).getReg(), VS);
+    else
+      VS = makeConstantVS(MI.getOperand(0).getImm());
+    ValueSet SP;
+    if (!readReg(State, X86::RSP, SP) || !addConstant(SP, -8)) {
+      State.erase(AlocType(X86::RSP));
+      storeMem(State, nullptr, 8, nullptr);
+      return;
+    }
+    writeReg(State, X86::RSP, &SP);
+    storeMem(State, &SP, 8, Known ? &VS : nullptr);
+    return;
+  }
+  case X86::POP64r: {
+    ValueSet SP;
+    if (!readReg(State, X86::RSP, SP)) {
+      writeReg(State, MI.getOperand(0).getReg(), nullptr);
+      return;
+    }
+    bool Known = loadMem(State, SP, 8, VS);
+    bool SPKnown = addConstant(SP, 8);
+    writeReg(State, X86::RSP, SPKnown ? &SP : nullptr);
+    writeReg(State, MI.getOperand(0).getReg(), Known ? &VS : nullptr);
+    return;
+  }
+  case X86::LEAVE64: {
+    // RSP = RBP + 8; RBP = [RBP]
+    ValueSet FP;
+    if (!readReg(State, X86::RBP, FP)) {
+      writeReg(State, X86::RSP, nullptr);
+      writeReg(State, X86::RBP, nullptr);
+      return;
+    }
+    bool Known = loadMem(State, FP, 8, VS);
+    bool SPKnown = addConstant(FP, 8);
+    writeReg(State, X86::RSP, SPKnown ? &FP : nullptr);
+    writeReg(State, X86::RBP, Known ? &VS : nullptr);
+    return;
+  }
+  case X86::MOV64mr:
+  case X86::MOV32mr:
+  case X86::MOV64mi32:
+  case X86::MOV32mi: {
+    unsigned Size = (Opcode == X86::MOV64mr || Opcode == X86::MOV64mi32) ? 8 : 4;
+    const MachineOperand &SrcOp = MI.getOperand(X86::AddrNumOperands);
+    bool Known = true;
+    if (SrcOp.isReg())
+      Known = readReg(State, SrcOp.getReg(), VS);
+    else
+      VS = makeConstantVS(SrcOp.getImm());
+    bool HasAddr = getMemAddress(MI, State, Addr);
+    storeMem(State, HasAddr ? &Addr : nullptr, Size, Known ? &VS : nullptr);
+    return;
+  }
+  case X86::MOV64rm:
+  case X86::MOV32rm: {
+    unsigned Size = (Opcode == X86::MOV64rm) ? 8 : 4;
+    bool Known =
+        getMemAddress(MI, State, Addr) && loadMem(State, Addr, Size, VS);
+    writeReg(State, MI.getOperand(0).getReg(), Known ? &VS : nullptr);
+    return;
+  }
+  default:
+    break;
+  }
+
+  if (MI.isCall()) {
+    // Caller-saved registers and memory may be modified by the callee. The
+    // callee pops the return address pushed by the call.
+    for (unsigned Reg : {X86::RAX, X86::RCX, X86::RDX, X86::RSI, X86::RDI,
+                         X86::R8, X86::R9, X86::R10, X86::R11})
+      State.erase(AlocType(Reg));
+    storeMem(State, nullptr, 8, nullptr);
+    return;
+  }
+
+  // Conservatively assume that all registers defined by any other
+  // instruction, and any memory it writes to, have unknown values.
+  if (MI.mayStore()) {
+    // Vector stores write up to 64 bytes.
+    bool HasAddr = getMemAddress(MI, State, Addr);
+    storeMem(State, HasAddr ? &Addr : nullptr, 64, nullptr);
+  }
+  for (const MachineOperand &MO : MI.operands())
+    if (MO.isReg() && MO.isDef() && MO.getReg() != X86::NoRegister)
+      writeReg(State, MO.getReg(), nullptr);
+}
+
+// Return the condition code and the branch target offset of the conditional
+// branch MI.
+static X86::CondCode getBranchCondition(const MachineInstr &MI) {
+  switch (MI.getOpcode()) {
+  case X86::JCC_1:
+  case X86::JCC_2:
+  case X86::JCC_4:
+    return static_cast<X86::CondCode>(
+        MI.getOperand(MI.getDesc().getNumOperands() - 1).getImm());
+  default:
+    return X86::COND_INVALID;
+  }
+}
+
+// Return the range [Min, Max] of values of the compared register for which
+// condition CC holds for a compare with Imm. Return false if no range applies.
+static bool getConditionRange(X86::CondCode CC, int64_t Imm, bool Is32Bit,
+                              int64_t &Min, int64_t &Max) {
+  const int64_t MinValue = std::numeric_limits<int64_t>::min();
+  const int64_t MaxValue = std::numeric_limits<int64_t>::max();
+  // Unsigned compares of 32-bit values are modeled only when the values are
+  // known to be in [0, UINT32_MAX], the range of zero-extended values.
+  // Signed compares of 32-bit values are modeled only when the values are in
+  // [0, INT32_MAX].
+  int64_t UMax = Is32Bit ? std::numeric_limits<uint32_t>::max() : MaxValue;
+  int64_t UImm = Is32Bit ? static_cast<uint32_t>(Imm) : Imm;
+  switch (CC) {
+  case X86::COND_E:
+    Min = Max = Is32Bit ? UImm : Imm;
+    return true;
+  case X86::COND_B:
+    if (UImm <= 0)
+      return false;
+    Min = 0;
+    Max = UImm - 1;
+    return true;
+  case X86::COND_BE:
+    if (UImm < 0)
+      return false;
+    Min = 0;
+    Max = UImm;
+    return true;
+  case X86::COND_A:
+    if (UImm < 0 || UImm == UMax || !Is32Bit)
+      return false;
+    Min = UImm + 1;
+    Max = UMax;
+    return true;
+  case X86::COND_AE:
+    if (UImm < 0 || !Is32Bit)
+      return false;
+    Min = UImm;
+    Max = UMax;
+    return true;
+  case X86::COND_L:
+    if (Imm == MinValue)
+      return false;
+    Min = MinValue;
+    Max = Imm - 1;
+    return true;
+  case X86::COND_LE:
+    Min = MinValue;
+    Max = Imm;
+    return true;
+  case X86::COND_G:
+    if (Imm == MaxValue)
+      return false;
+    Min = Imm + 1;
+    Max = MaxValue;
+    return true;
+  case X86::COND_GE:
+    Min = Imm;
+    Max = MaxValue;
+    return true;
+  default:
+    return false;
+  }
+}
+
+void X86ValueSetAnalysis::refineOnEdges(
+    const MachineBasicBlock &MBB, const AlocToVSState &Out,
+    SmallVectorImpl<AlocToVSState> &SuccStates) {
+  SuccStates.assign(MBB.succ_size(), Out);
+
+  // Find the conditional branch of MBB and the compare of a register with an
+  // immediate that sets the flags it tests.
+  auto Term = MBB.getFirstTerminator();
+  if (Term == MBB.end() || MBB.succ_size() != 2)
+    return;
+  X86::CondCode CC = getBranchCondition(*Term);
+  if (CC == X86::COND_INVALID)
+    return;
+  const MachineInstr *Cmp = nullptr;
+  for (auto Iter = Term.getReverse(); Iter != MBB.rend(); ++Iter) {
+    if (Iter->definesRegister(X86::EFLAGS)) {
+      Cmp = &*Iter;
+      break;
+    }
+  }
+  if (Cmp == nullptr)
+    return;
+  unsigned CmpOpc = Cmp->getOpcode();
+  bool Is32Bit = (CmpOpc == X86::CMP32ri || CmpOpc == X86::CMP32ri8);
+  if (!Is32Bit && CmpOpc != X86::CMP64ri8 && CmpOpc != X86::CMP64ri32)
+    return;
+  unsigned Reg = Cmp->getOperand(0).getReg();
+  unsigned SuperReg = X86MIRaiser->find64BitSuperReg(Reg);
+  // The register should not be modified between the compare and the branch.
+  for (auto Iter = std::next(MachineBasicBlock::const_iterator(Cmp));
+       Iter != Term; ++Iter)
+    if (Iter->modifiesRegister(SuperReg, X86MIRaiser->getRegisterInfo()))
+      return;
+  int64_t Imm = Cmp->getOperand(1).getImm();
+
+  // Find the taken successor.
+  const MCInstRaiser *MCIR = X86MIRaiser->getMCInstRaiser();
+  if (!MCIR->hasMCInstIndex(*Term) || !Term->getOperand(0).isImm())
+    return;
+  uint64_t BranchOffset = MCIR->getMCInstIndex(*Term);
+  int64_t TargetOffset = BranchOffset + MCIR->getMCInstSize(BranchOffset) +
+                         Term->getOperand(0).getImm();
+  int64_t TakenMBBNo = MCIR->getMBBNumberOfMCInstOffset(
+      TargetOffset, *const_cast<MachineFunction *>(MBB.getParent()));
+  if (TakenMBBNo == -1 || (*MBB.succ_begin())->getNumber() ==
+                              (*std::next(MBB.succ_begin()))->getNumber())
+    return;
+
+  AlocType Aloc(SuperReg);
+  auto OutIter = Out.find(Aloc);
+  unsigned SuccIdx = 0;
+  for (const MachineBasicBlock *Succ : MBB.successors()) {
+    AlocToVSState &SuccState = SuccStates[SuccIdx++];
+    X86::CondCode EdgeCC = Succ->getNumber() == TakenMBBNo
+                               ? CC
+                               : X86::GetOppositeBranchCondition(CC);
+    int64_t Min, Max;
+    if (!getConditionRange(EdgeCC, Imm, Is32Bit, Min, Max))
+      continue;
+    bool Signed = EdgeCC == X86::COND_L || EdgeCC == X86::COND_LE ||
+                  EdgeCC == X86::COND_G || EdgeCC == X86::COND_GE;
+    if (OutIter == Out.end()) {
+      // The value of a 32-bit register may be any 32-bit value. An unknown
+      // 64-bit value is refined to the range, if the range is bounded.
+      if (Is32Bit || Min == std::numeric_limits<int64_t>::min() ||
+          Max == std::numeric_limits<int64_t>::max())
+        continue;
+      SuccState[Aloc] = makeRangeVS(Min, Max);
+      continue;
+    }
+    const ValueSet &Current = OutIter->second;
+    if (Is32Bit && !isWithinRange(Current, 0,
+                                  Signed ? std::numeric_limits<int32_t>::max()
+                                         : std::numeric_limits<uint32_t>::max()))
+      continue;
+    if (Current.size() != 1)
+      continue;
+    ReducedIntervalCongruence RIC = Current.begin()->second;
+    if (Current.begin()->first == GlobalRegion && RIC.meetInterval(Min, Max))
+      SuccState[Aloc] = ValueSet{RgnRICPair(GlobalRegion, RIC)};
+  }
+}
+
+bool X86ValueSetAnalysis::solve() {
+  auto StartTime = std::chrono::steady_clock::now();
+  MachineFunction &MF = X86MIRaiser->getMF();
+  unsigned NumBlocks = MF.getNumBlockIDs();
+  BlockEntryStates.assign(NumBlocks, AlocToVSState());
+  HasBlockEntryState.clear();
+  HasBlockEntryState.resize(NumBlocks);
+  if (MF.empty())
+    return true;
+
+  // Number the blocks in reverse post-order. A block is a loop head if it is
+  // the target of a retreating edge.
+  ReversePostOrderTraversal<MachineFunction *> RPOT(&MF);
+  std::vector<unsigned> RPONumber(NumBlocks, NumBlocks);
+  std::vector<MachineBasicBlock *> RPOBlocks;
+  for (MachineBasicBlock *MBB : RPOT) {
+    RPONumber[MBB->getNumber()] = RPOBlocks.size();
+    RPOBlocks.push_back(MBB);
+  }
+  BitVector IsLoopHead(NumBlocks);
+  for (MachineBasicBlock *MBB : RPOBlocks)
+    for (MachineBasicBlock *Pred : MBB->predecessors())
+      if (RPONumber[Pred->getNumber()] >= RPONumber[MBB->getNumber()])
+        IsLoopHead.set(MBB->getNumber());
+
+  // Blocks are visited in the order of their reverse post-order numbers, so
+  // that the state of a block is computed after those of its forward
+  // predecessors. A block is queued only when its entry state changes.
+  std::priority_queue<unsigned, std::vector<unsigned>, std::greater<unsigned>>
+      Worklist;
+  BitVector InWorklist(RPOBlocks.size());
+  auto Enqueue = [&](unsigned RPONo) {
+    if (!InWorklist.test(RPONo)) {
+      InWorklist.set(RPONo);
+      Worklist.push(RPONo);
+    }
+  };
+
+  // The stack pointer at function entry is the base of the stack region.
+  MachineBasicBlock *Entry = RPOBlocks.front();
+  BlockEntryStates[Entry->getNumber()][AlocType(X86::RSP)] =
+      makeConstantVS(0, StackRegion);
+  HasBlockEntryState.set(Entry->getNumber());
+  Enqueue(0);
+
+  uint64_t Budget = uint64_t(VSAMaxBlockVisits) * RPOBlocks.size();
+  uint64_t Visits = 0;
+  SmallVector<AlocToVSState, 2> SuccStates;
+  while (!Worklist.empty() && Visits < Budget) {
+    unsigned RPONo = Worklist.top();
+    Worklist.pop();
+    InWorklist.reset(RPONo);
+    ++Visits;
+
+    MachineBasicBlock *MBB = RPOBlocks[RPONo];
+    AlocToVSState State = BlockEntryStates[MBB->getNumber()];
+    for (const MachineInstr &MI : *MBB)
+      transferInstr(MI, State);
+
+    refineOnEdges(*MBB, State, SuccStates);
+    unsigned SuccIdx = 0;
+    for (MachineBasicBlock *Succ : MBB->successors()) {
+      AlocToVSState &SuccState = SuccStates[SuccIdx++];
+      unsigned SuccNo = Succ->getNumber();
+      bool Changed;
+      if (!HasBlockEntryState.test(SuccNo)) {
+        BlockEntryStates[SuccNo] = std::move(SuccState);
+        HasBlockEntryState.set(SuccNo);
+        Changed = true;
+      } else {
+        Changed = mergeStates(BlockEntryStates[SuccNo], SuccState,
+                              IsLoopHead.test(SuccNo));
+      }
+      if (Changed)
+        Enqueue(RPONumber[SuccNo]);
+    }
+  }
+
+  bool Converged = Worklist.empty();
+  if (!Converged) {
+    // Value sets of the blocks not yet stable are not safe to use.
+    LLVM_DEBUG(dbgs() << "VSA of " << MF.getName()
+                      << " did not converge in " << Visits << " visits\n");
+    BlockEntryStates.clear();
+    HasBlockEntryState.reset();
+  }
+  if (Tracer != nullptr) {
+    auto Elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - StartTime);
+    Tracer->traceFixpoint(MF.getName(), RPOBlocks.size(), Visits, Converged,
+                          Elapsed.count());
+  }
+  return Converged;
+}
+
+void X86ValueSetAnalysis::enterBlock(const MachineBasicBlock &MBB) {
+  const AlocToVSState *State = getBlockEntryState(MBB.getNumber());
+  HasCurrentState = (State != nullptr);
+  if (State == nullptr)
+    return;
+  CurrentState = *State;
+  // The value sets of the online analysis are replaced, not modified in
+  // place. So, they may refer to the value sets of the computed state.
+  alocToVSMap.clear();
+  for (const auto &Entry : *State)
+    alocToVSMap[Entry.first] = const_cast<ValueSet *>(&Entry.second);
+}
+
+const AlocToVSState *
+X86ValueSetAnalysis::getBlockEntryState(unsigned MBBNo) const {
+  if (MBBNo >= HasBlockEntryState.size() || !HasBlockEntryState.test(MBBNo))
+    return nullptr;
+  return &BlockEntryStates[MBBNo];
+}
+
+bool X86ValueSetAnalysis::getMemAccessRegion(const MachineInstr &MI,
+                                             MemRgnType &Rgn) {
+  if (!HasCurrentState || !(MI.mayLoad() || MI.mayStore()))
+    return false;
+  ValueSet Addr;
+  if (!getMemAddress(MI, CurrentState, Addr) || Addr.empty())
+    return false;
+  Rgn = Addr.begin()->first;
+  return all_of(Addr, [Rgn](const RgnRICPair &P) { return P.first == Rgn; });
+}
+
+void X86ValueSetAnalysis::stepInstruction(const MachineInstr &MI) {
+  if (HasCurrentState)
+    transferInstr(MI, CurrentState);
+}
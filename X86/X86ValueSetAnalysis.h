@@ -17,6 +17,8 @@
 #include "X86MachineInstructionRaiser.h"
 #include "ReducedIntervalCongruence.h"
 #include "AlocType.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/MC/MCRegisterInfo.h"
 
 namespace llvm {
@@ -25,6 +27,31 @@ namespace mctoll {
 using MemRgnType = uint32_t;
 
 using RgnRICPair = std::pair<MemRgnType, ReducedIntervalCongruence>;
+
+} // end namespace mctoll
+} // end namespace llvm
+
+namespace std {
+  template<>
+  struct hash<llvm::mctoll::RgnRICPair>
+  {
+    size_t operator()(const llvm::mctoll::RgnRICPair& rrp) const noexcept
+    {
+      llvm::mctoll::ReducedIntervalCongruence ric = rrp.second;
+      size_t h1 = ric.getAlignment() << 3;
+      size_t h2 = ric.getIndexLowerBound() << 2;
+      size_t h3 = ric.getIndexUpperBound() << 1;
+      size_t h4 = ric.getOffset();
+      size_t h5 = (size_t)ric.getLowerBoundState() << 4;
+      size_t h6 = (size_t)ric.getUpperBoundState() << 5;
+      return h1 ^ h2 ^ h3 ^ h4 ^ h5 ^ h6 ^ (rrp.first << 7);
+    }
+  };
+} // end namespace std
+
+namespace llvm {
+namespace mctoll {
+
 using ValueSet = std::unordered_set<RgnRICPair>;
 
 // map key : a-loc
@@ -32,6 +59,20 @@ using ValueSet = std::unordered_set<RgnRICPair>;
 // value - (map(value set, RgnRICPair))
 using AlocToVSMap = std::unordered_map<AlocType, ValueSet *>;
 
+// Memory regions of the values in value sets
+enum : MemRgnType {
+  // Absolute values and addresses
+  GlobalRegion = 0,
+  // Addresses relative to the value of stack pointer at function entry
+  StackRegion = 1
+};
+
+// Value sets of a-locs at a program point, as computed by the fixpoint
+// iteration. Values of a-locs that are not in the map are unknown.
+using AlocToVSState = std::unordered_map<AlocType, ValueSet>;
+
+class X86ValueSetAnalysisTracer;
+
 using FPSetsPair = std::pair<std::unordered_set<AlocType>, std::unordered_set<AlocType>>;
 
 class X86ValueSetAnalysis {
@@ -63,32 +104,76 @@ public:
   ValueSet *removeUpperBounds(ValueSet *vs);
 
   void dump();
+
+  /// Compute the value sets at the entry of each reachable basic block of the
+  /// function by abstract interpretation of its MachineFunction. Blocks are
+  /// visited from a worklist in reverse post-order and value sets are widened
+  /// at loop heads. Return true if the iteration converged within the budget
+  /// set by --vsa-max-block-visits. No block entry value sets are available
+  /// otherwise.
+  bool solve();
+  /// Reset the value sets to those computed by solve() for the entry of MBB.
+  void enterBlock(const MachineBasicBlock &MBB);
+  /// Return the value sets computed by solve() for the entry of the basic
+  /// block numbered MBBNo, or nullptr if none are available.
+  const AlocToVSState *getBlockEntryState(unsigned MBBNo) const;
+  /// Return true if the memory accessed by MI, the next instruction to be
+  /// raised in the block entered last, is known to lie in a single memory
+  /// region, and set Rgn to that region.
+  bool getMemAccessRegion(const MachineInstr &MI, MemRgnType &Rgn);
+  /// Advance the value sets used by getMemAccessRegion() past MI.
+  void stepInstruction(const MachineInstr &MI);
+
+  /// Record the value sets after raising MI in the trace, if tracing of MI is
+  /// requested.
+  void traceInstruction(const MachineInstr &MI) {
+    if (Tracer != nullptr)
+      traceMachineInstr(MI, "instruction", true);
+  }
+  /// Record that the value sets are not updated for the raised MI in the
+  /// trace, if tracing of MI is requested.
+  void traceUnhandled(const MachineInstr &MI) {
+    if (Tracer != nullptr)
+      traceMachineInstr(MI, "unhandled", false);
+  }
+
 private:
+  void traceMachineInstr(const MachineInstr &MI, StringRef Event,
+                         bool IncludeValueSets);
+
+  // Abstract transfer functions used by solve()
+  void transferInstr(const MachineInstr &MI, AlocToVSState &State);
+  void refineOnEdges(const MachineBasicBlock &MBB, const AlocToVSState &Out,
+                     SmallVectorImpl<AlocToVSState> &SuccStates);
+  bool readReg(const AlocToVSState &State, unsigned Reg, ValueSet &VS);
+  void writeReg(AlocToVSState &State, unsigned Reg, const ValueSet *VS);
+  bool getMemAddress(const MachineInstr &MI, const AlocToVSState &State,
+                     ValueSet &Addr);
+  void storeMem(AlocToVSState &State, const ValueSet *Addr, unsigned Size,
+                const ValueSet *VS);
+  bool loadMem(const AlocToVSState &State, const ValueSet &Addr, unsigned Size,
+               ValueSet &VS);
+
   X86MachineInstructionRaiser *X86MIRaiser;
+  // Tracer of this analysis, or nullptr if tracing is disabled
+  X86ValueSetAnalysisTracer *Tracer;
 
   AlocToVSMap alocToVSMap;  
+
+  // BlockEntryStates[N] holds the value sets at the entry of the basic block
+  // numbered N, if HasBlockEntryState[N] is set.
+  std::vector<AlocToVSState> BlockEntryStates;
+  BitVector HasBlockEntryState;
+
+  // Value sets before the next instruction to be raised in the block entered
+  // last, if HasCurrentState is set.
+  AlocToVSState CurrentState;
+  bool HasCurrentState = false;
 };
 
 
 } // end namespace mctoll
 } // end namespace llvm
 
-namespace std {
-  template<>
-  struct hash<llvm::mctoll::RgnRICPair>
-  {
-    size_t operator()(const llvm::mctoll::RgnRICPair& rrp) const noexcept
-    {
-      llvm::mctoll::ReducedIntervalCongruence ric = rrp.second;
-      size_t h1 = ric.getAlignment() << 3;
-      size_t h2 = ric.getIndexLowerBound() << 2;
-      size_t h3 = ric.getIndexUpperBound() << 1;
-      size_t h4 = ric.getOffset();
-      size_t h5 = (size_t)ric.getLowerBoundState() << 4;
-      size_t h6 = (size_t)ric.getUpperBoundState() << 5;
-      return h1 ^ h2 ^ h3 ^ h4 ^ h5 ^ h6 ^ (rrp.first << 7);
-    }
-  };
-  } // end namespace std
 
 #endif // LLVM_TOOLS_LLVM_MCTOLL_X86_X86VALUESETANALYSIS_H
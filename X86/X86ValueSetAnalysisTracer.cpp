@@ -0,0 +1,209 @@
+//===-- X86ValueSetAnalysisTracer.cpp ---------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the implementation of X86ValueSetAnalysisTracer class
+// for use by llvm-mctoll.
+//
+//===----------------------------------------------------------------------===//
+
+#include "X86ValueSetAnalysisTracer.h"
+#include "Raiser/ModuleRaiser.h"
+#include "llvm-mctoll.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include <algorithm>
+#include <tuple>
+
+#define DEBUG_TYPE "mctoll"
+
+using namespace llvm;
+using namespace llvm::mctoll;
+
+X86ValueSetAnalysisTracer::X86ValueSetAnalysisTracer(
+    std::unique_ptr<raw_fd_ostream> Out)
+    : OS(std::move(Out)), AddressRanges(VSATraceAddressRanges) {
+  for (const std::string &FuncName : VSATraceFunctions)
+    Functions.insert(FuncName);
+}
+
+X86ValueSetAnalysisTracer *
+X86ValueSetAnalysisTracer::getForFunction(StringRef FuncName) {
+  // The trace file is opened on first use and closed on exit.
+  static std::unique_ptr<X86ValueSetAnalysisTracer> Tracer =
+      []() -> std::unique_ptr<X86ValueSetAnalysisTracer> {
+    if (VSATraceFile.empty())
+      return nullptr;
+    std::error_code EC;
+    auto Out = std::make_unique<raw_fd_ostream>(VSATraceFile, EC,
+                                                sys::fs::OF_Text);
+    if (EC)
+      reportError(VSATraceFile, EC.message());
+    return std::unique_ptr<X86ValueSetAnalysisTracer>(
+        new X86ValueSetAnalysisTracer(std::move(Out)));
+  }();
+
+  if (Tracer == nullptr)
+    return nullptr;
+  if (!Tracer->Functions.empty() && !Tracer->Functions.contains(FuncName))
+    return nullptr;
+  return Tracer.get();
+}
+
+bool X86ValueSetAnalysisTracer::shouldTraceAddress(uint64_t Addr) const {
+  if (AddressRanges.empty())
+    return true;
+  return any_of(AddressRanges, [Addr](const std::pair<uint64_t, uint64_t> &R) {
+    return Addr >= R.first && Addr < R.second;
+  });
+}
+
+void X86ValueSetAnalysisTracer::writeRecord(
+    function_ref<void(json::OStream &)> Writer) {
+  // Format the record before acquiring the lock.
+  SmallString<256> Record;
+  raw_svector_ostream RecordOS(Record);
+  {
+    json::OStream J(RecordOS);
+    J.object([&] { Writer(J); });
+  }
+  Record.push_back('\n');
+
+  std::lock_guard<std::mutex> Lock(OSMutex);
+  *OS << Record;
+}
+
+void X86ValueSetAnalysisTracer::traceFunction(StringRef FuncName,
+                                              uint64_t Addr) {
+  writeRecord([&](json::OStream &J) {
+    J.attribute("event", "function");
+    J.attribute("function", FuncName);
+    J.attribute("address", Addr);
+  });
+  // Flush the records of the previous function, so that they are available
+  // even if raising of this function fails.
+  std::lock_guard<std::mutex> Lock(OSMutex);
+  OS->flush();
+}
+
+void X86ValueSetAnalysisTracer::traceFixpoint(StringRef FuncName,
+                                              uint64_t NumBlocks,
+                                              uint64_t Visits, bool Converged,
+                                              int64_t TimeUs) {
+  writeRecord([&](json::OStream &J) {
+    J.attribute("event", "fixpoint");
+    J.attribute("function", FuncName);
+    J.attribute("blocks", NumBlocks);
+    J.attribute("visits", Visits);
+    J.attribute("converged", Converged);
+    J.attribute("time_us", TimeUs);
+  });
+}
+
+static void writeBound(json::OStream &J, StringRef Name, BoundState State,
+                       int64_t Bound) {
+  switch (State) {
+  case BoundState::SET:
+    J.attribute(Name, Bound);
+    break;
+  case BoundState::NEG_INF:
+    J.attribute(Name, "-inf");
+    break;
+  case BoundState::INF:
+    J.attribute(Name, "inf");
+    break;
+  case BoundState::UNSURE:
+    J.attribute(Name, "unknown");
+    break;
+  }
+}
+
+static auto getRICKey(const RgnRICPair &P) {
+  const ReducedIntervalCongruence &RIC = P.second;
+  return std::make_tuple(P.first, RIC.getAlignment(), RIC.getLowerBoundState(),
+                         RIC.getIndexLowerBound(), RIC.getUpperBoundState(),
+                         RIC.getIndexUpperBound(), RIC.getOffset());
+}
+
+static void writeValueSet(json::OStream &J, const ValueSet &VS) {
+  // Value sets are unordered. Sort the elements to keep the trace stable.
+  std::vector<const RgnRICPair *> Elements;
+  for (const RgnRICPair &P : VS)
+    Elements.push_back(&P);
+  llvm::sort(Elements, [](const RgnRICPair *A, const RgnRICPair *B) {
+    return getRICKey(*A) < getRICKey(*B);
+  });
+
+  J.attributeArray("vs", [&] {
+    for (const RgnRICPair *P : Elements) {
+      const ReducedIntervalCongruence &RIC = P->second;
+      J.object([&] {
+        J.attribute("region", P->first);
+        J.attribute("alignment", RIC.getAlignment());
+        writeBound(J, "lower", RIC.getLowerBoundState(),
+                   RIC.getIndexLowerBound());
+        writeBound(J, "upper", RIC.getUpperBoundState(),
+                   RIC.getIndexUpperBound());
+        J.attribute("offset", RIC.getOffset());
+      });
+    }
+  });
+}
+
+void X86ValueSetAnalysisTracer::traceInstruction(StringRef Event,
+                                                 StringRef FuncName,
+                                                 uint64_t Addr,
+                                                 StringRef Opcode,
+                                                 const AlocToVSMap *VSMap,
+                                                 const MCRegisterInfo *MRI) {
+  writeRecord([&](json::OStream &J) {
+    J.attribute("event", Event);
+    J.attribute("function", FuncName);
+    J.attribute("address", Addr);
+    J.attribute("opcode", Opcode);
+    if (VSMap == nullptr)
+      return;
+
+    // A-locs are unordered. Sort them by type and register number or address
+    // to keep the trace stable.
+    std::vector<std::pair<AlocType, const ValueSet *>> Alocs;
+    for (const auto &Entry : *VSMap)
+      if (Entry.second != nullptr)
+        Alocs.emplace_back(Entry.first, Entry.second);
+    llvm::sort(Alocs, [](const std::pair<AlocType, const ValueSet *> &A,
+                         const std::pair<AlocType, const ValueSet *> &B) {
+      const AlocType &L = A.first, &R = B.first;
+      if (L.getAlocTypeID() != R.getAlocTypeID())
+        return L.getAlocTypeID() < R.getAlocTypeID();
+      if (L.isRegisterType())
+        return L.getRegister() < R.getRegister();
+      return L.getGlobalAddress() < R.getGlobalAddress();
+    });
+
+    J.attributeArray("alocs", [&] {
+      for (const auto &Aloc : Alocs) {
+        J.object([&] {
+          const AlocType &A = Aloc.first;
+          if (A.isRegisterType()) {
+            J.attribute("kind", "register");
+            J.attribute("register", MRI->getName(A.getRegister()));
+          } else if (A.isLocalMemLocType()) {
+            // Local a-locs are identified by their signed stack offset.
+            J.attribute("kind", "local");
+            J.attribute("offset", static_cast<int64_t>(A.getLocalAddress()));
+          } else {
+            J.attribute("kind", "global");
+            J.attribute("address", A.getGlobalAddress());
+          }
+          writeValueSet(J, *Aloc.second);
+        });
+      }
+    });
+  });
+}
+
+#undef DEBUG_TYPE
@@ -0,0 +1,88 @@
+//===-- X86ValueSetAnalysisTracer.h -----------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the declaration of X86ValueSetAnalysisTracer class that
+// writes the trace of value set analysis requested using --vsa-trace.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_LLVM_MCTOLL_X86_X86VALUESETANALYSISTRACER_H
+#define LLVM_TOOLS_LLVM_MCTOLL_X86_X86VALUESETANALYSISTRACER_H
+
+#include "X86ValueSetAnalysis.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/MC/MCRegisterInfo.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace llvm {
+namespace mctoll {
+
+/// Writer of the value set analysis trace. Tracing is disabled unless a trace
+/// file is specified using --vsa-trace. The trace is a sequence of JSON
+/// objects, one per line, each with an "event" member that is one of
+///   "function"    - value set analysis of a function started.
+///   "instruction" - value sets of all a-locs after raising an instruction.
+///   "unhandled"   - value sets are not updated for a raised instruction.
+///   "fixpoint"    - fixpoint iteration of the value set analysis of a
+///                   function completed.
+/// Records are emitted only for the functions specified using
+/// --vsa-trace-function and instructions at the addresses specified using
+/// --vsa-trace-address, if any.
+class X86ValueSetAnalysisTracer {
+public:
+  X86ValueSetAnalysisTracer(const X86ValueSetAnalysisTracer &) = delete;
+  X86ValueSetAnalysisTracer &
+  operator=(const X86ValueSetAnalysisTracer &) = delete;
+
+  /// Return the tracer if the value set analysis of function FuncName is to be
+  /// traced. Return nullptr, otherwise.
+  static X86ValueSetAnalysisTracer *getForFunction(StringRef FuncName);
+
+  /// Return true if the instruction at address Addr is to be traced.
+  bool shouldTraceAddress(uint64_t Addr) const;
+
+  /// Record the start of the analysis of function FuncName at address Addr.
+  void traceFunction(StringRef FuncName, uint64_t Addr);
+
+  /// Record Event for the instruction with opcode name Opcode at address Addr
+  /// of function FuncName. The value sets in VSMap are included in the record,
+  /// if VSMap is not nullptr. Register names are obtained from MRI.
+  void traceInstruction(StringRef Event, StringRef FuncName, uint64_t Addr,
+                        StringRef Opcode, const AlocToVSMap *VSMap,
+                        const MCRegisterInfo *MRI);
+
+  /// Record the completion of the fixpoint iteration of function FuncName
+  /// with NumBlocks reachable basic blocks, after Visits block visits taking
+  /// TimeUs microseconds. Converged is false if the iteration budget was
+  /// exhausted.
+  void traceFixpoint(StringRef FuncName, uint64_t NumBlocks, uint64_t Visits,
+                     bool Converged, int64_t TimeUs);
+
+private:
+  explicit X86ValueSetAnalysisTracer(std::unique_ptr<raw_fd_ostream> Out);
+
+  /// Write the record created by Writer as a line of the trace.
+  void writeRecord(function_ref<void(json::OStream &)> Writer);
+
+  std::unique_ptr<raw_fd_ostream> OS;
+  // Serializes writes to OS
+  std::mutex OSMutex;
+  // Functions to trace. All functions are traced if empty.
+  StringSet<> Functions;
+  // Half-open address ranges to trace. All addresses are traced if empty.
+  std::vector<std::pair<uint64_t, uint64_t>> AddressRanges;
+};
+
+} // end namespace mctoll
+} // end namespace llvm
+
+#endif // LLVM_TOOLS_LLVM_MCTOLL_X86_X86VALUESETANALYSISTRACER_H
@@ -12,14 +12,19 @@
 
 #include "llvm-mctoll.h"
 #include "EmitRaisedOutputPass.h"
+#include "OptimizationPipelinePass.h"
 #include "PeepholeOptimizationPass.h"
 #include "Raiser/IncludedFileInfo.h"
 #include "Raiser/MCInstOrData.h"
 #include "Raiser/MachineFunctionRaiser.h"
 #include "Raiser/ModuleRaiser.h"
+#include "Raiser/RaiserStatistics.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/Bitcode/BitcodeWriterPass.h"
@@ -61,6 +66,7 @@
 #include "llvm/Option/Option.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/CrashRecoveryContext.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/FileSystem.h"
@@ -68,19 +74,27 @@
 #include "llvm/Support/GraphWriter.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/LineIterator.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/WithColor.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <cstring>
 #include <fstream>
+#include <mutex>
 #include <set>
 #include <system_error>
 #include <unordered_map>
@@ -150,6 +164,9 @@ enum OutputFormatTy { OF_LL, OF_BC, OF_Null, OF_Unknown };
 
 #define DEBUG_TYPE "mctoll"
 
+STATISTIC(NumInstsDecoded, "Number of instructions decoded");
+STATISTIC(NumDecodeFailures, "Number of instructions that failed to decode");
+
 static std::vector<std::string> InputFileNames;
 static std::string OutputFilename;
 std::string MCPU;
@@ -174,6 +191,55 @@ static bool HasStopAddressFlag;
 std::vector<std::string> mctoll::IncludeFileNames;
 std::string mctoll::CompilationDBDir;
 
+/// Directory of the cache files of prototypes parsed from include files
+std::string mctoll::PrototypeCacheDir;
+
+/// Number of threads to use for decoding, building control flow graphs and
+/// raising inputs. 0 means use all hardware threads.
+unsigned mctoll::NumJobs = 1;
+
+/// Construct PHI nodes, instead of stack slots, for register values with more
+/// than one reaching definition.
+bool mctoll::SSAWithPHIs;
+
+/// Layout of the stack of raised functions, either a single stack frame or
+/// separate stack slots.
+StackLayoutKind mctoll::StackLayout = StackLayoutKind::Slots;
+
+/// Pipeline of new pass manager passes run on the raised module before it is
+/// emitted. No passes are run if it is empty.
+static std::string PassPipeline;
+
+/// Value set analysis trace file and the functions and address ranges to
+/// trace. Tracing is disabled if the trace file name is empty.
+std::string mctoll::VSATraceFile;
+std::vector<std::string> mctoll::VSATraceFunctions;
+std::vector<std::pair<uint64_t, uint64_t>> mctoll::VSATraceAddressRanges;
+
+/// Budget of the value set analysis fixpoint iteration of a function, in
+/// visits per basic block.
+unsigned mctoll::VSAMaxBlockVisits = 32;
+
+/// Print the time spent in each phase of raising.
+bool mctoll::TimePhases;
+
+/// File to write the phase times and statistics to, as JSON. Nothing is
+/// written if the file name is empty.
+std::string mctoll::StatsJSONFile;
+
+/// Budgets of raising a function, in milliseconds, machine instructions and
+/// raised IR instructions. A budget of 0 is unlimited.
+unsigned mctoll::MaxFunctionTime;
+unsigned mctoll::MaxFunctionInstrs;
+unsigned mctoll::MaxFunctionIRInstrs;
+
+/// Raise each function in a recovery context and emit a declaration for a
+/// function that fails to raise.
+bool mctoll::IsolateFailures;
+
+/// Print a line to stderr as each input or archive member is raised.
+static bool ShowProgress;
+
 static bool PrintImmHex;
 
 namespace {
@@ -260,7 +326,10 @@ SectionFilter toolSectionFilter(llvm::object::ObjectFile const &O) {
 }
 } // namespace
 
-static const Target *getTarget(const ObjectFile *Obj = nullptr) {
+// Return the target of Obj and set TheTripleName to its triple. The triple
+// specified using --triple, if any, is used as the base triple of every input.
+static const Target *getTarget(const ObjectFile *Obj,
+                               std::string &TheTripleName) {
   // Figure out the target triple.
   llvm::Triple TheTriple("unknown-unknown-unknown");
   if (TripleName.empty()) {
@@ -317,34 +386,114 @@ static const Target *getTarget(const ObjectFile *Obj = nullptr) {
       TheTriple.getArchName() == "armv5" || TheTriple.getArchName() == "armv5t")
     TheTriple.setArchName("armv6");
 
-  // Update the triple name and return the found target.
-  TripleName = TheTriple.getTriple();
+  // Return the triple name and the found target.
+  TheTripleName = TheTriple.getTriple();
   return TheTarget;
 }
 
+namespace {
+/// Target and MC objects of a triple, CPU and set of target features. These
+/// are not modified while raising. So, they are created once and shared by
+/// all inputs with the same triple, CPU and features, including inputs raised
+/// concurrently.
+struct RaiserTargetInfo {
+  const Target *TheTarget;
+  std::string TripleName;
+  std::string Features;
+  std::unique_ptr<const MCRegisterInfo> MRI;
+  std::unique_ptr<const MCAsmInfo> AsmInfo;
+  std::unique_ptr<const MCSubtargetInfo> STI;
+  std::unique_ptr<const MCInstrInfo> MII;
+  std::unique_ptr<const MCInstrAnalysis> MIA;
+};
+} // namespace
+
+static ManagedStatic<StringMap<std::unique_ptr<RaiserTargetInfo>>>
+    TargetInfoCache;
+static std::mutex TargetInfoCacheMutex;
+
+// Return the target and MC objects used to raise Obj.
+static const RaiserTargetInfo &getTargetInfo(const ObjectFile *Obj) {
+  std::string TheTripleName;
+  const Target *TheTarget = getTarget(Obj, TheTripleName);
+
+  // Package up features to be passed to target/subtarget
+  SubtargetFeatures Features = Obj->getFeatures();
+  if (MAttrs.size()) {
+    for (unsigned Idx = 0; Idx != MAttrs.size(); ++Idx)
+      Features.AddFeature(MAttrs[Idx]);
+  }
+  std::string FeaturesStr = Features.getString();
+
+  std::string Key = TheTripleName + '\n' + MCPU + '\n' + FeaturesStr;
+  {
+    std::lock_guard<std::mutex> Lock(TargetInfoCacheMutex);
+    auto Iter = TargetInfoCache->find(Key);
+    if (Iter != TargetInfoCache->end())
+      return *Iter->second;
+  }
+
+  // Create and validate the target info without holding the lock, so that an
+  // error reported while raising an input in a recovery context with
+  // --isolate-failures leaves neither the lock held nor an incomplete target
+  // info in the cache.
+  auto TI = std::make_unique<RaiserTargetInfo>();
+  TI->TheTarget = TheTarget;
+  TI->TripleName = TheTripleName;
+  TI->Features = FeaturesStr;
+  TI->MRI.reset(TheTarget->createMCRegInfo(TheTripleName));
+  if (!TI->MRI)
+    reportError(Obj->getFileName(),
+                "no register info for target " + TheTripleName);
+
+  MCTargetOptions MCOptions;
+  TI->AsmInfo.reset(
+      TheTarget->createMCAsmInfo(*TI->MRI, TheTripleName, MCOptions));
+  if (!TI->AsmInfo)
+    reportError(Obj->getFileName(),
+                "no assembly info for target " + TheTripleName);
+  TI->STI.reset(
+      TheTarget->createMCSubtargetInfo(TheTripleName, MCPU, FeaturesStr));
+  if (!TI->STI)
+    reportError(Obj->getFileName(),
+                "no subtarget info for target " + TheTripleName);
+  TI->MII.reset(TheTarget->createMCInstrInfo());
+  if (!TI->MII)
+    reportError(Obj->getFileName(),
+                "no instruction info for target " + TheTripleName);
+  TI->MIA.reset(TheTarget->createMCInstrAnalysis(TI->MII.get()));
+
+  // Another thread may have created the target info meanwhile. Use the one
+  // cached first.
+  std::lock_guard<std::mutex> Lock(TargetInfoCacheMutex);
+  auto Inserted = TargetInfoCache->try_emplace(Key, std::move(TI));
+  return *Inserted.first->second;
+}
+
 static std::unique_ptr<ToolOutputFile> getOutputStream(StringRef InfileName) {
   // If output file name is not explicitly specified construct a name based on
   // the input file name.
-  if (OutputFilename.empty()) {
+  std::string OutFileName = OutputFilename;
+  if (OutFileName.empty()) {
     // If InputFilename ends in .o, remove it.
     if (InfileName.endswith(".o"))
-      OutputFilename = std::string(InfileName.drop_back(2));
+      OutFileName = std::string(InfileName.drop_back(2));
     else if (InfileName.endswith(".so"))
-      OutputFilename = std::string(InfileName.drop_back(3));
+      OutFileName = std::string(InfileName.drop_back(3));
     else
-      OutputFilename = std::string(InfileName);
+      OutFileName = std::string(InfileName);
 
     switch (OutputFormat) {
     case OF_LL:
-      OutputFilename += "-dis.ll";
+      OutFileName += "-dis.ll";
       break;
     // Just uses enum CGFT_ObjectFile represent llvm bitcode file type
     // provisionally.
     case OF_BC:
-      OutputFilename += "-dis.bc";
+      OutFileName += "-dis.bc";
       break;
     default:
-      OutputFilename += ".null";
+      OutFileName += ".null";
       break;
     }
   }
@@ -357,11 +506,9 @@ static std::unique_ptr<ToolOutputFile> getOutputStream(StringRef InfileName) {
   sys::fs::OpenFlags OpenFlags = sys::fs::OF_None;
   if (!Binary)
     OpenFlags |= sys::fs::OF_Text;
-  auto FDOut = std::make_unique<ToolOutputFile>(OutputFilename, EC, OpenFlags);
-  if (EC) {
-    errs() << EC.message() << '\n';
-    return nullptr;
-  }
+  auto FDOut = std::make_unique<ToolOutputFile>(OutFileName, EC, OpenFlags);
+  if (EC)
+    reportError(OutFileName, EC.message());
 
   return FDOut;
 }
@@ -702,50 +849,228 @@ static void initializeAllModuleRaisers() {
 #include "Raisers.def"
 }
 
-static void disassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
-  if (StartAddress > StopAddress)
-    error("Start address should be less than stop address");
+namespace {
+/// Bytes [Start, End) of a symbol in a text section along with the
+/// MCInstRaiser of the function to which they belong.
+struct SymbolDecodeRange {
+  uint64_t Start;
+  uint64_t End;
+  uint8_t SymbolType;
+  MCInstRaiser *InstRaiser;
+};
+
+/// Instructions, data and branch targets found in a SymbolDecodeRange.
+struct DecodedSymbol {
+  struct DecodeFailure {
+    uint64_t Index;
+    uint64_t Size;
+    std::string Comments;
+  };
 
-  const Target *TheTarget = getTarget(Obj);
+  // Offsets and decoded contents in the order of decoding
+  std::vector<std::pair<uint64_t, MCInstOrData>> InstsOrData;
+  std::vector<uint64_t> BranchTargets;
+  std::vector<DecodeFailure> Failures;
+};
+} // namespace
 
-  // Package up features to be passed to target/subtarget
-  SubtargetFeatures Features = Obj->getFeatures();
-  if (MAttrs.size()) {
-    for (unsigned Idx = 0; Idx != MAttrs.size(); ++Idx)
-      Features.AddFeature(MAttrs[Idx]);
+// Print the contents of a data symbol found in a text section. The contents
+// are printed to stderr using a single write, as inputs may be raised
+// concurrently.
+static void printDataSymbolBytes(ArrayRef<uint8_t> Bytes, uint64_t SectionAddr,
+                                 uint64_t Start, uint64_t End) {
+  std::string Contents;
+  raw_string_ostream OS(Contents);
+  // parse data up to 8 bytes at a time
+  uint8_t AsciiData[9] = {'\0'};
+  uint8_t Byte;
+  int NumBytes = 0;
+
+  for (uint64_t Index = Start; Index < End; Index += 1) {
+    if (((SectionAddr + Index) < StartAddress) ||
+        ((SectionAddr + Index) > StopAddress))
+      continue;
+    if (NumBytes == 0) {
+      OS << format("%8" PRIx64 ":", SectionAddr + Index);
+      OS << "\t";
+    }
+    Byte = Bytes.slice(Index)[0];
+    OS << format(" %02x", Byte);
+    AsciiData[NumBytes] = isprint(Byte) ? Byte : '.';
+
+    uint8_t IndentOffset = 0;
+    NumBytes++;
+    if (Index == End - 1 || NumBytes > 8) {
+      // Indent the space for less than 8 bytes data.
+      // 2 spaces for byte and one for space between bytes
+      IndentOffset = 3 * (8 - NumBytes);
+      for (int Excess = 8 - NumBytes; Excess < 8; Excess++)
+        AsciiData[Excess] = '\0';
+      NumBytes = 8;
+    }
+    if (NumBytes == 8) {
+      AsciiData[8] = '\0';
+      OS << std::string(IndentOffset, ' ') << "         ";
+      OS << reinterpret_cast<char *>(AsciiData);
+      OS << '\n';
+      NumBytes = 0;
+    }
   }
+  errs() << OS.str();
+}
 
-  std::unique_ptr<const MCRegisterInfo> MRI(
-      TheTarget->createMCRegInfo(TripleName));
-  if (!MRI)
-    reportError(Obj->getFileName(),
-                "no register info for target " + TripleName);
+// Decode the bytes of Range in section contents Bytes. No state other than
+// that of DisAsm and Decoded is modified. So, different ranges may be decoded
+// concurrently using disassemblers created with different MCContexts.
+static void decodeSymbolRange(const ObjectFile *Obj,
+                              const MCDisassembler &DisAsm,
+                              const MCInstrAnalysis *MIA,
+                              ArrayRef<uint8_t> Bytes, uint64_t SectionAddr,
+                              ArrayRef<uint64_t> DataMappingSymsAddr,
+                              ArrayRef<uint64_t> TextMappingSymsAddr,
+                              const SymbolDecodeRange &Range,
+                              DecodedSymbol &Decoded) {
+  SmallString<40> Comments;
+  raw_svector_ostream CommentStream(Comments);
+
+  uint64_t Size;
+  uint64_t End = Range.End;
+  for (uint64_t Index = Range.Start; Index < End; Index += Size) {
+    MCInst Inst;
+
+    if (Index + SectionAddr < StartAddress ||
+        Index + SectionAddr > StopAddress) {
+      // skip byte by byte till StartAddress is reached
+      Size = 1;
+      continue;
+    }
+
+    // AArch64 ELF binaries can interleave data and text in the
+    // same section. We rely on the markers introduced to
+    // understand what we need to dump. If the data marker is within a
+    // function, it is denoted as a word/short etc
+    if (isArmElf(Obj) && Range.SymbolType != ELF::STT_OBJECT) {
+      uint64_t Stride = 0;
+
+      auto DAI = std::lower_bound(DataMappingSymsAddr.begin(),
+                                  DataMappingSymsAddr.end(), Index);
+      if (DAI != DataMappingSymsAddr.end() && *DAI == Index) {
+        // Switch to data.
+        while (Index < End) {
+          if (Index + 4 <= End) {
+            Stride = 4;
+            uint32_t Data = 0;
+            if (Obj->isLittleEndian()) {
+              const auto *const Word =
+                  reinterpret_cast<const support::ulittle32_t *>(
+                      Bytes.data() + Index);
+              Data = *Word;
+            } else {
+              const auto *const Word =
+                  reinterpret_cast<const support::ubig32_t *>(Bytes.data() +
+                                                              Index);
+              Data = *Word;
+            }
+            Decoded.InstsOrData.emplace_back(Index, MCInstOrData(Data));
+          } else if (Index + 2 <= End) {
+            Stride = 2;
+            uint16_t Data = 0;
+            if (Obj->isLittleEndian()) {
+              const auto *const Short =
+                  reinterpret_cast<const support::ulittle16_t *>(
+                      Bytes.data() + Index);
+              Data = *Short;
+            } else {
+              const auto *const Short =
+                  reinterpret_cast<const support::ubig16_t *>(Bytes.data() +
+                                                              Index);
+              Data = *Short;
+            }
+            Decoded.InstsOrData.emplace_back(Index, MCInstOrData(Data));
+          } else {
+            Stride = 1;
+            Decoded.InstsOrData.emplace_back(
+                Index, MCInstOrData(Bytes.slice(Index, 1)[0]));
+          }
+          Index += Stride;
+
+          auto TAI = std::lower_bound(TextMappingSymsAddr.begin(),
+                                      TextMappingSymsAddr.end(), Index);
+          if (TAI != TextMappingSymsAddr.end() && *TAI == Index)
+            break;
+        }
+      }
+    }
+
+    if (Index >= End)
+      break;
+
+    // Disassemble a real instruction or a data
+    bool Disassembled = DisAsm.getInstruction(
+        Inst, Size, Bytes.slice(Index), SectionAddr + Index, CommentStream);
+    if (Size == 0)
+      Size = 1;
+
+    if (!Disassembled) {
+      Decoded.Failures.push_back({Index, Size, Comments.str().str()});
+      Comments.clear();
+      continue;
+    }
+
+    // Add MCInst to the list if all instructions were decoded
+    // successfully till now. Else, do not bother adding since no attempt
+    // will be made to raise this function.
+    Decoded.InstsOrData.emplace_back(Index, MCInstOrData(Inst));
+
+    // Find branch target and record it. Call targets are not
+    // recorded as they are not needed to build per-function CFG.
+    if (MIA && MIA->isBranch(Inst)) {
+      uint64_t BranchTarget;
+      if (MIA->evaluateBranch(Inst, Index, Size, BranchTarget)) {
+        // Add the index Target to target indices set.
+        Decoded.BranchTargets.push_back(BranchTarget);
+      }
+
+      // Mark the next instruction as a target, if it is not beyond the
+      // function end
+      uint64_t FallThruIndex = Index + Size;
+      if (FallThruIndex < End) {
+        Decoded.BranchTargets.push_back(FallThruIndex);
+      }
+    }
+  }
+}
+
+// Raise Obj, named InputName, to the output file named after OutputBaseName,
+// unless one is specified.
+static void disassembleObject(const ObjectFile *Obj, StringRef InputName,
+                              StringRef OutputBaseName, bool InlineRelocs) {
+  if (StartAddress > StopAddress)
+    error("Start address should be less than stop address");
+
+  const RaiserTargetInfo &TI = getTargetInfo(Obj);
+  RaiserStatistics::beginInput(InputName);
+
+  const Target *TheTarget = TI.TheTarget;
+  const std::string &TripleName = TI.TripleName;
+  const MCRegisterInfo *MRI = TI.MRI.get();
+  const MCAsmInfo *AsmInfo = TI.AsmInfo.get();
+  const MCSubtargetInfo *STI = TI.STI.get();
+  const MCInstrInfo *MII = TI.MII.get();
+  const MCInstrAnalysis *MIA = TI.MIA.get();
 
-  MCTargetOptions MCOptions;
   // Set up disassembler.
-  std::unique_ptr<const MCAsmInfo> AsmInfo(
-      TheTarget->createMCAsmInfo(*MRI, TripleName, MCOptions));
-  if (!AsmInfo)
-    reportError(Obj->getFileName(),
-                "no assembly info for target " + TripleName);
-  std::unique_ptr<const MCSubtargetInfo> STI(
-      TheTarget->createMCSubtargetInfo(TripleName, MCPU, Features.getString()));
-  if (!STI)
-    reportError(Obj->getFileName(),
-                "no subtarget info for target " + TripleName);
-  std::unique_ptr<const MCInstrInfo> MII(TheTarget->createMCInstrInfo());
-  if (!MII)
-    reportError(Obj->getFileName(),
-                "no instruction info for target " + TripleName);
-  MCContext Ctx(Triple(TripleName), AsmInfo.get(), MRI.get(), STI.get());
+  MCContext Ctx(Triple(TripleName), AsmInfo, MRI, STI);
 
   std::unique_ptr<MCDisassembler> DisAsm(
       TheTarget->createMCDisassembler(*STI, Ctx));
   if (!DisAsm)
     reportError(Obj->getFileName(), "no disassembler for target " + TripleName);
 
-  std::unique_ptr<const MCInstrAnalysis> MIA(
-      TheTarget->createMCInstrAnalysis(MII.get()));
+  // MCContexts and disassemblers used to decode text sections concurrently.
+  // These are kept alive as long as the decoded MCInsts may be referenced.
+  std::vector<std::unique_ptr<MCContext>> DecodeCtxs;
+  std::vector<std::unique_ptr<MCDisassembler>> DecodeDisAsms;
 
   int AsmPrinterVariant = AsmInfo->getAssemblerDialect();
   std::unique_ptr<MCInstPrinter> IP(TheTarget->createMCInstPrinter(
@@ -758,7 +1083,7 @@ static void disassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
 
   LLVMContext LlvmCtx;
   std::unique_ptr<TargetMachine> Target(
-      TheTarget->createTargetMachine(TripleName, MCPU, Features.getString(),
+      TheTarget->createTargetMachine(TripleName, MCPU, TI.Features,
                                      TargetOptions(), /* RelocModel */ None));
   assert(Target && "Could not allocate target machine!");
 
@@ -770,16 +1095,12 @@ static void disassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
   /* Set datalayout of the module to be the same as LLVMTargetMachine */
   M.setDataLayout(Target->createDataLayout());
   MachineModuleInfo->doInitialization(M);
-  // Initialize all module raisers that are supported and are part of current
-  // LLVM build.
-  initializeAllModuleRaisers();
-  // Get the module raiser for Target of the binary being raised
-  ModuleRaiser *MR = mctoll::getModuleRaiser(Target.get());
+  // Create a module raiser for Target of the binary being raised
+  std::unique_ptr<ModuleRaiser> MR = mctoll::createModuleRaiser(Target.get());
   assert((MR != nullptr) && "Failed to build module raiser");
   // Set data of module raiser
-  MR->setModuleRaiserInfo(&M, Target.get(), &MachineModuleInfo->getMMI(),
-                          MIA.get(), MII.get(), MRI.get(), IP.get(), Obj,
-                          DisAsm.get());
+  MR->setModuleRaiserInfo(&M, Target.get(), &MachineModuleInfo->getMMI(), MIA,
+                          MII, MRI, IP.get(), Obj, DisAsm.get());
 
   // Collect dynamic relocations.
   MR->collectDynamicRelocations();
@@ -914,17 +1235,11 @@ static void disassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
                        Section.isText() ? ELF::STT_FUNC : ELF::STT_OBJECT));
     }
 
-    SmallString<40> Comments;
-    raw_svector_ostream CommentStream(Comments);
-
     StringRef BytesStr =
         unwrapOrError(Section.getContents(), Obj->getFileName());
     ArrayRef<uint8_t> Bytes(reinterpret_cast<const uint8_t *>(BytesStr.data()),
                             BytesStr.size());
 
-    uint64_t Size;
-    uint64_t Index;
-
     FunctionFilter *FuncFilter = MR->getFunctionFilter();
     if (!FilterConfigFileName.empty()) {
       if (!FuncFilter->readFilterFunctionConfigFile(FilterConfigFileName)) {
@@ -937,8 +1252,11 @@ static void disassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
     // section whose instructions are being raised.
     MR->collectTextSectionRelocs(Section);
 
-    // Set used to record all branch targets of a function.
-    std::set<uint64_t> BranchTargetSet;
+    Optional<RaiserStatistics::PhaseRegion> DisassemblyRegion;
+    DisassemblyRegion.emplace(RaiserPhase::Disassembly);
+
+    // Byte ranges of symbols to be decoded, in the order of symbols.
+    std::vector<SymbolDecodeRange> DecodeRanges;
     MachineFunctionRaiser *CurMFRaiser = nullptr;
 
     // Disassemble symbol by symbol and fill MR->MFRaiserVector by
@@ -1047,21 +1365,9 @@ static void disassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
         Function *Func = Function::Create(FTy, GlobalValue::ExternalLinkage,
                                           FunctionName, &M);
 
-        // New function symbol encountered. Record all targets collected to
-        // current MachineFunctionRaiser before we start parsing the new
-        // function bytes.
-        CurMFRaiser = MR->getCurrentMachineFunctionRaiser();
-        for (auto TargetIdx : BranchTargetSet) {
-          assert(CurMFRaiser != nullptr &&
-                 "Encountered uninitialized MachineFunction raiser object");
-          CurMFRaiser->getMCInstRaiser()->addTarget(TargetIdx);
-        }
-
-        // Clear the set used to record all branch targets of this function.
-        BranchTargetSet.clear();
         // Create a new MachineFunction raiser
         CurMFRaiser =
-            MR->CreateAndAddMachineFunctionRaiser(Func, MR, Start, End);
+            MR->CreateAndAddMachineFunctionRaiser(Func, MR.get(), Start, End);
         LLVM_DEBUG(dbgs() << "\nFunction " << Symbols[SI].Name << ":\n");
       } else {
         // Continue using to the most recent MachineFunctionRaiser
@@ -1087,196 +1393,132 @@ static void disassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
         }
       }
 
-      // Get the associated MCInstRaiser
-      MCInstRaiser *InstRaiser = CurMFRaiser->getMCInstRaiser();
-
-      // Start new basic block at the symbol.
-      BranchTargetSet.insert(Start);
-
-      for (Index = Start; Index < End; Index += Size) {
-        MCInst Inst;
+      // Record the bytes of the symbol to be decoded as part of the function
+      // being raised.
+      DecodeRanges.push_back({Start, End, Symbols[SI].Type,
+                              CurMFRaiser->getMCInstRaiser()});
+      FuncFilter->eraseFunctionBySymbol(Symbols[SI].Name,
+                                        FunctionFilter::FILTER_INCLUDE);
+    }
+    LLVM_DEBUG(dbgs() << "END Disassembly of Functions in Section : "
+                      << SectionName.data() << "\n");
 
-        if (Index + SectionAddr < StartAddress ||
-            Index + SectionAddr > StopAddress) {
-          // skip byte by byte till StartAddress is reached
-          Size = 1;
+    // Decode the recorded symbol byte ranges. When more than one job is
+    // requested, the ranges are split into contiguous chunks of roughly equal
+    // size, each of which is decoded using its own MCContext and disassembler.
+    std::vector<DecodedSymbol> DecodedSymbols(DecodeRanges.size());
+    auto DecodeRangesInChunk = [&](const MCDisassembler &ChunkDisAsm,
+                                   size_t ChunkBegin, size_t ChunkEnd) {
+      for (size_t RI = ChunkBegin; RI != ChunkEnd; ++RI) {
+        // Bytes of data symbols are not decoded
+        if (Obj->isELF() && DecodeRanges[RI].SymbolType == ELF::STT_OBJECT)
           continue;
+        decodeSymbolRange(Obj, ChunkDisAsm, MIA, Bytes, SectionAddr,
+                          DataMappingSymsAddr, TextMappingSymsAddr,
+                          DecodeRanges[RI], DecodedSymbols[RI]);
+      }
+    };
+
+    unsigned NumChunks = 1;
+    if (NumJobs != 1)
+      NumChunks = hardware_concurrency(NumJobs).compute_thread_count();
+    if (NumChunks > DecodeRanges.size())
+      NumChunks = DecodeRanges.size();
+    if (NumChunks < 2) {
+      DecodeRangesInChunk(*DisAsm, 0, DecodeRanges.size());
+    } else {
+      uint64_t TotalBytes = 0;
+      for (const SymbolDecodeRange &Range : DecodeRanges)
+        TotalBytes += Range.End - Range.Start;
+
+      ThreadPool Pool(hardware_concurrency(NumChunks));
+      size_t ChunkBegin = 0;
+      uint64_t ChunkedBytes = 0;
+      for (unsigned Chunk = 0; Chunk < NumChunks; Chunk++) {
+        // Close the chunk once it covers its share of bytes. The last chunk
+        // includes all remaining ranges.
+        uint64_t ChunkLimit = TotalBytes * (Chunk + 1) / NumChunks;
+        size_t ChunkEnd = ChunkBegin;
+        while (ChunkEnd < DecodeRanges.size() &&
+               (ChunkEnd == ChunkBegin || ChunkedBytes < ChunkLimit ||
+                Chunk == NumChunks - 1)) {
+          ChunkedBytes +=
+              DecodeRanges[ChunkEnd].End - DecodeRanges[ChunkEnd].Start;
+          ChunkEnd++;
         }
+        if (ChunkBegin == ChunkEnd)
+          break;
 
-        // AArch64 ELF binaries can interleave data and text in the
-        // same section. We rely on the markers introduced to
-        // understand what we need to dump. If the data marker is within a
-        // function, it is denoted as a word/short etc
-        if (isArmElf(Obj) && Symbols[SI].Type != ELF::STT_OBJECT) {
-          uint64_t Stride = 0;
-
-          auto DAI = std::lower_bound(DataMappingSymsAddr.begin(),
-                                      DataMappingSymsAddr.end(), Index);
-          if (DAI != DataMappingSymsAddr.end() && *DAI == Index) {
-            // Switch to data.
-            while (Index < End) {
-              if (Index + 4 <= End) {
-                Stride = 4;
-                uint32_t Data = 0;
-                if (Obj->isLittleEndian()) {
-                  const auto *const Word =
-                      reinterpret_cast<const support::ulittle32_t *>(
-                          Bytes.data() + Index);
-                  Data = *Word;
-                } else {
-                  const auto *const Word =
-                      reinterpret_cast<const support::ubig32_t *>(Bytes.data() +
-                                                                  Index);
-                  Data = *Word;
-                }
-                InstRaiser->addMCInstOrData(Index, Data);
-              } else if (Index + 2 <= End) {
-                Stride = 2;
-                uint16_t Data = 0;
-                if (Obj->isLittleEndian()) {
-                  const auto *const Short =
-                      reinterpret_cast<const support::ulittle16_t *>(
-                          Bytes.data() + Index);
-                  Data = *Short;
-                } else {
-                  const auto *const Short =
-                      reinterpret_cast<const support::ubig16_t *>(Bytes.data() +
-                                                                  Index);
-                  Data = *Short;
-                }
-                InstRaiser->addMCInstOrData(Index, Data);
-              } else {
-                Stride = 1;
-                InstRaiser->addMCInstOrData(Index, Bytes.slice(Index, 1)[0]);
-              }
-              Index += Stride;
-
-              auto TAI = std::lower_bound(TextMappingSymsAddr.begin(),
-                                          TextMappingSymsAddr.end(), Index);
-              if (TAI != TextMappingSymsAddr.end() && *TAI == Index)
-                break;
-            }
-          }
-        }
-
-        // If there is a data symbol inside an ELF text section and we are
-        // only disassembling text, we are in a situation where we must print
-        // the data and not disassemble it.
-        // TODO : Get rid of the following code in the if-block.
-        if (Obj->isELF() && Symbols[SI].Type == ELF::STT_OBJECT &&
-            Section.isText()) {
-          // parse data up to 8 bytes at a time
-          uint8_t AsciiData[9] = {'\0'};
-          uint8_t Byte;
-          int NumBytes = 0;
-
-          for (Index = Start; Index < End; Index += 1) {
-            if (((SectionAddr + Index) < StartAddress) ||
-                ((SectionAddr + Index) > StopAddress))
-              continue;
-            if (NumBytes == 0) {
-              outs() << format("%8" PRIx64 ":", SectionAddr + Index);
-              outs() << "\t";
-            }
-            Byte = Bytes.slice(Index)[0];
-            outs() << format(" %02x", Byte);
-            AsciiData[NumBytes] = isprint(Byte) ? Byte : '.';
-
-            uint8_t IndentOffset = 0;
-            NumBytes++;
-            if (Index == End - 1 || NumBytes > 8) {
-              // Indent the space for less than 8 bytes data.
-              // 2 spaces for byte and one for space between bytes
-              IndentOffset = 3 * (8 - NumBytes);
-              for (int Excess = 8 - NumBytes; Excess < 8; Excess++)
-                AsciiData[Excess] = '\0';
-              NumBytes = 8;
-            }
-            if (NumBytes == 8) {
-              AsciiData[8] = '\0';
-              outs() << std::string(IndentOffset, ' ') << "         ";
-              outs() << reinterpret_cast<char *>(AsciiData);
-              outs() << '\n';
-              NumBytes = 0;
-            }
-          }
-        }
+        DecodeCtxs.push_back(std::make_unique<MCContext>(
+            Triple(TripleName), AsmInfo, MRI, STI));
+        DecodeDisAsms.emplace_back(
+            TheTarget->createMCDisassembler(*STI, *DecodeCtxs.back()));
+        if (!DecodeDisAsms.back())
+          reportError(Obj->getFileName(),
+                      "no disassembler for target " + TripleName);
+        const MCDisassembler *ChunkDisAsm = DecodeDisAsms.back().get();
+        Pool.async(
+            [&DecodeRangesInChunk, ChunkDisAsm, ChunkBegin, ChunkEnd]() {
+              DecodeRangesInChunk(*ChunkDisAsm, ChunkBegin, ChunkEnd);
+            });
+        ChunkBegin = ChunkEnd;
+      }
+      Pool.wait();
+    }
 
-        if (Index >= End)
-          break;
+    // Reserve space for the decoded instructions of each MCInstRaiser.
+    DenseMap<MCInstRaiser *, size_t> NumInstsOrData;
+    for (size_t RI = 0, RSize = DecodeRanges.size(); RI != RSize; ++RI)
+      NumInstsOrData[DecodeRanges[RI].InstRaiser] +=
+          DecodedSymbols[RI].InstsOrData.size();
+    for (auto &Entry : NumInstsOrData)
+      Entry.first->reserve(Entry.second);
+
+    // Add the decoded instructions and branch targets to the MCInstRaisers in
+    // the order of symbols. All function ends are known at this point. So,
+    // branch targets are checked against the final extent of each function.
+    for (size_t RI = 0, RSize = DecodeRanges.size(); RI != RSize; ++RI) {
+      const SymbolDecodeRange &Range = DecodeRanges[RI];
+      const DecodedSymbol &Decoded = DecodedSymbols[RI];
+      MCInstRaiser *InstRaiser = Range.InstRaiser;
 
-        // Disassemble a real instruction or a data
-        bool Disassembled = DisAsm->getInstruction(
-            Inst, Size, Bytes.slice(Index), SectionAddr + Index, CommentStream);
-        if (Size == 0)
-          Size = 1;
-
-        if (!Disassembled) {
-          errs() << "**** Warning: Failed to decode instruction\n";
-          PIP.printInst(*IP, Disassembled ? &Inst : nullptr,
-                        Bytes.slice(Index, Size), SectionAddr + Index, outs(),
-                        "", *STI);
-          outs() << CommentStream.str();
-          Comments.clear();
-          errs() << "\n";
-        }
+      // Start new basic block at the symbol.
+      InstRaiser->addTarget(Range.Start);
+
+      // If there is a data symbol inside an ELF text section and we are
+      // only disassembling text, we are in a situation where we must print
+      // the data and not disassemble it.
+      // TODO : Get rid of printing the data.
+      if (Obj->isELF() && Range.SymbolType == ELF::STT_OBJECT &&
+          Section.isText()) {
+        printDataSymbolBytes(Bytes, SectionAddr, Range.Start, Range.End);
+        continue;
+      }
 
-        // Add MCInst to the list if all instructions were decoded
-        // successfully till now. Else, do not bother adding since no attempt
-        // will be made to raise this function.
-        if (Disassembled) {
-          InstRaiser->addMCInstOrData(Index, Inst);
-
-          // Find branch target and record it. Call targets are not
-          // recorded as they are not needed to build per-function CFG.
-          if (MIA && MIA->isBranch(Inst)) {
-            uint64_t BranchTarget;
-            if (MIA->evaluateBranch(Inst, Index, Size, BranchTarget)) {
-              // In a relocatable object, the target's section must reside in
-              // the same section as the call instruction, or it is accessed
-              // through a relocation.
-              //
-              // In a non-relocatable object, the target may be in any
-              // section.
-              //
-              // N.B. We don't walk the relocations in the relocatable case
-              // yet.
-              if (!Obj->isRelocatableObject()) {
-                auto SectionAddress = std::upper_bound(
-                    SectionAddresses.begin(), SectionAddresses.end(),
-                    BranchTarget,
-                    [](uint64_t LHS,
-                       const std::pair<uint64_t, SectionRef> &RHS) {
-                      return LHS < RHS.first;
-                    });
-                if (SectionAddress != SectionAddresses.begin()) {
-                  --SectionAddress;
-                }
-              }
-              // Add the index Target to target indices set.
-              BranchTargetSet.insert(BranchTarget);
-            }
+      NumDecodeFailures += Decoded.Failures.size();
+      for (const DecodedSymbol::DecodeFailure &Failure : Decoded.Failures) {
+        // Print each failure using a single write, as inputs may be raised
+        // concurrently.
+        std::string Message;
+        raw_string_ostream OS(Message);
+        OS << "**** Warning: Failed to decode instruction\n";
+        PIP.printInst(*IP, nullptr, Bytes.slice(Failure.Index, Failure.Size),
+                      SectionAddr + Failure.Index, OS, "", *STI);
+        OS << Failure.Comments << "\n";
+        errs() << OS.str();
+      }
 
-            // Mark the next instruction as a target, if it is not beyond the
-            // function end
-            uint64_t FallThruIndex = Index + Size;
-            if (FallThruIndex < End) {
-              BranchTargetSet.insert(FallThruIndex);
-            }
-          }
-        }
+      for (const auto &InstOrData : Decoded.InstsOrData) {
+        if (InstOrData.second.isMCInst())
+          ++NumInstsDecoded;
+        InstRaiser->addMCInstOrData(InstOrData.first, InstOrData.second);
       }
-      FuncFilter->eraseFunctionBySymbol(Symbols[SI].Name,
-                                        FunctionFilter::FILTER_INCLUDE);
-    }
-    LLVM_DEBUG(dbgs() << "END Disassembly of Functions in Section : "
-                      << SectionName.data() << "\n");
 
-    // Record all targets of the last function parsed
-    CurMFRaiser = MR->getCurrentMachineFunctionRaiser();
-    for (auto TargetIdx : BranchTargetSet)
-      CurMFRaiser->getMCInstRaiser()->addTarget(TargetIdx);
+      for (uint64_t Target : Decoded.BranchTargets)
+        InstRaiser->addTarget(Target);
+    }
 
+    DisassemblyRegion.reset();
     MR->runMachineFunctionPasses();
 
     if (!FuncFilter->isFilterSetEmpty(FunctionFilter::FILTER_INCLUDE)) {
@@ -1290,9 +1532,7 @@ static void disassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
   Triple TheTriple = Triple(TripleName);
 
   // Decide where to send the output.
-  std::unique_ptr<ToolOutputFile> Out = getOutputStream(Obj->getFileName());
-  if (!Out)
-    return;
+  std::unique_ptr<ToolOutputFile> Out = getOutputStream(OutputBaseName);
 
   // Keep the file created.
   Out->keep();
@@ -1340,6 +1580,10 @@ static void disassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
 
     // PM.add(createDeadStoreEliminationPass());
 
+    // Add the optimization pipeline specified using --opt-level or --passes.
+    if (!PassPipeline.empty())
+      PM.add(new OptimizationPipelinePass(Target.get(), PassPipeline));
+
     // Add print pass to emit ouptut file.
     PM.add(new EmitRaisedOutputPass(*OS, OutputFileType));
 
@@ -1353,13 +1597,57 @@ static void disassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
   } else if (Target->addPassesToEmitFile(
                  PM, *OS, nullptr, /* no dwarf output file stream*/
                  OutputFileType, NoVerify, MachineModuleInfo)) {
-    outs() << ToolName << "run system pass!\n";
+    errs() << (ToolName + " run system pass!\n").str();
   }
 
   PM.run(M);
 }
 
-static void dumpObject(ObjectFile *O, const Archive *A = nullptr) {
+// Return the name of archive member O of archive A, as archive(member).
+static std::string getArchiveMemberName(const Archive *A,
+                                        const ObjectFile *O) {
+  return (A->getFileName() + "(" + O->getFileName() + ")").str();
+}
+
+namespace {
+/// Progress of raising a list of inputs or the members of an archive, printed
+/// to stderr with --progress.
+class RaiseProgress {
+public:
+  explicit RaiseProgress(size_t NumInputs) : NumInputs(NumInputs) {}
+
+  /// Raise input InputName using RaiseInput. With --isolate-failures, an
+  /// input that fails to raise is reported, instead of exiting.
+  void raise(StringRef InputName, function_ref<void()> RaiseInput) {
+    bool Raised = true;
+    if (IsolateFailures) {
+      CrashRecoveryContext CRC;
+      Raised = CRC.RunSafely(RaiseInput);
+      if (!Raised)
+        WithColor::warning(errs(), ToolName)
+            << "failed to raise '" << InputName << "'\n";
+    } else
+      RaiseInput();
+
+    if (ShowProgress) {
+      // Print each line using a single write, as inputs may be raised
+      // concurrently.
+      std::string Line;
+      raw_string_ostream OS(Line);
+      OS << "[" << ++NumDone << "/" << NumInputs << "] "
+         << (Raised ? "raised " : "failed ") << InputName << "\n";
+      errs() << OS.str();
+    }
+  }
+
+private:
+  size_t NumInputs;
+  std::atomic<size_t> NumDone{0};
+};
+} // namespace
+
+static void dumpObject(ObjectFile *O, const Archive *A = nullptr,
+                       StringRef OutputBaseName = StringRef()) {
   // Avoid other output when using a raw option.
   LLVM_DEBUG(dbgs() << '\n');
   if (A)
@@ -1369,7 +1657,12 @@ static void dumpObject(ObjectFile *O, const Archive *A = nullptr) {
   LLVM_DEBUG(dbgs() << ":\tfile format " << O->getFileFormatName() << "\n\n");
 
   assert(Disassemble && "Disassemble not set!");
-  disassembleObject(O, /* InlineRelocations */ false);
+  if (A)
+    disassembleObject(O, getArchiveMemberName(A, O), OutputBaseName,
+                      /* InlineRelocations */ false);
+  else
+    disassembleObject(O, O->getFileName(), O->getFileName(),
+                      /* InlineRelocations */ false);
 }
 
 static void dumpObject(const COFFImportFile *I, const Archive *A) {
@@ -1379,6 +1672,14 @@ static void dumpObject(const COFFImportFile *I, const Archive *A) {
 
 /// @brief Dump each object file in \a a;
 static void dumpArchive(const Archive *A) {
+  // Extract the object files first, so that they can be raised concurrently.
+  std::vector<std::unique_ptr<Binary>> Members;
+  std::vector<std::string> OutputBaseNames;
+  StringSet<> UsedOutputBaseNames;
+  StringMap<unsigned> MemberNameSuffixes;
+  StringRef ArchiveBaseName = A->getFileName();
+  if (ArchiveBaseName.endswith(".a"))
+    ArchiveBaseName = ArchiveBaseName.drop_back(2);
   Error Err = Error::success();
   for (auto &C : A->children(Err)) {
     Expected<std::unique_ptr<Binary>> ChildOrErr = C.getAsBinary();
@@ -1387,9 +1688,23 @@ static void dumpArchive(const Archive *A) {
         reportError(std::move(E), A->getFileName(), C);
       continue;
     }
-    if (ObjectFile *O = dyn_cast<ObjectFile>(&*ChildOrErr.get()))
-      dumpObject(O, A);
-    else if (COFFImportFile *I = dyn_cast<COFFImportFile>(&*ChildOrErr.get()))
+    if (ObjectFile *O = dyn_cast<ObjectFile>(&*ChildOrErr.get())) {
+      // Name the output of each member after the archive and the member, so
+      // that members of different archives are raised to different files.
+      // Members whose names would collide with the output of an earlier
+      // member get the first numeric suffix that makes them unique.
+      StringRef MemberName = O->getFileName();
+      std::string Stem =
+          (ArchiveBaseName + "-" + sys::path::stem(MemberName)).str();
+      StringRef Ext = sys::path::extension(MemberName);
+      unsigned &Suffix = MemberNameSuffixes[MemberName];
+      std::string OutputBaseName = (Stem + Ext).str();
+      while (!UsedOutputBaseNames.insert(OutputBaseName).second)
+        OutputBaseName = (Stem + "-" + Twine(++Suffix) + Ext).str();
+      Members.push_back(std::move(*ChildOrErr));
+      OutputBaseNames.push_back(OutputBaseName);
+    } else if (COFFImportFile *I =
+                   dyn_cast<COFFImportFile>(&*ChildOrErr.get()))
       dumpObject(I, A);
     else
       reportError(errorCodeToError(object_error::invalid_file_type),
@@ -1397,6 +1712,33 @@ static void dumpArchive(const Archive *A) {
   }
   if (Err)
     reportError(std::move(Err), A->getFileName());
+  // The output of each member would be written to the same file.
+  if (!OutputFilename.empty() && Members.size() > 1)
+    reportError(A->getFileName(),
+                "-o cannot be used with an archive of more than one object "
+                "file");
+
+  // Each member is raised in its own Module and LLVMContext. So, members are
+  // raised concurrently when more than one job is requested, each using a
+  // single thread.
+  RaiseProgress Progress(Members.size());
+  auto RaiseMember = [&](size_t Idx) {
+    ObjectFile *O = cast<ObjectFile>(Members[Idx].get());
+    Progress.raise(getArchiveMemberName(A, O),
+                   [&]() { dumpObject(O, A, OutputBaseNames[Idx]); });
+  };
+  unsigned NumMemberJobs = NumJobs;
+  if (NumMemberJobs == 1 || Members.size() < 2 || llvm::DebugFlag) {
+    for (size_t Idx = 0; Idx < Members.size(); Idx++)
+      RaiseMember(Idx);
+  } else {
+    NumJobs = 1;
+    ThreadPool Pool(hardware_concurrency(NumMemberJobs));
+    for (size_t Idx = 0; Idx < Members.size(); Idx++)
+      Pool.async([&RaiseMember, Idx]() { RaiseMember(Idx); });
+    Pool.wait();
+    NumJobs = NumMemberJobs;
+  }
 }
 
 /// @brief Open file and figure out how to dump it.
@@ -1425,7 +1767,7 @@ static void dumpInput(StringRef File) {
                << "*** Currently only 64-bit ELF binary raising supported.\n"
                << "*** Please consider contributing support to raise other "
                   "binary formats. Thanks!\n";
-        exit(1);
+        sys::Process::Exit(1);
       }
       // Raise x86_64 relocatable binaries (.o files) is not supported.
       auto EType = Elf64LEObjFile->getELFFile().getHeader().e_type;
@@ -1433,7 +1775,7 @@ static void dumpInput(StringRef File) {
         dumpObject(O);
       else {
         errs() << "Raising x64 relocatable (.o) x64 binaries not supported\n";
-        exit(1);
+        sys::Process::Exit(1);
       }
     } else if (O->getArch() == Triple::arm)
       dumpObject(O);
@@ -1441,7 +1783,7 @@ static void dumpInput(StringRef File) {
       errs() << "\n\n*** No support to raise Binaries other than x64 and ARM\n"
              << "*** Please consider contributing support to raise other "
                 "ISAs. Thanks!\n";
-      exit(1);
+      sys::Process::Exit(1);
     }
   } else
     reportError(errorCodeToError(object_error::invalid_file_type), File);
@@ -1482,6 +1824,28 @@ commaSeparatedValues(const llvm::opt::InputArgList &InputArgs, int ID) {
   return Values;
 }
 
+// Parse the comma separated list of addresses and half-open address ranges
+// of the form <begin>-<end>, specified using option ID.
+static std::vector<std::pair<uint64_t, uint64_t>>
+parseAddressRanges(const llvm::opt::InputArgList &InputArgs, int ID) {
+  std::vector<std::pair<uint64_t, uint64_t>> Ranges;
+  for (const std::string &Value : commaSeparatedValues(InputArgs, ID)) {
+    StringRef Begin, End;
+    std::tie(Begin, End) = StringRef(Value).split('-');
+    uint64_t BeginAddr, EndAddr;
+    if (!to_integer(Begin, BeginAddr, 0) ||
+        (!End.empty() && !to_integer(End, EndAddr, 0)))
+      reportCmdLineError("'" + Value +
+                         "' is not a valid address or address range");
+    if (End.empty())
+      EndAddr = BeginAddr + 1;
+    if (EndAddr <= BeginAddr)
+      reportCmdLineError("address range '" + Value + "' is empty");
+    Ranges.emplace_back(BeginAddr, EndAddr);
+  }
+  return Ranges;
+}
+
 static void parseOptions(const llvm::opt::InputArgList &InputArgs) {
   llvm::DebugFlag = InputArgs.hasArg(OPT_debug);
   Disassemble = InputArgs.hasArg(OPT_raise);
@@ -1494,13 +1858,74 @@ static void parseOptions(const llvm::opt::InputArgList &InputArgs) {
   HasStartAddressFlag = InputArgs.hasArg(OPT_start_address_EQ);
   parseIntArg(InputArgs, OPT_stop_address_EQ, StopAddress);
   HasStopAddressFlag = InputArgs.hasArg(OPT_stop_address_EQ);
+  parseIntArg(InputArgs, OPT_jobs_EQ, NumJobs);
+  SSAWithPHIs = InputArgs.hasArg(OPT_ssa_phis);
+  if (const opt::Arg *A = InputArgs.getLastArg(OPT_stack_layout_EQ)) {
+    Optional<StackLayoutKind> Layout =
+        StringSwitch<Optional<StackLayoutKind>>(A->getValue())
+            .Case("slots", StackLayoutKind::Slots)
+            .Case("frame", StackLayoutKind::Frame)
+            .Case("verify-slots", StackLayoutKind::VerifiedSlots)
+            .Default(None);
+    if (!Layout)
+      reportCmdLineError("'" + StringRef(A->getValue()) +
+                         "' is not a valid stack layout");
+    StackLayout = *Layout;
+  }
+  PassPipeline = InputArgs.getLastArgValue(OPT_passes_EQ).str();
+  if (const opt::Arg *A = InputArgs.getLastArg(OPT_opt_level_EQ)) {
+    static const StringRef OptLevels[] = {"O0", "O1", "O2", "O3", "Os", "Oz"};
+    StringRef Level = A->getValue();
+    if (!is_contained(OptLevels, Level))
+      reportCmdLineError("'" + Level + "' is not a valid optimization level");
+    if (!PassPipeline.empty())
+      reportCmdLineError("--opt-level and --passes cannot be used together");
+    PassPipeline = ("default<" + Level + ">").str();
+  }
+  if (!PassPipeline.empty())
+    if (Error E = OptimizationPipelinePass::validatePipeline(PassPipeline))
+      reportCmdLineError("invalid pass pipeline '" + PassPipeline +
+                         "': " + toString(std::move(E)));
+  VSATraceFile = InputArgs.getLastArgValue(OPT_vsa_trace_EQ).str();
+  VSATraceFunctions =
+      commaSeparatedValues(InputArgs, OPT_vsa_trace_function_EQ);
+  VSATraceAddressRanges =
+      parseAddressRanges(InputArgs, OPT_vsa_trace_address_EQ);
+  parseIntArg(InputArgs, OPT_vsa_max_block_visits_EQ, VSAMaxBlockVisits);
+  TimePhases = InputArgs.hasArg(OPT_time_phases);
+  StatsJSONFile = InputArgs.getLastArgValue(OPT_stats_json_EQ).str();
+  // Statistics are only tracked if enabled before they are first updated.
+  if (!StatsJSONFile.empty())
+    EnableStatistics(/*DoPrintOnExit=*/false);
+  parseIntArg(InputArgs, OPT_max_function_time_EQ, MaxFunctionTime);
+  parseIntArg(InputArgs, OPT_max_function_instrs_EQ, MaxFunctionInstrs);
+  parseIntArg(InputArgs, OPT_max_function_ir_instrs_EQ, MaxFunctionIRInstrs);
+  IsolateFailures = InputArgs.hasArg(OPT_isolate_failures);
+  ShowProgress = InputArgs.hasArg(OPT_progress);
+  // Crashes are only recovered from once enabled.
+  if (IsolateFailures)
+    CrashRecoveryContext::Enable();
   TargetName = InputArgs.getLastArgValue(OPT_target_EQ).str();
   SysRoot = InputArgs.getLastArgValue(OPT_sysyroot_EQ).str();
   OutputFilename = InputArgs.getLastArgValue(OPT_outfile_EQ).str();
 
   InputFileNames = InputArgs.getAllArgValues(OPT_INPUT);
+  // Add the inputs listed in the batch manifest, one per line. Blank lines and
+  // lines starting with '#' are ignored.
+  for (const std::string &BatchFile : InputArgs.getAllArgValues(OPT_batch_EQ)) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> BufOrErr =
+        MemoryBuffer::getFile(BatchFile, /*IsText=*/true);
+    if (!BufOrErr)
+      reportCmdLineError("cannot read batch manifest '" + BatchFile +
+                         "': " + BufOrErr.getError().message());
+    for (line_iterator Line(**BufOrErr, /*SkipBlanks=*/true, '#');
+         !Line.is_at_eof(); ++Line)
+      InputFileNames.push_back(Line->trim().str());
+  }
   if (InputFileNames.empty())
     reportCmdLineError("no input file");
+  if (!OutputFilename.empty() && InputFileNames.size() > 1)
+    reportCmdLineError("-o cannot be used with more than one input file");
 
   IncludeFileNames = InputArgs.getAllArgValues(OPT_include_file_EQ);
   std::string IncludeFileNames2 =
@@ -1511,6 +1936,8 @@ static void parseOptions(const llvm::opt::InputArgList &InputArgs) {
     for (auto N : FNames)
       IncludeFileNames.push_back(std::string(N));
   }
+  PrototypeCacheDir =
+      InputArgs.getLastArgValue(OPT_prototype_cache_dir_EQ).str();
 
   if (const opt::Arg *A = InputArgs.getLastArg(OPT_output_format_EQ)) {
     OutputFormat = StringSwitch<OutputFormatTy>(A->getValue())
@@ -1550,6 +1977,9 @@ int main(int argc, char **argv) {
   llvm::InitializeAllTargetInfos();
   llvm::InitializeAllTargetMCs();
   llvm::InitializeAllDisassemblers();
+  // Initialize all module raisers that are supported and are part of current
+  // LLVM build.
+  initializeAllModuleRaisers();
 
   if (Args.hasArg(OPT_version)) {
     cl::PrintVersionMessage();
@@ -1581,8 +2011,8 @@ int main(int argc, char **argv) {
   auto OF = OutputFilename;
 
   if (!IncludeFileNames.empty()) {
-    if (!IncludedFileInfo::getExternalFunctionPrototype(IncludeFileNames,
-                                                        TargetName, SysRoot)) {
+    if (!IncludedFileInfo::getExternalFunctionPrototype(
+            IncludeFileNames, TargetName, SysRoot, PrototypeCacheDir)) {
       dbgs() << "Unable to read external function prototype. Ignoring\n";
     }
   }
@@ -1594,7 +2024,27 @@ int main(int argc, char **argv) {
 #ifndef NDEBUG
   llvm::setCurrentDebugType(DEBUG_TYPE);
 #endif
-  std::for_each(InputFNames.begin(), InputFNames.end(), dumpInput);
+  // Each input is raised in its own Module and LLVMContext. So, inputs are
+  // raised concurrently when more than one job is requested, each using a
+  // single thread.
+  unsigned NumInputJobs = 1;
+  if (InputFNames.size() > 1 && !MachOOpt && !llvm::DebugFlag) {
+    NumInputJobs = NumJobs;
+    NumJobs = 1;
+  }
+  RaiseProgress Progress(InputFNames.size());
+  if (NumInputJobs == 1) {
+    for (const std::string &FName : InputFNames)
+      Progress.raise(FName, [&FName]() { dumpInput(FName); });
+  } else {
+    ThreadPool Pool(hardware_concurrency(NumInputJobs));
+    for (const std::string &FName : InputFNames)
+      Pool.async([&Progress, &FName]() {
+        Progress.raise(FName, [&FName]() { dumpInput(FName); });
+      });
+    Pool.wait();
+  }
+  RaiserStatistics::report();
 
   return EXIT_SUCCESS;
 }
@@ -37,6 +37,21 @@ extern std::vector<std::string> FilterSections;
 extern bool Disassemble;
 extern std::vector<std::string> IncludeFileNames;
 extern std::string CompilationDBDir;
+extern std::string PrototypeCacheDir;
+extern unsigned NumJobs;
+extern bool SSAWithPHIs;
+enum class StackLayoutKind { Slots, Frame, VerifiedSlots };
+extern StackLayoutKind StackLayout;
+extern std::string VSATraceFile;
+extern std::vector<std::string> VSATraceFunctions;
+extern std::vector<std::pair<uint64_t, uint64_t>> VSATraceAddressRanges;
+extern unsigned VSAMaxBlockVisits;
+extern bool TimePhases;
+extern std::string StatsJSONFile;
+extern unsigned MaxFunctionTime;
+extern unsigned MaxFunctionInstrs;
+extern unsigned MaxFunctionIRInstrs;
+extern bool IsolateFailures;
 
 // Various helper functions.
 bool isRelocAddressLess(object::RelocationRef A, object::RelocationRef B);
@@ -0,0 +1,31 @@
+// REQUIRES: system-linux
+// RUN: clang -o %t %s
+// RUN: llvm-mctoll -d -I /usr/include/stdio.h %t -o %t-dis.ll
+// RUN: FileCheck %s --check-prefix=IR < %t-dis.ll
+// RUN: clang -O2 -o %t-dis %t-dis.ll
+// RUN: %t-dis 2>&1 | FileCheck %s
+// CHECK: bump(5) = 0
+// CHECK: bump(7) = 5
+// CHECK: Counter = 12
+
+// Accesses of global data and of the stack are in different alias scopes.
+// IR-LABEL: define dso_local {{.*}} @bump(
+// IR: load {{.*}} !alias.scope ![[GLOBAL:[0-9]+]], !noalias ![[STACK:[0-9]+]]
+// IR: store {{.*}} !alias.scope ![[STACK]], !noalias ![[GLOBAL]]
+
+#include <stdio.h>
+
+int Counter;
+
+int __attribute__((noinline)) bump(int N) {
+  int Old = Counter;
+  Counter = Old + N;
+  return Old;
+}
+
+int main() {
+  printf("bump(5) = %d\n", bump(5));
+  printf("bump(7) = %d\n", bump(7));
+  printf("Counter = %d\n", Counter);
+  return 0;
+}
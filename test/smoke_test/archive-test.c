@@ -0,0 +1,58 @@
+// REQUIRES: system-linux
+// RUN: rm -rf %t && mkdir -p %t/a %t/b %t/c %t/fail
+// RUN: clang -shared -fPIC -DMEMBER=1 -o %t/a/bar.o %s
+// RUN: clang -shared -fPIC -DMEMBER=2 -o %t/b/bar.o %s
+// RUN: clang -shared -fPIC -DMEMBER=3 -o %t/baz.o %s
+// RUN: clang -shared -fPIC -DMEMBER=4 -o %t/c/bar-1.o %s
+// RUN: ar qc %t/libfoo.a %t/a/bar.o %t/b/bar.o %t/baz.o %t/c/bar-1.o
+// RUN: llvm-mctoll -d --jobs=2 --progress %t/libfoo.a 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=PROGRESS
+// RUN: FileCheck %s --check-prefix=BAR < %t/libfoo-bar-dis.ll
+// RUN: FileCheck %s --check-prefix=BAR1 < %t/libfoo-bar-1-dis.ll
+// RUN: FileCheck %s --check-prefix=BAZ < %t/libfoo-baz-dis.ll
+// RUN: FileCheck %s --check-prefix=BAR11 < %t/libfoo-bar-1-1-dis.ll
+// RUN: not llvm-mctoll -d -o %t/out.ll %t/libfoo.a 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=OUT
+
+// The output file of member baz.o cannot be created, so that raising it
+// fails. The other members are still raised.
+// RUN: cp %t/libfoo.a %t/fail/libfoo.a
+// RUN: mkdir %t/fail/libfoo-baz-dis.ll
+// RUN: llvm-mctoll -d --isolate-failures --progress %t/fail/libfoo.a 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=FAIL
+// RUN: FileCheck %s --check-prefix=BAR < %t/fail/libfoo-bar-dis.ll
+// RUN: FileCheck %s --check-prefix=BAR1 < %t/fail/libfoo-bar-1-dis.ll
+// RUN: FileCheck %s --check-prefix=BAR11 < %t/fail/libfoo-bar-1-1-dis.ll
+
+// Members are raised concurrently, in any order.
+// PROGRESS-DAG: /4] raised {{.*}}libfoo.a(bar.o)
+// PROGRESS-DAG: /4] raised {{.*}}libfoo.a(bar.o)
+// PROGRESS-DAG: /4] raised {{.*}}libfoo.a(baz.o)
+// PROGRESS-DAG: /4] raised {{.*}}libfoo.a(bar-1.o)
+
+// The output of each member is named after the archive and the member. The
+// second member named bar.o gets a numeric suffix, and member bar-1.o, whose
+// output name is then taken, gets another one.
+// BAR: define dso_local i32 @first(
+// BAR1: define dso_local i32 @second(
+// BAZ: define dso_local i32 @third(
+// BAR11: define dso_local i32 @fourth(
+
+// OUT: -o cannot be used with an archive of more than one object file
+
+// FAIL: [1/4] raised {{.*}}libfoo.a(bar.o)
+// FAIL: [2/4] raised {{.*}}libfoo.a(bar.o)
+// FAIL: error: '{{.*}}libfoo-baz-dis.ll': {{.*}}
+// FAIL: warning: failed to raise '{{.*}}libfoo.a(baz.o)'
+// FAIL: [3/4] failed {{.*}}libfoo.a(baz.o)
+// FAIL: [4/4] raised {{.*}}libfoo.a(bar-1.o)
+
+#if MEMBER == 1
+int first(int A) { return A + 1; }
+#elif MEMBER == 2
+int second(int A) { return A * 2; }
+#elif MEMBER == 3
+int third(int A) { return A - 3; }
+#else
+int fourth(int A) { return A ^ 4; }
+#endif
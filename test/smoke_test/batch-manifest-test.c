@@ -0,0 +1,22 @@
+// REQUIRES: system-linux
+// RUN: clang -o %t-one %s -O2 -DSCALE=2
+// RUN: clang -o %t-two %s -O2 -DSCALE=3
+// RUN: echo "# inputs" > %t.list
+// RUN: echo %t-one >> %t.list
+// RUN: echo %t-two >> %t.list
+// RUN: llvm-mctoll -d -I /usr/include/stdio.h --batch=%t.list --jobs=2
+// RUN: clang -o %t-one-dis %t-one-dis.ll
+// RUN: clang -o %t-two-dis %t-two-dis.ll
+// RUN: %t-one-dis 2>&1 | FileCheck %s --check-prefix=ONE
+// RUN: %t-two-dis 2>&1 | FileCheck %s --check-prefix=TWO
+// ONE: scale(7) = 14
+// TWO: scale(7) = 21
+
+#include <stdio.h>
+
+int __attribute__((noinline)) scale(int N) { return N * SCALE; }
+
+int main() {
+  printf("scale(7) = %d\n", scale(7));
+  return 0;
+}
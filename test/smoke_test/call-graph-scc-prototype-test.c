@@ -0,0 +1,42 @@
+// REQUIRES: system-linux
+// RUN: clang -o %t %s -O2
+// RUN: llvm-mctoll -d -I /usr/include/stdio.h %t -o %t-dis.ll
+// RUN: FileCheck %s --check-prefix=IR < %t-dis.ll
+// RUN: clang -o %t-dis %t-dis.ll
+// RUN: %t-dis 2>&1 | FileCheck %s
+// CHECK: isEven(10) = 1
+// CHECK: isOdd(7) = 1
+// CHECK: scale(21) = 42
+
+// IR-DAG: define dso_local {{.*}} @isEven(
+// IR-DAG: define dso_local {{.*}} @isOdd(
+// IR-DAG: define dso_local {{.*}} @scale(
+
+#include <stdio.h>
+
+int isOdd(int);
+long twice(long);
+
+// Callers precede their callees; mutually recursive functions form an SCC.
+long __attribute__((noinline)) scale(long N) { return twice(N); }
+
+int __attribute__((noinline)) isEven(int N) {
+  if (N == 0)
+    return 1;
+  return isOdd(N - 1);
+}
+
+int __attribute__((noinline)) isOdd(int N) {
+  if (N == 0)
+    return 0;
+  return isEven(N - 1);
+}
+
+long __attribute__((noinline)) twice(long N) { return N * 2; }
+
+int main() {
+  printf("isEven(10) = %d\n", isEven(10));
+  printf("isOdd(7) = %d\n", isOdd(7));
+  printf("scale(21) = %ld\n", scale(21));
+  return 0;
+}
@@ -0,0 +1,35 @@
+// REQUIRES: system-linux
+// RUN: clang -O2 -o %t %s
+// RUN: llvm-mctoll -d -I /usr/include/stdio.h %t -o %t-dis.ll
+// RUN: FileCheck %s --check-prefix=IR < %t-dis.ll
+// RUN: clang -o %t-dis %t-dis.ll
+// RUN: %t-dis 2>&1 | FileCheck %s
+// CHECK: mix(3, 5, 6) = 20
+// CHECK: twice(5) = 10
+
+// The 32-bit value of A is used twice as a 64-bit operand in the same block.
+// It is extended once and the extension is reused.
+// IR-LABEL: define dso_local i64 @mix(
+// IR: {{[sz]ext}} i32 %{{.*}} to i64
+// IR-NOT: {{[sz]ext}} i32
+// IR: ret i64
+
+// The 32-bit constant argument of twice is folded into a 64-bit constant
+// instead of being extended by a cast instruction.
+// IR-LABEL: define dso_local i32 @main(
+// IR-NOT: {{[sz]ext}} i32 5 to i64
+// IR: call i64 @twice(i64 5)
+
+#include <stdio.h>
+
+long __attribute__((noinline)) mix(unsigned A, long B, long C) {
+  return (long)A * B + ((long)A ^ C);
+}
+
+long __attribute__((noinline)) twice(long X) { return X * 2; }
+
+int main() {
+  printf("mix(3, 5, 6) = %ld\n", mix(3, 5, 6));
+  printf("twice(5) = %ld\n", twice(5));
+  return 0;
+}
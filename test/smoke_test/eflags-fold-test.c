@@ -0,0 +1,39 @@
+// REQUIRES: system-linux
+// RUN: clang -o %t %s
+// RUN: llvm-mctoll -d -I /usr/include/stdio.h %t -o %t-dis.ll
+// RUN: FileCheck %s --check-prefix=IR < %t-dis.ll
+// RUN: clang -o %t-dis %t-dis.ll
+// RUN: %t-dis 2>&1 | FileCheck %s
+// CHECK: clamp(-5) = 0
+// CHECK: clamp(50) = 10
+// CHECK: clamp(7) = 7
+// CHECK: below(3, 9) = 1
+
+// Compares followed by conditional branches are raised as single compares.
+// IR: icmp sge
+// IR-NOT: sub.with.overflow
+// IR-NOT: ctpop
+
+#include <stdio.h>
+
+int __attribute__((noinline)) clamp(int V, int Lo, int Hi) {
+  if (V < Lo)
+    return Lo;
+  if (V > Hi)
+    return Hi;
+  return V;
+}
+
+int __attribute__((noinline)) below(unsigned A, unsigned B) {
+  if (A < B)
+    return 1;
+  return 0;
+}
+
+int main() {
+  printf("clamp(-5) = %d\n", clamp(-5, 0, 10));
+  printf("clamp(50) = %d\n", clamp(50, 0, 10));
+  printf("clamp(7) = %d\n", clamp(7, 0, 10));
+  printf("below(3, 9) = %d\n", below(3, 9));
+  return 0;
+}
@@ -0,0 +1,39 @@
+// REQUIRES: system-linux
+// RUN: clang -o %t %s -O2
+// RUN: llvm-mctoll -d -I /usr/include/stdio.h --max-function-instrs=40 %t -o %t-dis.ll 2>&1 | FileCheck %s --check-prefix=WARN
+// RUN: FileCheck %s < %t-dis.ll
+
+// WARN: warning: function mix exceeded its raising budget ({{[0-9]+}} machine instructions exceed the budget of 40); emitting a declaration
+
+// CHECK-DAG: declare {{.*}} @mix(
+// CHECK-DAG: define dso_local {{.*}} @main(
+
+#include <stdio.h>
+
+volatile long Data[8];
+
+// Long enough to exceed a budget of 40 machine instructions.
+long __attribute__((noinline)) mix(long N) {
+  long R = N;
+  R = R * Data[0] + Data[1];
+  R = R ^ Data[2];
+  R = R * Data[3] + Data[4];
+  R = R ^ Data[5];
+  R = R * Data[6] + Data[7];
+  R = R * Data[1] + Data[2];
+  R = R ^ Data[3];
+  R = R * Data[4] + Data[5];
+  R = R ^ Data[6];
+  R = R * Data[7] + Data[0];
+  R = R * Data[2] + Data[3];
+  R = R ^ Data[4];
+  R = R * Data[5] + Data[6];
+  R = R ^ Data[7];
+  R = R * Data[0] + Data[1];
+  return R;
+}
+
+int main() {
+  printf("mix(3) = %ld\n", mix(3));
+  return 0;
+}
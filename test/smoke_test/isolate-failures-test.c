@@ -0,0 +1,37 @@
+// REQUIRES: system-linux
+// RUN: clang -o %t %s -O2
+// RUN: llvm-mctoll -d -I /usr/include/stdio.h --isolate-failures %t -o %t-dis.ll 2>&1 | FileCheck %s --check-prefix=WARN
+// RUN: FileCheck %s --check-prefix=IR < %t-dis.ll
+// RUN: clang -c -O2 -DDEFINE_MAX_LEAF -o %t-leaf.o %s
+// RUN: clang -o %t-dis %t-dis.ll %t-leaf.o
+// RUN: %t-dis 2>&1 | FileCheck %s
+
+// The raiser does not handle cpuid. With --isolate-failures, max_leaf is
+// emitted as a declaration and the rest of the binary is raised. The raised
+// binary is linked with a compiled definition of max_leaf.
+// WARN: warning: failed to raise function max_leaf; emitting a declaration
+
+// IR-DAG: declare {{.*}} @max_leaf()
+// IR-DAG: define dso_local {{.*}} @add3(
+// IR-DAG: define dso_local {{.*}} @main(
+
+// CHECK: add3(4) = 7
+// CHECK: max_leaf() > 0 = 1
+
+#include <stdio.h>
+
+unsigned __attribute__((noinline)) max_leaf(void) {
+  unsigned A, B, C, D;
+  __asm__ volatile("cpuid" : "=a"(A), "=b"(B), "=c"(C), "=d"(D) : "a"(0));
+  return A;
+}
+
+#ifndef DEFINE_MAX_LEAF
+int __attribute__((noinline)) add3(int N) { return N + 3; }
+
+int main() {
+  printf("add3(4) = %d\n", add3(4));
+  printf("max_leaf() > 0 = %d\n", max_leaf() > 0);
+  return 0;
+}
+#endif
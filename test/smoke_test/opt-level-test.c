@@ -0,0 +1,56 @@
+// REQUIRES: system-linux
+// RUN: clang -o %t %s
+// RUN: llvm-mctoll -d -I /usr/include/stdio.h --opt-level=O2 %t -o %t-dis.ll
+// RUN: FileCheck %s --check-prefix=IR < %t-dis.ll
+// RUN: clang -o %t-dis %t-dis.ll
+// RUN: %t-dis 2>&1 | FileCheck %s
+// RUN: llvm-mctoll -d -I /usr/include/stdio.h --passes='function(sroa)' %t \
+// RUN:   -o %t-sroa-dis.ll
+// RUN: FileCheck %s --check-prefix=PASSES < %t-sroa-dis.ll
+// RUN: clang -o %t-sroa-dis %t-sroa-dis.ll
+// RUN: %t-sroa-dis 2>&1 | FileCheck %s
+// RUN: not llvm-mctoll -d --passes=bogus %t 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=INVALID
+// RUN: not llvm-mctoll -d --opt-level=O2 --passes=sroa %t 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=CONFLICT
+// CHECK: sum(10) = 45
+// CHECK: scale(6, 7) = 42
+
+// The raised module is optimized before it is emitted. The stack slots of
+// the arguments of scale are promoted to registers, and the attributes
+// inferred by the O2 pipeline are added to the raised functions.
+// IR-LABEL: define dso_local {{.*}} @sum({{.*}}) local_unnamed_addr
+// IR-LABEL: define dso_local {{.*}} @scale({{.*}}) local_unnamed_addr
+// IR-NOT: alloca
+// IR: mul
+// IR: ret i32
+
+// Only the specified passes are run.
+// PASSES-LABEL: define dso_local {{.*}} @scale(
+// PASSES-NOT: local_unnamed_addr
+// PASSES-NOT: alloca
+// PASSES: mul
+// PASSES: ret i32
+
+// INVALID: invalid pass pipeline 'bogus'
+// CONFLICT: --opt-level and --passes cannot be used together
+
+#include <stdio.h>
+
+int __attribute__((noinline)) sum(int N) {
+  int S = 0;
+  for (int I = 0; I < N; I++)
+    S += I;
+  return S;
+}
+
+int __attribute__((noinline)) scale(int A, int B) {
+  int X = A * B;
+  return X;
+}
+
+int main() {
+  printf("sum(10) = %d\n", sum(10));
+  printf("scale(6, 7) = %d\n", scale(6, 7));
+  return 0;
+}
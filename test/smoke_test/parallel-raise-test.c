@@ -0,0 +1,35 @@
+// REQUIRES: system-linux
+// RUN: clang -o %t %s -O2 -mno-sse
+// RUN: llvm-mctoll -d -I /usr/include/stdio.h %t -o %t-serial-dis.ll
+// RUN: llvm-mctoll -d -I /usr/include/stdio.h --jobs=4 %t -o %t-dis.ll
+// RUN: diff %t-serial-dis.ll %t-dis.ll
+// RUN: clang -o %t-dis %t-dis.ll
+// RUN: %t-dis 2>&1 | FileCheck %s
+// CHECK: sum = 55
+// CHECK: prod = 3628800
+// CHECK: max = 10
+
+#include <stdio.h>
+
+int __attribute__((noinline)) sum(int N) {
+  int S = 0;
+  for (int I = 1; I <= N; I++)
+    S += I;
+  return S;
+}
+
+long __attribute__((noinline)) prod(int N) {
+  long P = 1;
+  for (int I = 1; I <= N; I++)
+    P *= I;
+  return P;
+}
+
+int __attribute__((noinline)) max(int A, int B) { return A > B ? A : B; }
+
+int main() {
+  printf("sum = %d\n", sum(10));
+  printf("prod = %ld\n", prod(10));
+  printf("max = %d\n", max(3, 10));
+  return 0;
+}
@@ -0,0 +1,18 @@
+// REQUIRES: system-linux
+// RUN: clang -o %t %s
+// RUN: rm -rf %t-cache
+// RUN: llvm-mctoll -d -I /usr/include/stdio.h --prototype-cache-dir=%t-cache %t
+// RUN: ls %t-cache | FileCheck %s --check-prefix=CACHE
+// RUN: llvm-mctoll -d -I /usr/include/stdio.h --prototype-cache-dir=%t-cache %t -o %t-cached-dis.ll
+// RUN: diff %t-dis.ll %t-cached-dis.ll
+// RUN: clang -o %t1 %t-cached-dis.ll
+// RUN: %t1 2>&1 | FileCheck %s
+// CACHE: prototypes-{{[0-9a-f]+}}.bin
+// CHECK: Hello from cached prototypes 42
+
+#include <stdio.h>
+int main(int argc, char **argv) {
+  printf("Hello from cached prototypes %d\n", 42);
+  fflush(stdout);
+  return 0;
+}
@@ -0,0 +1,35 @@
+// REQUIRES: system-linux
+// RUN: clang -o %t %s -O2 -mno-sse
+// RUN: llvm-mctoll -d -I /usr/include/stdio.h --ssa-phis %t -o %t-dis.ll
+// RUN: FileCheck %s --check-prefix=IR < %t-dis.ll
+// RUN: clang -o %t-dis %t-dis.ll
+// RUN: %t-dis 2>&1 | FileCheck %s
+// CHECK: gcd(1071, 462) = 21
+// CHECK: sum = 4950
+
+// IR: phi i64
+// IR-NOT: SKT-LOC
+
+#include <stdio.h>
+
+unsigned __attribute__((noinline)) gcd(unsigned A, unsigned B) {
+  while (B != 0) {
+    unsigned T = A % B;
+    A = B;
+    B = T;
+  }
+  return A;
+}
+
+long __attribute__((noinline)) sum(long N) {
+  long S = 0;
+  for (long I = 0; I < N; I++)
+    S += I;
+  return S;
+}
+
+int main() {
+  printf("gcd(1071, 462) = %u\n", gcd(1071, 462));
+  printf("sum = %ld\n", sum(100));
+  return 0;
+}
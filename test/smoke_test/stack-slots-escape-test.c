@@ -0,0 +1,32 @@
+// REQUIRES: system-linux
+// RUN: clang -o %t %s
+// RUN: llvm-mctoll -d -I /usr/include/stdio.h %t -o %t-dis.ll
+// RUN: clang -o %t-dis %t-dis.ll
+// RUN: %t-dis 2>&1 | FileCheck %s
+// CHECK: digits(1234) = 110
+// CHECK: digits(56) = 11
+
+#include <stdio.h>
+
+// The digits of V are stored by walking a pointer down from the end of Buf,
+// whose address escapes, while Buf[0] is also accessed directly. Both must
+// access the same stack object.
+int __attribute__((noinline)) digits(unsigned V) {
+  char Buf[4];
+  char *P = Buf + sizeof(Buf);
+  Buf[0] = 0;
+  do {
+    *--P = V % 10;
+    V /= 10;
+  } while (V != 0);
+  int Sum = 0;
+  for (char *Q = P; Q != Buf + sizeof(Buf); Q++)
+    Sum += *Q;
+  return Buf[0] * 100 + Sum;
+}
+
+int main() {
+  printf("digits(1234) = %d\n", digits(1234));
+  printf("digits(56) = %d\n", digits(56));
+  return 0;
+}
@@ -0,0 +1,36 @@
+// REQUIRES: system-linux
+// RUN: clang -o %t %s
+// RUN: llvm-mctoll -d -I /usr/include/stdio.h --stack-layout=verify-slots %t -o %t-dis.ll
+// RUN: FileCheck %s --check-prefix=IR < %t-dis.ll
+// RUN: clang -o %t-dis %t-dis.ll
+// RUN: %t-dis 2>&1 | FileCheck %s
+// CHECK: mix(3, 4, 5) = 42
+// CHECK: fill(3) = 9
+
+// Stack slots whose address is not taken are allocated separately.
+// IR-LABEL: define dso_local {{.*}} @mix(
+// IR: alloca i32
+// IR-LABEL: define dso_local {{.*}} @fill(
+
+#include <stdio.h>
+
+int __attribute__((noinline)) mix(int A, int B, int C) {
+  int X = A + B;
+  int Y = X * C;
+  return X + Y;
+}
+
+// The elements of Arr are accessed using its address.
+int __attribute__((noinline)) fill(int N) {
+  int Arr[4];
+  int *P = Arr;
+  for (int I = 0; I < 4; I++)
+    P[I] = I * N;
+  return Arr[0] + Arr[3];
+}
+
+int main() {
+  printf("mix(3, 4, 5) = %d\n", mix(3, 4, 5));
+  printf("fill(3) = %d\n", fill(3));
+  return 0;
+}
@@ -0,0 +1,33 @@
+// REQUIRES: system-linux
+// RUN: clang -o %t %s -O2
+// RUN: llvm-mctoll -d -I /usr/include/stdio.h --time-phases --stats-json=%t-stats.json %t 2> %t-phases.txt
+// RUN: FileCheck %s --check-prefix=JSON < %t-stats.json
+// RUN: FileCheck %s --check-prefix=PHASES < %t-phases.txt
+// RUN: clang -o %t-dis %t-dis.ll
+// RUN: %t-dis 2>&1 | FileCheck %s
+// CHECK: square(7) = 49
+
+// JSON: "phases": {
+// JSON: "disassembly": {
+// JSON: "inputs": [
+// JSON: "name": "square",
+// JSON-NEXT: "address":
+// JSON-NEXT: "instructions":
+// JSON-NEXT: "blocks":
+// JSON-NEXT: "ir_instructions":
+
+// PHASES: llvm-mctoll phases
+// PHASES-DAG: Disassembly
+// PHASES-DAG: Control flow graph construction
+// PHASES-DAG: Prototype discovery
+// PHASES-DAG: Instruction raising
+// PHASES-DAG: Output emission
+
+#include <stdio.h>
+
+int __attribute__((noinline)) square(int N) { return N * N; }
+
+int main() {
+  printf("square(7) = %d\n", square(7));
+  return 0;
+}
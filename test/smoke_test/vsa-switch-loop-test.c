@@ -0,0 +1,74 @@
+// REQUIRES: system-linux
+// RUN: clang -o %t %s -O2 -mno-sse
+// RUN: llvm-mctoll -d -I /usr/include/stdio.h --vsa-trace=%t-trace.jsonl --vsa-trace-function=step %t -o %t-dis.ll
+// RUN: FileCheck %s --check-prefix=TRACE < %t-trace.jsonl
+// RUN: clang -o %t-dis %t-dis.ll
+// RUN: %t-dis 2>&1 | FileCheck %s
+// CHECK: state = 7000
+
+// TRACE: {"event":"function","function":"step","address":{{[0-9]+}}}
+// TRACE-NEXT: {"event":"fixpoint","function":"step","blocks":{{[0-9]+}},"visits":{{[0-9]+}},"converged":true,"time_us":{{[0-9]+}}}
+
+#include <stdio.h>
+
+int __attribute__((noinline)) step(int N) {
+  int State = 0;
+  for (int I = 0; I < N; I++) {
+    switch ((State + I) & 15) {
+    case 0:
+      State += 3;
+      break;
+    case 1:
+      State ^= 5;
+      break;
+    case 2:
+      State += 7;
+      break;
+    case 3:
+      State -= 2;
+      break;
+    case 4:
+      State += 11;
+      break;
+    case 5:
+      State ^= 9;
+      break;
+    case 6:
+      State += 13;
+      break;
+    case 7:
+      State -= 1;
+      break;
+    case 8:
+      State += 17;
+      break;
+    case 9:
+      State ^= 3;
+      break;
+    case 10:
+      State += 19;
+      break;
+    case 11:
+      State -= 5;
+      break;
+    case 12:
+      State += 23;
+      break;
+    case 13:
+      State ^= 6;
+      break;
+    case 14:
+      State += 29;
+      break;
+    default:
+      State += 1;
+      break;
+    }
+  }
+  return State;
+}
+
+int main() {
+  printf("state = %d\n", step(1000));
+  return 0;
+}
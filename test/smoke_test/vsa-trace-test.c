@@ -0,0 +1,25 @@
+// REQUIRES: system-linux
+// RUN: clang -o %t %s -O2 -mno-sse
+// RUN: llvm-mctoll -d -I /usr/include/stdio.h --vsa-trace=%t-trace.jsonl --vsa-trace-function=sum %t -o %t-dis.ll
+// RUN: FileCheck %s --check-prefix=TRACE < %t-trace.jsonl
+// RUN: clang -o %t-dis %t-dis.ll
+// RUN: %t-dis 2>&1 | FileCheck %s
+// CHECK: sum = 55
+
+// TRACE: {"event":"function","function":"sum","address":{{[0-9]+}}}
+// TRACE: {"event":"instruction","function":"sum","address":{{[0-9]+}},"opcode":"{{[A-Z0-9a-z_]+}}","alocs":[
+// TRACE-NOT: "function":"main"
+
+#include <stdio.h>
+
+int __attribute__((noinline)) sum(int N) {
+  int S = 0;
+  for (int I = 1; I <= N; I++)
+    S += I;
+  return S;
+}
+
+int main() {
+  printf("sum = %d\n", sum(10));
+  return 0;
+}